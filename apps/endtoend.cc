@@ -14,6 +14,8 @@
 
 using namespace std;
 
+constexpr size_t MAX_FRAME_SIZE = 16384; // longest frame read from a socket
+
 EthernetAddress random_host_ethernet_address()
 {
   EthernetAddress addr;
@@ -39,16 +41,14 @@ EthernetAddress random_router_ethernet_address()
   return addr;
 }
 
-optional<EthernetFrame> maybe_receive_frame( FileDescriptor& fd )
+// the frame is read whole into a buffer from `buffers`, and its payload refers to that buffer
+optional<EthernetFrame> maybe_receive_frame( FileDescriptor& fd, BufferPool& buffers )
 {
-  vector<string> strs( 4 );
-  strs.at( 0 ).resize( EthernetHeader::LENGTH );
-  strs.at( 1 ).resize( IPv4Header::LENGTH );
-  strs.at( 2 ).resize( TCPSegment::HEADER_LENGTH );
-  fd.read( strs );
+  vector<Ref<string>> frame_buffers;
+  frame_buffers.push_back( fd.read( buffers ) );
 
   EthernetFrame frame;
-  if ( not parse( frame, move( strs ) ) ) {
+  if ( not parse( frame, move( frame_buffers ) ) ) {
     return {};
   }
 
@@ -68,6 +68,7 @@ private:
   struct Sender : public NetworkInterface::OutputPort
   {
     pair<FileDescriptor, FileDescriptor> sockets { make_socket_pair() };
+    BufferPool frame_buffers { MAX_FRAME_SIZE }; // what frames from sockets.first are read into
 
     void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x ) override
     {
@@ -87,7 +88,7 @@ public:
 
   optional<TCPMessage> read()
   {
-    auto frame_opt = maybe_receive_frame( sender_->sockets.first );
+    auto frame_opt = maybe_receive_frame( sender_->sockets.first, sender_->frame_buffers );
     if ( not frame_opt ) {
       return {};
     }
@@ -211,9 +212,10 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
   thread network_thread( [&]() {
     try {
       EventLoop event_loop;
+      BufferPool frame_buffers { MAX_FRAME_SIZE };
       // Frames from host to router
       event_loop.add_rule( "frames from host to router", sock.adapter().frame_fd(), Direction::In, [&] {
-        auto frame_opt = maybe_receive_frame( sock.adapter().frame_fd() );
+        auto frame_opt = maybe_receive_frame( sock.adapter().frame_fd(), frame_buffers );
         if ( not frame_opt ) {
           return;
         }
@@ -257,7 +259,7 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
 
       // Frames from Internet to router
       event_loop.add_rule( "frames from Internet to router", internet_socket, Direction::In, [&] {
-        auto frame_opt = maybe_receive_frame( internet_socket );
+        auto frame_opt = maybe_receive_frame( internet_socket, frame_buffers );
         if ( not frame_opt ) {
           return;
         }
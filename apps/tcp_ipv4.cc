@@ -35,7 +35,8 @@ void show_usage( const char* argv0, const char* msg )
 
        << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
-       << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
+       << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n"
+       << "   -o              Offload TCP checksums to the tun device         (compute and verify)\n\n"
 
        << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
        << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
@@ -101,6 +102,10 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
       tundev = args[curr + 1];
       curr += 2;
 
+    } else if ( strncmp( "-o", args[curr], 3 ) == 0 ) {
+      c_filt.checksum_offload = true;
+      curr += 1;
+
     } else if ( strncmp( "-Lu", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -Lu requires one argument." );
       const float lossrate = strtof( args[curr + 1], nullptr );
@@ -158,8 +163,9 @@ int main( int argc, char** argv )
     }
 
     auto [c_fsm, c_filt, listen, tun_dev_name] = get_config( args );
-    LossyTCPOverIPv4MinnowSocket tcp_socket( LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>(
-      TCPOverIPv4OverTunFdAdapter( TunFD( tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name ) ) ) );
+    TunFD tun { tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name, c_filt.checksum_offload };
+    LossyTCPOverIPv4MinnowSocket tcp_socket(
+      LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>( TCPOverIPv4OverTunFdAdapter( move( tun ) ) ) );
 
     if ( listen ) {
       tcp_socket.listen_and_accept( c_fsm, c_filt );
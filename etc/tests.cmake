@@ -57,6 +57,20 @@ ttest(send_extra)
 ttest(net_interface)
 
 ttest(router)
+ttest(route_table)
+ttest(router_threads)
+ttest(router_route_changes)
+ttest(double_buffered)
+ttest(flat_hash_map)
+
+ttest(checksum)
+ttest(ipv4_checksum)
+ttest(parser)
+ttest(eventloop_timers)
+ttest(datagram_device)
+ttest(tcp_over_udp)
+ttest(loopback_adapter)
+ttest(tcp_stack)
 
 ttest(no_skip)
 
@@ -74,7 +88,7 @@ add_custom_target (check3 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --s
 
 add_custom_target (check5 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 15 -R '^net_interface|^no_skip')
 
-add_custom_target (check6 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 15 -R '^net_interface|^router|^no_skip')
+add_custom_target (check6 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 15 -R '^net_interface|^router|^route_table|^no_skip')
 
 ###
 
@@ -94,3 +108,11 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(checksum_speed_test)
+stest(eventloop_speed_test)
+stest(tcp_stack_speed_test)
+stest(route_lookup_speed_test)
+stest(route_churn_speed_test)
+stest(router_speed_test)
+stest(flat_hash_map_speed_test)
+stest(net_interface_speed_test)
@@ -29,68 +29,86 @@ NetworkInterface::NetworkInterface( string_view name,
 //! may also be another host if directly connected to the same network as the destination) Note: the Address type
 //! can be converted to a uint32_t (raw 32-bit IP address) by using the Address::ipv4_numeric() method.
 void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
+{
+  if ( not send_if_resolved( dgram, next_hop ) ) {
+    hold_for_arp( InternetDatagram { dgram }, next_hop );
+  }
+}
+
+void NetworkInterface::send_datagram( InternetDatagram&& dgram, const Address& next_hop )
+{
+  if ( not send_if_resolved( dgram, next_hop ) ) {
+    hold_for_arp( std::move( dgram ), next_hop );
+  }
+}
+
+bool NetworkInterface::send_if_resolved( const InternetDatagram& dgram, const Address& next_hop ) const
 {
   // Check if the next hop is in the ARP cache
-  auto it = arp_cache_.find( next_hop.ipv4_numeric() );
-  if ( it != arp_cache_.end() ) {
-    // If found, create an Ethernet frame and send it
-    EthernetFrame frame;
-    frame.header.dst = it->second.first;           // Destination MAC address from ARP cache
-    frame.header.src = ethernet_address_;          // Source MAC address of this interface
-    frame.header.type = EthernetHeader::TYPE_IPv4; // Type for IPv4
-
-    // Serialize the datagram and add it to the frame payload
-    frame.payload = serialize( dgram );
-
-    // Transmit the frame
-    transmit( frame );
-  } else {
-
-    auto it1 = arp_requests_.find( next_hop.ipv4_numeric() );
-    if ( it1 != arp_requests_.end() ) {
-      // If an ARP request has already been sent for this IP address, just return
-      // debug("last_tick_ - it1->second = {}",last_tick_ - it1->second);
-      if ( last_tick_ - it1->second < 5000 ) {
-        // Store the datagram in a queue for later processing
-        // auto it2 = datagrams_in_.begin();
-        // for( ; it2 != datagrams_in_.end(); ++it2 ) {
-        //   if ( it2->first.header.dst == dgram.header.dst ) {
-        //     break; // Don't send another request if the last one was sent less than 5 seconds ago
-        //   }
-        // }
-        // if( it2 == datagrams_in_.end() ) {
-        // If the datagram is not already in the queue, add it
-        // debug("Adding datagram to datagrams_in_");
-        datagrams_in_.emplace_back( dgram, next_hop );
-        // }
-        return; // Don't send another request if the last one was sent less than 5 seconds ago
-      }
-    }
+  const auto* mapping = arp_cache_.find( next_hop.ipv4_numeric() );
+  if ( mapping == nullptr ) {
+    return false;
+  }
+
+  // If found, create an Ethernet frame and send it
+  EthernetFrame frame;
+  frame.header.dst = mapping->ethernet_address;  // Destination MAC address from ARP cache
+  frame.header.src = ethernet_address_;          // Source MAC address of this interface
+  frame.header.type = EthernetHeader::TYPE_IPv4; // Type for IPv4
+
+  // The same header, serialized when the address was learned (so it needn't be written out byte by byte)
+  frame.serialized_header = mapping->ipv4_frame_header.get();
+
+  // Serialize the datagram's header, and refer to (rather than copy) its payload
+  frame.payload = serialize( dgram );
+
+  // Transmit the frame
+  transmit( frame );
+  return true;
+}
 
-    ARPMessage arp_request;
-    arp_request.opcode = ARPMessage::OPCODE_REQUEST;
-    arp_request.sender_ethernet_address = ethernet_address_;
-    arp_request.sender_ip_address = ip_address_.ipv4_numeric();
-    arp_request.target_ip_address = next_hop.ipv4_numeric();
-    arp_request.target_ethernet_address = EthernetAddress {}; // Set to zero for requests
-    arp_request.target_ip_address = next_hop.ipv4_numeric();
-    // Create an Ethernet frame for the ARP request
-    EthernetFrame frame;
-    frame.header.dst = ETHERNET_BROADCAST;        // Broadcast address for ARP requests
-    frame.header.src = ethernet_address_;         // Source MAC address of this interface
-    frame.header.type = EthernetHeader::TYPE_ARP; // Type for ARP
-    // Serialize the ARP message and add it to the frame payload
-    frame.payload = serialize( arp_request );
-
-    // Store the datagram in a queue for later processing
-    datagrams_in_.emplace_back( dgram, next_hop );
-
-    // Send the ARP request
-    transmit( frame );
-
-    // Add the ARP request to the arp_requests_ map
-    arp_requests_[next_hop.ipv4_numeric()] = last_tick_;
+unique_ptr<const string> NetworkInterface::make_ipv4_frame_header( const EthernetAddress& ethernet_address ) const
+{
+  const EthernetHeader header {
+    .dst = ethernet_address, .src = ethernet_address_, .type = EthernetHeader::TYPE_IPv4 };
+  return make_unique<const string>( concat( serialize( header ) ) );
+}
+
+void NetworkInterface::hold_for_arp( InternetDatagram&& dgram, const Address& next_hop )
+{
+  // Store the datagram in its next hop's queue for later processing (dropping the oldest if the queue is full)
+  auto& pending = pending_datagrams_[next_hop.ipv4_numeric()];
+  if ( pending.size() == MAX_PENDING_DATAGRAMS ) {
+    pending.pop();
   }
+  pending.push( std::move( dgram ) );
+
+  const auto* sent = arp_requests_.find( next_hop.ipv4_numeric() );
+  if ( sent != nullptr && last_tick_ - *sent < ARP_REQUEST_TIMEOUT_MS ) {
+    return; // Don't send another request if the last one was sent less than 5 seconds ago
+  }
+
+  ARPMessage arp_request;
+  arp_request.opcode = ARPMessage::OPCODE_REQUEST;
+  arp_request.sender_ethernet_address = ethernet_address_;
+  arp_request.sender_ip_address = ip_address_.ipv4_numeric();
+  arp_request.target_ip_address = next_hop.ipv4_numeric();
+  arp_request.target_ethernet_address = EthernetAddress {}; // Set to zero for requests
+  arp_request.target_ip_address = next_hop.ipv4_numeric();
+  // Create an Ethernet frame for the ARP request
+  EthernetFrame frame;
+  frame.header.dst = ETHERNET_BROADCAST;        // Broadcast address for ARP requests
+  frame.header.src = ethernet_address_;         // Source MAC address of this interface
+  frame.header.type = EthernetHeader::TYPE_ARP; // Type for ARP
+  // Serialize the ARP message and add it to the frame payload
+  frame.payload = serialize( arp_request );
+
+  // Send the ARP request
+  transmit( frame );
+
+  // Add the ARP request to the arp_requests_ map (and to the back of the queue of requests to expire)
+  arp_requests_[next_hop.ipv4_numeric()] = last_tick_;
+  arp_request_expiry_.emplace( next_hop.ipv4_numeric(), last_tick_ );
 }
 
 //! \param[in] frame the incoming Ethernet frame
@@ -105,7 +123,7 @@ void NetworkInterface::recv_frame( EthernetFrame frame )
     // If the type is IPv4, parse the datagram and push it to the datagrams_received queue
     InternetDatagram dgram;
     if ( parse( dgram, frame.payload ) ) {
-      datagrams_received_.push( dgram );
+      datagrams_received_.push( std::move( dgram ) );
     }
   } else if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
     // If the type is ARP, parse the ARP message
@@ -113,22 +131,27 @@ void NetworkInterface::recv_frame( EthernetFrame frame )
     if ( parse( arp_message, frame.payload ) ) {
       // Handle ARP request or reply
 
-      // remember the sender's Ethernet address and IP address
-      arp_cache_[arp_message.sender_ip_address]
-        = std::pair<EthernetAddress, size_t>( arp_message.sender_ethernet_address, last_tick_ );
-
-      if ( arp_requests_.find( arp_message.sender_ip_address ) != arp_requests_.end() ) {
-        arp_requests_.erase( arp_message.sender_ip_address );
+      // remember the sender's Ethernet address and IP address (queueing the mapping to expire, unless it is
+      // already queued for this time)
+      auto [mapping, added] = arp_cache_.try_emplace( arp_message.sender_ip_address );
+      if ( added or mapping->learned != last_tick_ ) {
+        arp_cache_expiry_.emplace( arp_message.sender_ip_address, last_tick_ );
       }
+      if ( added or mapping->ethernet_address != arp_message.sender_ethernet_address ) {
+        mapping->ethernet_address = arp_message.sender_ethernet_address;
+        mapping->ipv4_frame_header = make_ipv4_frame_header( mapping->ethernet_address );
+      }
+      mapping->learned = last_tick_;
+
+      arp_requests_.erase( arp_message.sender_ip_address );
 
-      auto it = datagrams_in_.begin();
-      while ( it != datagrams_in_.end() ) {
-        if ( it->second.ipv4_numeric() == arp_message.sender_ip_address ) {
-          // Send the datagram now that we have the MAC address
-          send_datagram( it->first, it->second );
-          it = datagrams_in_.erase( it ); // Remove from queue after sending
-        } else {
-          ++it;
+      // Send the datagrams that were waiting for this address, now that we have the MAC address
+      if ( auto* pending = pending_datagrams_.find( arp_message.sender_ip_address ) ) {
+        auto datagrams = std::move( *pending );
+        pending_datagrams_.erase( arp_message.sender_ip_address );
+        const Address next_hop = Address::from_ipv4_numeric( arp_message.sender_ip_address );
+        for ( ; not datagrams.empty(); datagrams.pop() ) {
+          send_datagram( std::move( datagrams.front() ), next_hop );
         }
       }
 
@@ -166,34 +189,28 @@ void NetworkInterface::recv_frame( EthernetFrame frame )
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
-  for ( auto it = arp_requests_.begin(); it != arp_requests_.end(); ) {
-    if ( ms_since_last_tick + last_tick_ - it->second > 5000 ) {
+  last_tick_ += ms_since_last_tick;
 
+  // Requests and mappings are queued to expire in the order they were made, so only the oldest need checking.
+  // A queued request that has been answered (or a mapping that has been learned again since) is skipped.
+  while ( not arp_request_expiry_.empty()
+          && last_tick_ - arp_request_expiry_.front().second > ARP_REQUEST_TIMEOUT_MS ) {
+    const auto [ip_address, sent] = arp_request_expiry_.front();
+    arp_request_expiry_.pop();
+    const auto* sent_at = arp_requests_.find( ip_address );
+    if ( sent_at != nullptr && *sent_at == sent ) {
       // Pending datagrams dropped when pending request expires
-      auto it2 = datagrams_in_.begin();
-      while ( it2 != datagrams_in_.end() ) {
-        if ( it2->second.ipv4_numeric() == it->first ) {
-          // Remove the datagram from the queue
-          it2 = datagrams_in_.erase( it2 );
-        } else {
-          ++it2;
-        }
-      }
-
-      // Remove the entry if it's older than 5 seconds
-      it = arp_requests_.erase( it );
-    } else {
-      ++it;
+      pending_datagrams_.erase( ip_address );
+      arp_requests_.erase( ip_address );
     }
   }
 
-  for ( auto it = arp_cache_.begin(); it != arp_cache_.end(); ) {
-    if ( ms_since_last_tick + last_tick_ - it->second.second > 30000 ) {
-      // Remove the entry if it's older than 5 seconds
-      it = arp_cache_.erase( it );
-    } else {
-      ++it;
+  while ( not arp_cache_expiry_.empty() && last_tick_ - arp_cache_expiry_.front().second > ARP_CACHE_TTL_MS ) {
+    const auto [ip_address, learned] = arp_cache_expiry_.front();
+    arp_cache_expiry_.pop();
+    const auto* mapping = arp_cache_.find( ip_address );
+    if ( mapping != nullptr && mapping->learned == learned ) {
+      arp_cache_.erase( ip_address );
     }
   }
-  last_tick_ += ms_since_last_tick;
 }
@@ -2,11 +2,12 @@
 
 #include "address.hh"
 #include "ethernet_frame.hh"
+#include "flat_hash_map.hh"
 #include "ipv4_datagram.hh"
 
 #include <memory>
 #include <queue>
-#include <unordered_map>
+#include <string>
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -52,6 +53,13 @@ public:
   // hop. Sending is accomplished by calling `transmit()` (a member variable) on the frame.
   void send_datagram( const InternetDatagram& dgram, const Address& next_hop );
 
+  // The same, but taking the datagram over (as a router does), so a datagram that has to wait for ARP is kept
+  // without copying its payload. Either way, the frame refers to the payload rather than copying it.
+  void send_datagram( InternetDatagram&& dgram, const Address& next_hop );
+
+  // Most datagrams kept for one next hop while ARP looks up its Ethernet address (more drop the oldest)
+  static constexpr size_t MAX_PENDING_DATAGRAMS = 64;
+
   // Receives an Ethernet frame and responds appropriately.
   // If type is IPv4, pushes the datagram to the datagrams_in queue.
   // If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
@@ -75,6 +83,13 @@ private:
   std::shared_ptr<OutputPort> port_;
   void transmit( const EthernetFrame& frame ) const { port_->transmit( *this, frame ); }
 
+  // Send a datagram if the Ethernet address of its next hop is known
+  // \returns false (without sending it) otherwise
+  bool send_if_resolved( const InternetDatagram& dgram, const Address& next_hop ) const;
+
+  // Keep a datagram until ARP finds the Ethernet address of its next hop (asking, if not asked recently)
+  void hold_for_arp( InternetDatagram&& dgram, const Address& next_hop );
+
   // Ethernet (known as hardware, network-access-layer, or link-layer) address of the interface
   EthernetAddress ethernet_address_;
 
@@ -84,15 +99,39 @@ private:
   // Datagrams that have been received
   std::queue<InternetDatagram> datagrams_received_ {};
 
-  // ARP cache: maps IP addresses to Ethernet addresses
-  std::unordered_map<uint32_t, std::pair<EthernetAddress, size_t>> arp_cache_ {};
+  // How long an ARP request is waited for, and how long a learned mapping is kept
+  static constexpr size_t ARP_REQUEST_TIMEOUT_MS = 5000;
+  static constexpr size_t ARP_CACHE_TTL_MS = 30000;
 
-  // Datagrams that have not yet been sent because the Ethernet address is not known
-  std::vector<std::pair<InternetDatagram, Address>> datagrams_in_ {};
+  // A neighbor whose Ethernet address is known: the address, when it was learned, and the header of the IPv4
+  // frames sent to it (serialized once, and kept on the heap so it stays put when the ARP cache grows)
+  struct Neighbor
+  {
+    EthernetAddress ethernet_address {};
+    size_t learned {};
+    std::unique_ptr<const std::string> ipv4_frame_header {};
+  };
+
+  // The serialized header of IPv4 frames from this interface to `ethernet_address`
+  std::unique_ptr<const std::string> make_ipv4_frame_header( const EthernetAddress& ethernet_address ) const;
+
+  // ARP cache: maps IP addresses to neighbors
+  FlatHashMap<uint32_t, Neighbor> arp_cache_ {};
+
+  // The IP addresses in the ARP cache, oldest first, with the time each was learned (a later time in the cache
+  // means it has been learned again since)
+  std::queue<std::pair<uint32_t, size_t>> arp_cache_expiry_ {};
+
+  // Datagrams that have not yet been sent because the Ethernet address is not known, by next hop (in the order
+  // they were sent, and at most MAX_PENDING_DATAGRAMS for each)
+  FlatHashMap<uint32_t, std::queue<InternetDatagram>> pending_datagrams_ {};
 
   // last time the interface was ticked
   size_t last_tick_ = 0;
 
   // arp request that have been sent
-  std::unordered_map<uint32_t, size_t> arp_requests_ {};
+  FlatHashMap<uint32_t, size_t> arp_requests_ {};
+
+  // The ARP requests that have been sent, oldest first (including ones answered since)
+  std::queue<std::pair<uint32_t, size_t>> arp_request_expiry_ {};
 };
@@ -0,0 +1,52 @@
+#include "route_cache.hh"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using namespace std;
+
+RouteCache::RouteCache( const size_t entries )
+  : entries_( bit_ceil( max( entries, size_t { 2 } ) ) ), shift_( 32 - countr_zero( entries_.size() ) )
+{
+  if ( entries_.size() > ( size_t { 1 } << 31 ) ) {
+    throw runtime_error( "RouteCache: too many entries" );
+  }
+}
+
+void RouteCache::check_table( const RouteTable& table )
+{
+  if ( &table == table_ and table.generation() == generation_ ) {
+    return;
+  }
+  table_ = &table;
+  generation_ = table.generation();
+
+  // a new epoch makes every entry stale without touching them (except when the epoch wraps around)
+  if ( ++epoch_ == 0 ) {
+    ranges::fill( entries_, Entry {} );
+    epoch_ = 1;
+  }
+}
+
+void RouteCache::lookup( const RouteTable& table,
+                         const span<const uint32_t> addresses,
+                         const span<const ForwardingRule*> rules )
+{
+  if ( rules.size() < addresses.size() ) {
+    throw runtime_error( "RouteCache: fewer results than addresses to look up" );
+  }
+  check_table( table );
+
+  for ( size_t i = 0; i < addresses.size(); i++ ) {
+    Entry& entry = entries_[index( addresses[i] )];
+    if ( entry.epoch == epoch_ and entry.address == addresses[i] ) {
+      rules[i] = entry.rule;
+      stats_.hits++;
+    } else {
+      rules[i] = table.lookup( addresses[i] );
+      entry = { addresses[i], epoch_, rules[i] };
+      stats_.misses++;
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "route_table.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// \brief A small direct-mapped cache of route lookups, for traffic that goes mostly to a few destinations.
+//
+// Each destination has one place in the cache, chosen by a hash of its address, so a hit costs a single cache
+// line. The cache remembers which table (and which generation of it) its entries came from, and forgets them
+// all when either changes.
+class RouteCache
+{
+public:
+  static constexpr size_t DEFAULT_ENTRIES = 4096;
+
+  // Construct with room for `entries` destinations (rounded up to a power of two)
+  explicit RouteCache( size_t entries = DEFAULT_ENTRIES );
+
+  // The entries point into the table they came from, so a cache is kept by one owner
+  RouteCache( const RouteCache& other ) = delete;
+  RouteCache& operator=( const RouteCache& other ) = delete;
+  RouteCache( RouteCache&& other ) = default;
+  RouteCache& operator=( RouteCache&& other ) = default;
+  ~RouteCache() = default;
+
+  // Look up a burst of addresses in the cache (or, if they miss, in `table`), putting the rule for
+  // `addresses[i]` in `rules[i]`
+  void lookup( const RouteTable& table,
+               std::span<const uint32_t> addresses,
+               std::span<const ForwardingRule*> rules );
+
+  struct Stats
+  {
+    uint64_t hits {};
+    uint64_t misses {};
+  };
+
+  const Stats& stats() const { return stats_; }
+
+private:
+  struct Entry
+  {
+    uint32_t address {};
+    uint32_t epoch {}; // the entry is valid only if it matches the cache's `epoch_`
+    const ForwardingRule* rule {};
+  };
+
+  // Where an address goes in `entries_`
+  size_t index( const uint32_t address ) const { return ( address * 0x9e3779b1U ) >> shift_; }
+
+  // Forget every entry if `table` isn't the one (or the generation of it) the entries came from
+  void check_table( const RouteTable& table );
+
+  std::vector<Entry> entries_;
+  unsigned shift_;
+
+  const RouteTable* table_ {};
+  uint64_t generation_ {};
+  uint32_t epoch_ {};
+
+  Stats stats_ {};
+};
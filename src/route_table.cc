@@ -0,0 +1,181 @@
+#include "route_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+uint32_t RouteTable::prefix_mask( const uint8_t prefix_length )
+{
+  if ( prefix_length > 32 ) {
+    throw runtime_error( "RouteTable: prefix length is more than 32 bits" );
+  }
+  return static_cast<uint32_t>( ~( ( uint64_t { 1 } << ( 32 - prefix_length ) ) - 1 ) );
+}
+
+void RouteTable::add( const ForwardingRule& rule )
+{
+  const uint32_t prefix = rule.route_prefix & prefix_mask( rule.prefix_length );
+  if ( index_.contains( key( prefix, rule.prefix_length ) ) ) {
+    return;
+  }
+  if ( rules_.size() + 1 >= CHILD and free_rules_.empty() ) {
+    throw runtime_error( "RouteTable: too many rules" );
+  }
+
+  // reuse the place of a removed rule if there is one
+  Entry entry {};
+  if ( free_rules_.empty() ) {
+    rules_.push_back( rule );
+    entry = static_cast<Entry>( rules_.size() );
+  } else {
+    entry = free_rules_.back();
+    free_rules_.pop_back();
+    rules_[entry - 1] = rule;
+  }
+  rules_[entry - 1].route_prefix = prefix;
+  index_.emplace( key( prefix, rule.prefix_length ), entry );
+  generation_++;
+
+  const auto [first, count] = covered_slots( prefix, rule.prefix_length );
+  for ( size_t i = 0; i < count; i++ ) {
+    cover( first + i, rule.prefix_length, entry );
+  }
+}
+
+bool RouteTable::remove( const uint32_t route_prefix, const uint8_t prefix_length )
+{
+  const uint32_t prefix = route_prefix & prefix_mask( prefix_length );
+  const auto it = index_.find( key( prefix, prefix_length ) );
+  if ( it == index_.end() ) {
+    return false;
+  }
+  const Entry removed = it->second;
+  index_.erase( it );
+
+  // where the rule was the best match, the longest shorter prefix that covers it is now
+  Entry replacement = EMPTY;
+  for ( int length = prefix_length - 1; length >= 0 and replacement == EMPTY; length-- ) {
+    const auto shorter_length = static_cast<uint8_t>( length );
+    const auto shorter = index_.find( key( prefix & prefix_mask( shorter_length ), shorter_length ) );
+    replacement = shorter == index_.end() ? EMPTY : shorter->second;
+  }
+
+  const auto [first, count] = covered_slots( prefix, prefix_length );
+  for ( size_t i = 0; i < count; i++ ) {
+    uncover( first + i, removed, replacement );
+  }
+
+  rules_[removed - 1] = {};
+  free_rules_.push_back( removed );
+  generation_++;
+  return true;
+}
+
+void RouteTable::replace( const ForwardingRule& rule )
+{
+  const uint32_t prefix = rule.route_prefix & prefix_mask( rule.prefix_length );
+  const auto it = index_.find( key( prefix, rule.prefix_length ) );
+  if ( it == index_.end() ) {
+    add( rule );
+    return;
+  }
+
+  // the prefix is the same, so the trie already points every slot it should at this rule
+  rules_[it->second - 1] = rule;
+  rules_[it->second - 1].route_prefix = prefix;
+  generation_++;
+}
+
+void RouteTable::lookup( const span<const uint32_t> addresses, const span<const ForwardingRule*> rules ) const
+{
+  if ( rules.size() < addresses.size() ) {
+    throw runtime_error( "RouteTable: fewer results than addresses to look up" );
+  }
+
+  array<Entry, MAX_BURST> entries {};
+  array<size_t, MAX_BURST> next {}; // the slot of the next level to read, for entries that point to a child
+
+  for ( size_t start = 0; start < addresses.size(); start += MAX_BURST ) {
+    const auto burst = addresses.subspan( start, min( MAX_BURST, addresses.size() - start ) );
+
+    for ( const uint32_t address : burst ) {
+      __builtin_prefetch( &slots_[address >> ROOT_SHIFT] );
+    }
+    for ( size_t i = 0; i < burst.size(); i++ ) {
+      entries[i] = slots_[burst[i] >> ROOT_SHIFT];
+      if ( entries[i] & CHILD ) {
+        next[i] = child_offset( entries[i] ) + ( ( burst[i] >> NODE_BITS ) & NODE_MASK );
+        __builtin_prefetch( &slots_[next[i]] );
+      }
+    }
+    for ( size_t i = 0; i < burst.size(); i++ ) {
+      if ( entries[i] & CHILD ) {
+        entries[i] = slots_[next[i]];
+        if ( entries[i] & CHILD ) {
+          next[i] = child_offset( entries[i] ) + ( burst[i] & NODE_MASK );
+          __builtin_prefetch( &slots_[next[i]] );
+        }
+      }
+    }
+    for ( size_t i = 0; i < burst.size(); i++ ) {
+      if ( entries[i] & CHILD ) {
+        entries[i] = slots_[next[i]];
+      }
+      rules[start + i] = entries[i] == EMPTY ? nullptr : &rules_[entries[i] - 1];
+      __builtin_prefetch( rules[start + i] ); // the caller reads the rule next
+    }
+  }
+}
+
+pair<size_t, size_t> RouteTable::covered_slots( const uint32_t prefix, const uint8_t prefix_length )
+{
+  size_t offset = 0;
+  unsigned level_end = ROOT_BITS; // the last bit (counting from the most significant) the level indexes on
+  uint32_t mask = ROOT_SIZE - 1;
+
+  // a longer prefix belongs to a child node, which starts out with what its parent slot held
+  while ( prefix_length > level_end ) {
+    const size_t slot = offset + ( ( prefix >> ( 32 - level_end ) ) & mask );
+    if ( not( slots_[slot] & CHILD ) ) {
+      const Entry inherited = slots_[slot];
+      const auto number = static_cast<Entry>( ( slots_.size() - ROOT_SIZE ) / NODE_SIZE );
+      slots_.resize( slots_.size() + NODE_SIZE, inherited );
+      slots_[slot] = CHILD | number;
+    }
+    offset = child_offset( slots_[slot] );
+    level_end += NODE_BITS;
+    mask = NODE_MASK;
+  }
+
+  // otherwise the prefix covers a run of this node's slots
+  return { offset + ( ( prefix >> ( 32 - level_end ) ) & mask ), size_t { 1 } << ( level_end - prefix_length ) };
+}
+
+void RouteTable::cover( const size_t slot, const uint8_t prefix_length, const Entry entry )
+{
+  const Entry current = slots_[slot];
+  if ( current & CHILD ) {
+    const size_t offset = child_offset( current );
+    for ( size_t i = 0; i < NODE_SIZE; i++ ) {
+      cover( offset + i, prefix_length, entry );
+    }
+  } else if ( current == EMPTY or rules_[current - 1].prefix_length < prefix_length ) {
+    slots_[slot] = entry;
+  }
+}
+
+void RouteTable::uncover( const size_t slot, const Entry removed, const Entry replacement )
+{
+  const Entry current = slots_[slot];
+  if ( current & CHILD ) {
+    const size_t offset = child_offset( current );
+    for ( size_t i = 0; i < NODE_SIZE; i++ ) {
+      uncover( offset + i, removed, replacement );
+    }
+  } else if ( current == removed ) {
+    slots_[slot] = replacement;
+  }
+}
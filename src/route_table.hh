@@ -0,0 +1,117 @@
+#pragma once
+
+#include "address.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct ForwardingRule
+{
+  uint32_t route_prefix {};
+  uint8_t prefix_length {};
+  std::optional<Address> next_hop {};
+  size_t interface_num {};
+};
+
+// \brief A longest-prefix-match table of forwarding rules.
+//
+// The rules are expanded into a multibit trie with strides of 16, 8 and 8 bits (like DIR-24-8, but with a
+// smaller first level). Each slot holds either the rule with the longest prefix that covers it, or a
+// child node that splits it further, so a lookup is at most three array reads. A rule is "pushed"
+// into every slot it covers (including the slots of child nodes) unless a longer prefix is already there.
+// Removing a rule puts the longest shorter prefix that covers it back in the slots it had (child nodes stay).
+class RouteTable
+{
+public:
+  // Add a rule. The bits of `route_prefix` past `prefix_length` are ignored. If the table already has a rule
+  // for the same prefix, the earlier rule stays in effect.
+  void add( const ForwardingRule& rule );
+
+  // Remove the rule for a prefix
+  // \returns false if the table had no rule for the prefix
+  bool remove( uint32_t route_prefix, uint8_t prefix_length );
+
+  // Put a rule in place of the one for the same prefix (or add it, if the table has none)
+  void replace( const ForwardingRule& rule );
+
+  // The rule with the longest prefix that matches `address`, or nullptr if none does
+  const ForwardingRule* lookup( uint32_t address ) const
+  {
+    Entry entry = slots_[address >> ROOT_SHIFT];
+    if ( entry & CHILD ) {
+      entry = slots_[child_offset( entry ) + ( ( address >> NODE_BITS ) & NODE_MASK )];
+      if ( entry & CHILD ) {
+        entry = slots_[child_offset( entry ) + ( address & NODE_MASK )];
+      }
+    }
+    return entry == EMPTY ? nullptr : &rules_[entry - 1];
+  }
+
+  // Look up a burst of addresses at once, putting the rule for `addresses[i]` in `rules[i]`. Each level of the
+  // trie is read for the whole burst before the next, after prefetching the slots the burst will need, so
+  // the cache misses of different addresses overlap instead of following one after another.
+  void lookup( std::span<const uint32_t> addresses, std::span<const ForwardingRule*> rules ) const;
+
+  // Most addresses looked up together (a longer burst is looked up in pieces this long)
+  static constexpr size_t MAX_BURST = 32;
+
+  // Number of rules in the table
+  size_t size() const { return index_.size(); }
+
+  // Counts the changes to the table, so a copy of what it held (like a RouteCache) can tell when it's stale
+  uint64_t generation() const { return generation_; }
+
+  // Bytes used by the trie's slots, and by the rules themselves
+  size_t trie_bytes() const { return slots_.capacity() * sizeof( Entry ); }
+  size_t rule_bytes() const { return rules_.capacity() * sizeof( ForwardingRule ); }
+
+private:
+  // A slot is EMPTY, a rule (its index in `rules_` plus one), or CHILD plus the number of a child node
+  using Entry = uint32_t;
+  static constexpr Entry EMPTY = 0;
+  static constexpr Entry CHILD = Entry { 1 } << 31;
+
+  static constexpr unsigned ROOT_BITS = 16;
+  static constexpr unsigned ROOT_SHIFT = 32 - ROOT_BITS;
+  static constexpr unsigned NODE_BITS = 8;
+  static constexpr size_t ROOT_SIZE = size_t { 1 } << ROOT_BITS;
+  static constexpr size_t NODE_SIZE = size_t { 1 } << NODE_BITS;
+  static constexpr uint32_t NODE_MASK = NODE_SIZE - 1;
+
+  // Where a child node's slots start in `slots_`
+  static size_t child_offset( const Entry entry ) { return ROOT_SIZE + ( entry & ~CHILD ) * NODE_SIZE; }
+
+  // The high `prefix_length` bits set
+  static uint32_t prefix_mask( uint8_t prefix_length );
+
+  // A prefix (with its host bits clear) and its length, as one key of `index_`
+  static uint64_t key( const uint32_t prefix, const uint8_t prefix_length )
+  {
+    return uint64_t { prefix } << 8 | prefix_length;
+  }
+
+  // The first of the run of slots that a prefix covers, and how many there are (in the node at the level where
+  // the prefix ends, which is created along with any on the way there)
+  std::pair<size_t, size_t> covered_slots( uint32_t prefix, uint8_t prefix_length );
+
+  // Put `entry` in a slot (and the slots of its children) unless a longer prefix is already there
+  void cover( size_t slot, uint8_t prefix_length, Entry entry );
+
+  // Put `replacement` in a slot (and the slots of its children) wherever `removed` is
+  void uncover( size_t slot, Entry removed, Entry replacement );
+
+  // The rules, the place in `rules_` (plus one) of the rule for each prefix, and the places of removed rules
+  std::vector<ForwardingRule> rules_ {};
+  std::unordered_map<uint64_t, Entry> index_ {};
+  std::vector<Entry> free_rules_ {};
+
+  uint64_t generation_ {};
+
+  // The root node, followed by every child node
+  std::vector<Entry> slots_ = std::vector<Entry>( ROOT_SIZE );
+};
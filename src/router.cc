@@ -5,6 +5,15 @@
 
 using namespace std;
 
+size_t Router::add_interface( shared_ptr<NetworkInterface> interface )
+{
+  interfaces_.push_back( notnull( "add_interface", std::move( interface ) ) );
+  if ( not workers_.empty() ) {
+    outbound_.push_back( make_unique<MPSCQueue<Outbound>>( OUTBOUND_CAPACITY ) );
+  }
+  return interfaces_.size() - 1;
+}
+
 // route_prefix: The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
 // prefix_length: For this route to be applicable, how many high-order (most-significant) bits of
 //    the route_prefix will need to match the corresponding bits of the datagram's destination address?
@@ -24,49 +33,200 @@ void Router::add_route( const uint32_t route_prefix,
   if ( interface_num >= interfaces_.size() ) {
     throw runtime_error( "Invalid interface number" );
   }
-  forwarding_table_.push_back( { route_prefix, prefix_length, next_hop, interface_num } );
+  const ForwardingRule rule { route_prefix, prefix_length, next_hop, interface_num };
+  forwarding_table_.update( [&]( RouteTable& table ) { table.add( rule ); } );
+}
+
+bool Router::remove_route( const uint32_t route_prefix, const uint8_t prefix_length )
+{
+  bool removed = false;
+  forwarding_table_.update( [&]( RouteTable& table ) { removed = table.remove( route_prefix, prefix_length ); } );
+  return removed;
+}
+
+void Router::replace_route( const uint32_t route_prefix,
+                            const uint8_t prefix_length,
+                            const optional<Address> next_hop,
+                            const size_t interface_num )
+{
+  if ( interface_num >= interfaces_.size() ) {
+    throw runtime_error( "Invalid interface number" );
+  }
+  const ForwardingRule rule { route_prefix, prefix_length, next_hop, interface_num };
+  forwarding_table_.update( [&]( RouteTable& table ) { table.replace( rule ); } );
 }
 
 // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
 void Router::route()
 {
-  // For each interface
-  for ( size_t i = 0; i < interfaces_.size(); ++i ) {
-    auto& interface = interfaces_[i];
-
-    // For each datagram in the interface's queue
-    while ( !interface->datagrams_received().empty() ) {
-      auto dgram = interface->datagrams_received().front();
-      interface->datagrams_received().pop();
-
-      // Check if the datagram's TTL is zero
-      if ( dgram.header.ttl <= 1 ) {
-        continue; // Drop the datagram if TTL is zero
-      } else {
-        dgram.header.ttl--;              // Decrement the TTL
-        dgram.header.compute_checksum(); // Recompute the checksum
-      }
+  if ( workers_.empty() ) {
+    for ( size_t i = 0; i < interfaces_.size(); ++i ) {
+      route_interface( forwarders_.front(), i, false );
+    }
+    return;
+  }
+
+  start_->arrive_and_wait();
+  route_share( 0 );
+  finish_->arrive_and_wait();
+}
+
+void Router::route_interface( Forwarder& forwarder, const size_t interface_num, const bool hand_off )
+{
+  auto& received = interfaces_[interface_num]->datagrams_received();
 
-      // Find the longest prefix match in the forwarding table
-      optional<ForwardingRule> best_match;
-      for ( const auto& rule : forwarding_table_ ) {
-        if ( ( rule.route_prefix == 0
-               || rule.route_prefix >> ( 32 - rule.prefix_length )
-                    == dgram.header.dst >> ( 32 - rule.prefix_length ) )
-             && ( best_match == nullopt || rule.prefix_length > best_match->prefix_length ) ) {
-          best_match = rule;
-        }
+  while ( !received.empty() ) {
+    // Take a burst of datagrams off the queue, dropping any whose TTL runs out
+    forwarder.destinations.clear();
+    while ( !received.empty() && forwarder.burst.size() < RouteTable::MAX_BURST ) {
+      auto& dgram = received.front();
+      if ( dgram.header.ttl > 1 ) {
+        dgram.header.decrement_ttl(); // Decrement the TTL (and update the checksum to match)
+        forwarder.destinations.push_back( dgram.header.dst );
+        forwarder.burst.push_back( std::move( dgram ) );
       }
+      received.pop();
+    }
 
-      // If a match is found, send the datagram to the appropriate interface
-      if ( best_match.has_value() ) {
-        auto& next_interface = interfaces_[best_match->interface_num];
-        if ( best_match->next_hop.has_value() ) {
-          next_interface->send_datagram( dgram, best_match->next_hop.value() );
-        } else {
-          next_interface->send_datagram( dgram, Address::from_ipv4_numeric( dgram.header.dst ) );
-        }
+    // Find the longest prefix match in the forwarding table, for the whole burst at once (the rules stay
+    // in place until the burst has been sent, even if the routes change meanwhile)
+    const auto table = forwarding_table_.read();
+    forwarder.best_matches.resize( forwarder.burst.size() );
+    if ( forwarder.route_cache.has_value() ) {
+      forwarder.route_cache->lookup( *table, forwarder.destinations, forwarder.best_matches );
+    } else {
+      table->lookup( forwarder.destinations, forwarder.best_matches );
+    }
+
+    // If a match is found, send the datagram to the appropriate interface (or hand it to the thread that owns it)
+    for ( size_t j = 0; j < forwarder.burst.size(); ++j ) {
+      const ForwardingRule* best_match = forwarder.best_matches[j];
+      if ( best_match == nullptr ) {
+        continue;
+      }
+      if ( hand_off ) {
+        const uint32_t next_hop = best_match->next_hop.has_value() ? best_match->next_hop->ipv4_numeric()
+                                                                    : forwarder.destinations[j];
+        // if the interface has fallen this far behind, the datagram is dropped
+        outbound_[best_match->interface_num]->push( { std::move( forwarder.burst[j] ), next_hop } );
+        continue;
+      }
+      auto& next_interface = interfaces_[best_match->interface_num];
+      if ( best_match->next_hop.has_value() ) {
+        next_interface->send_datagram( std::move( forwarder.burst[j] ), best_match->next_hop.value() );
+      } else {
+        next_interface->send_datagram( std::move( forwarder.burst[j] ),
+                                       Address::from_ipv4_numeric( forwarder.destinations[j] ) );
       }
     }
+
+    // Drop the datagrams that matched no route (which lets go of the buffers they were read into)
+    forwarder.burst.clear();
+  }
+}
+
+void Router::route_share( const size_t thread_index )
+{
+  const size_t threads = forwarders_.size();
+  for ( size_t i = thread_index; i < interfaces_.size(); i += threads ) {
+    route_interface( forwarders_[thread_index], i, true );
+  }
+
+  handed_off_->arrive_and_wait();
+
+  for ( size_t i = thread_index; i < interfaces_.size(); i += threads ) {
+    while ( auto outbound = outbound_[i]->pop() ) {
+      const Address next_hop = Address::from_ipv4_numeric( outbound->next_hop );
+      interfaces_[i]->send_datagram( std::move( outbound->dgram ), next_hop );
+    }
+  }
+}
+
+void Router::run_worker( const size_t thread_index )
+{
+  while ( true ) {
+    start_->arrive_and_wait();
+    if ( stopping_ ) {
+      return;
+    }
+    route_share( thread_index );
+    finish_->arrive_and_wait();
+  }
+}
+
+void Router::set_threads( const size_t threads )
+{
+  if ( threads == 0 ) {
+    throw runtime_error( "Router needs at least one thread" );
+  }
+  stop_workers();
+
+  // keep counting the lookups that the caches of threads going away answered
+  for ( size_t i = threads; i < forwarders_.size(); i++ ) {
+    if ( forwarders_[i].route_cache.has_value() ) {
+      retired_cache_stats_.hits += forwarders_[i].route_cache->stats().hits;
+      retired_cache_stats_.misses += forwarders_[i].route_cache->stats().misses;
+    }
+  }
+  forwarders_.resize( threads );
+  for ( auto& forwarder : forwarders_ ) {
+    if ( route_cache_entries_.has_value() and not forwarder.route_cache.has_value() ) {
+      forwarder.route_cache.emplace( *route_cache_entries_ );
+    }
+  }
+  if ( threads == 1 ) {
+    outbound_.clear();
+    return;
+  }
+
+  while ( outbound_.size() < interfaces_.size() ) {
+    outbound_.push_back( make_unique<MPSCQueue<Outbound>>( OUTBOUND_CAPACITY ) );
+  }
+  const auto count = static_cast<ptrdiff_t>( threads );
+  start_ = make_unique<barrier<>>( count );
+  handed_off_ = make_unique<barrier<>>( count );
+  finish_ = make_unique<barrier<>>( count );
+  for ( size_t i = 1; i < threads; ++i ) {
+    workers_.emplace_back( [this, i] { run_worker( i ); } );
+  }
+}
+
+void Router::stop_workers()
+{
+  if ( workers_.empty() ) {
+    return;
+  }
+  stopping_ = true;
+  start_->arrive_and_wait();
+  for ( auto& worker : workers_ ) {
+    worker.join();
+  }
+  workers_.clear();
+  stopping_ = false;
+}
+
+Router::~Router()
+{
+  stop_workers();
+}
+
+void Router::enable_route_cache( const size_t entries )
+{
+  route_cache_entries_ = entries;
+  for ( auto& forwarder : forwarders_ ) {
+    forwarder.route_cache.emplace( entries );
+  }
+}
+
+optional<RouteCache::Stats> Router::route_cache_stats() const
+{
+  if ( not route_cache_entries_.has_value() ) {
+    return nullopt;
+  }
+  RouteCache::Stats total = retired_cache_stats_;
+  for ( const auto& forwarder : forwarders_ ) {
+    total.hits += forwarder.route_cache->stats().hits;
+    total.misses += forwarder.route_cache->stats().misses;
   }
+  return total;
 }
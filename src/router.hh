@@ -1,31 +1,33 @@
 #pragma once
 
+#include "double_buffered.hh"
 #include "exception.hh"
+#include "mpsc_queue.hh"
 #include "network_interface.hh"
+#include "route_cache.hh"
+#include "route_table.hh"
 
+#include <barrier>
+#include <memory>
 #include <optional>
-
-struct ForwardingRule
-{
-  uint32_t route_prefix {};
-  uint8_t prefix_length {};
-  std::optional<Address> next_hop {};
-  size_t interface_num {};
-};
+#include <thread>
+#include <vector>
 
 // \brief A router that has multiple network interfaces and
 // performs longest-prefix-match routing between them.
 class Router
 {
 public:
+  Router() = default;
+  ~Router();
+
+  Router( const Router& other ) = delete;
+  Router& operator=( const Router& other ) = delete;
+
   // Add an interface to the router
   // \param[in] interface an already-constructed network interface
   // \returns The index of the interface after it has been added to the router
-  size_t add_interface( std::shared_ptr<NetworkInterface> interface )
-  {
-    interfaces_.push_back( notnull( "add_interface", std::move( interface ) ) );
-    return interfaces_.size() - 1;
-  }
+  size_t add_interface( std::shared_ptr<NetworkInterface> interface );
 
   // Access an interface by index
   std::shared_ptr<NetworkInterface> interface( const size_t N ) { return interfaces_.at( N ); }
@@ -36,11 +38,81 @@ public:
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
+  // Withdraw the route to a prefix
+  // \returns false if the router had no route to the prefix
+  bool remove_route( uint32_t route_prefix, uint8_t prefix_length );
+
+  // Change the route to a prefix (or add it, if the router has none)
+  void replace_route( uint32_t route_prefix,
+                      uint8_t prefix_length,
+                      std::optional<Address> next_hop,
+                      size_t interface_num );
+
+  // Route changes may come from another thread than the one calling route(). Each change is made to a copy of
+  // the forwarding table that route() isn't reading, and then to the other copy once route() has moved on.
+
   // Route packets between the interfaces
   void route();
 
+  // Route with `threads` threads (the caller of route(), and `threads - 1` workers). Each thread owns every
+  // `threads`th interface: it routes the datagrams that interface received, handing each one to the thread
+  // that owns its outgoing interface through a lock-free queue, and then sends what was handed to it. So each
+  // interface is used by one thread at a time, and datagrams from one interface to another stay in order. The
+  // OutputPorts of different interfaces must be safe to use from different threads.
+  void set_threads( size_t threads );
+
+  // Keep the routes to the last few destinations (a direct-mapped cache with room for `entries` of them) in
+  // front of the forwarding table, for traffic that goes mostly to a few destinations (each thread has its own)
+  void enable_route_cache( size_t entries = RouteCache::DEFAULT_ENTRIES );
+
+  // How many lookups the route cache answered, and how many it passed on to the forwarding table
+  std::optional<RouteCache::Stats> route_cache_stats() const;
+
 private:
+  // What a thread uses to route: the burst of datagrams being routed, their destinations, the rules they
+  // matched, and the thread's route cache
+  struct Forwarder
+  {
+    std::vector<InternetDatagram> burst {};
+    std::vector<uint32_t> destinations {};
+    std::vector<const ForwardingRule*> best_matches {};
+    std::optional<RouteCache> route_cache {};
+  };
+
+  // A datagram handed to the thread that owns its outgoing interface, and the next hop to send it to
+  struct Outbound
+  {
+    InternetDatagram dgram {};
+    uint32_t next_hop {};
+  };
+
+  // Most datagrams waiting to be sent on one interface (any more are dropped)
+  static constexpr size_t OUTBOUND_CAPACITY = 1 << 14;
+
+  // Route the datagrams an interface received: send them, or with `hand_off`, queue them in `outbound_`
+  void route_interface( Forwarder& forwarder, size_t interface_num, bool hand_off );
+
+  // Route the interfaces a thread owns, wait for every thread to finish, and send what was handed to them
+  void route_share( size_t thread_index );
+
+  void run_worker( size_t thread_index );
+  void stop_workers();
+
   // The router's collection of network interfaces
   std::vector<std::shared_ptr<NetworkInterface>> interfaces_ {};
-  std::vector<ForwardingRule> forwarding_table_ {};
+  DoubleBuffered<RouteTable> forwarding_table_ {};
+  std::optional<size_t> route_cache_entries_ {};
+  RouteCache::Stats retired_cache_stats_ {}; // from the caches of threads that set_threads() took away
+
+  // One Forwarder for each thread, and (with more than one thread) a queue for each interface
+  std::vector<Forwarder> forwarders_ = std::vector<Forwarder>( 1 );
+  std::vector<std::unique_ptr<MPSCQueue<Outbound>>> outbound_ {};
+
+  // The workers wait at `start_` for route() to be called, and every thread waits at `handed_off_` (so no
+  // interface's queue is drained while datagrams are still being handed to it) and at `finish_`
+  std::vector<std::thread> workers_ {};
+  std::unique_ptr<std::barrier<>> start_ {};
+  std::unique_ptr<std::barrier<>> handed_off_ {};
+  std::unique_ptr<std::barrier<>> finish_ {};
+  bool stopping_ {};
 };
@@ -1,5 +1,7 @@
 #include "tcp_minnow_socket_impl.hh"
 
-//! Specializations of TCPMinnowSocket for TCPOverIPv4OverTunFdAdapter and its lossy version
+//! Specializations of TCPMinnowSocket for each adapter, and its lossy version
 template class TCPMinnowSocket<TCPOverIPv4OverTunFdAdapter>;
 template class TCPMinnowSocket<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+template class TCPMinnowSocket<TCPOverUDPAdapter>;
+template class TCPMinnowSocket<LossyFdAdapter<TCPOverUDPAdapter>>;
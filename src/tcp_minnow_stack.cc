@@ -0,0 +1,674 @@
+#include "tcp_minnow_stack.hh"
+
+#include "exception.hh"
+#include "helpers.hh"
+#include "random.hh"
+#include "tcp_segment.hh"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+static constexpr int ABORT_CHECK_MS = 10; // how often the dispatcher checks abort_
+static constexpr size_t INBOUND_QUEUE_CAPACITY = 4096;
+static constexpr size_t READ_DEPTH = 32;
+
+namespace {
+uint64_t timestamp_ms()
+{
+  return chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+pair<LocalStreamSocket, LocalStreamSocket> local_stream_socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+  return { LocalStreamSocket { FileDescriptor { fds[0] } }, LocalStreamSocket { FileDescriptor { fds[1] } } };
+}
+
+//! Big-endian value at `offset` in `bytes`
+uint32_t load_be( const string_view bytes, const size_t offset, const size_t length )
+{
+  uint32_t ret = 0;
+  for ( const char byte : bytes.substr( offset, length ) ) {
+    ret = ret << 8 | static_cast<uint8_t>( byte );
+  }
+  return ret;
+}
+
+//! The 4-tuple (from the receiver's point of view) of a TCP segment in an IPv4 datagram, without parsing the rest
+optional<FlowKey> peek_flow( const string_view datagram )
+{
+  constexpr size_t proto_offset = 9;
+  constexpr size_t src_offset = 12;
+  constexpr size_t dst_offset = 16;
+
+  if ( datagram.size() < IPv4Header::LENGTH or static_cast<uint8_t>( datagram[0] ) >> 4 != 4
+       or static_cast<uint8_t>( datagram[proto_offset] ) != IPv4Header::PROTO_TCP ) {
+    return {};
+  }
+
+  const size_t tcp_offset = ( static_cast<uint8_t>( datagram[0] ) & 0xf ) * 4;
+  if ( datagram.size() < tcp_offset + 4 ) {
+    return {};
+  }
+
+  return FlowKey { load_be( datagram, dst_offset, 4 ),
+                   static_cast<uint16_t>( load_be( datagram, tcp_offset + 2, 2 ) ),
+                   load_be( datagram, src_offset, 4 ),
+                   static_cast<uint16_t>( load_be( datagram, tcp_offset, 2 ) ) };
+}
+
+Address to_address( const uint32_t ip, const uint16_t port )
+{
+  return Address { Address::from_ipv4_numeric( ip ).ip(), port };
+}
+} // namespace
+
+struct TCPMinnowStack::Connection
+{
+  FlowKey key;
+  TCPPeer peer;
+  LocalStreamSocket thread_data;                 //!< The stack's end of the socket pair shared with the owner
+  optional<LocalStreamSocket> owner_end {};      //!< The owner's end, for passive opens until accepted
+  shared_ptr<PendingConnect> pending_connect {}; //!< Set for active opens
+  bool established {};
+  bool finished {};
+  bool inbound_shutdown {};
+  bool outbound_shutdown {};
+  vector<EventLoop::RuleHandle> rules {};
+  uint64_t last_tick_ms;                         //!< When the peer was last ticked
+  optional<EventLoop::RuleHandle> timer {};      //!< Timer rule for the peer's next timeout
+  optional<uint64_t> timer_deadline_ms {};       //!< When that timer is due
+
+  Connection( const FlowKey& s_key, const TCPConfig& config, LocalStreamSocket&& s_thread_data )
+    : key( s_key ), peer( config ), thread_data( move( s_thread_data ) ), last_tick_ms( timestamp_ms() )
+  {}
+};
+
+//! \param[in] datagram_fd is the device for reading and writing IPv4 datagrams
+//! \param[in] num_workers is the number of threads that serve connections (at least one)
+TCPMinnowStack::TCPMinnowStack( FileDescriptor&& datagram_fd, const size_t num_workers )
+  : datagram_fd_( move( datagram_fd ) ), rand_( get_random_engine() )
+{
+  if ( num_workers == 0 ) {
+    throw runtime_error( "TCPMinnowStack: needs at least one worker" );
+  }
+
+  // Each worker writes through its own descriptor (a dup of the device) so the threads share no state.
+  // A single worker also reads the device; otherwise the dispatcher does.
+  try {
+    for ( size_t i = 0; i < num_workers; i++ ) {
+      FileDescriptor worker_fd { CheckSystemCall( "dup", ::dup( datagram_fd_.fd_num() ) ) };
+      workers_.push_back( make_unique<Worker>( *this, move( worker_fd ), num_workers == 1 ) );
+    }
+
+    if ( num_workers > 1 ) {
+      dispatcher_ = thread( &TCPMinnowStack::dispatch, this );
+    }
+  } catch ( ... ) {
+    abort_ = true;
+    workers_.clear();
+    throw;
+  }
+}
+
+TCPMinnowStack::~TCPMinnowStack()
+{
+  try {
+    abort_ = true;
+    if ( dispatcher_.joinable() ) {
+      dispatcher_.join();
+    }
+    workers_.clear();
+  } catch ( const exception& e ) {
+    cerr << "Exception destructing TCPMinnowStack: " << e.what() << "\n";
+  }
+}
+
+size_t TCPMinnowStack::connection_count() const
+{
+  size_t ret = 0;
+  for ( const auto& worker : workers_ ) {
+    ret += worker->connection_count();
+  }
+  return ret;
+}
+
+void TCPMinnowStack::stop()
+{
+  const lock_guard lock { mutex_ };
+  abort_ = true;
+  cv_.notify_all();
+}
+
+//! \param[in] c_tcp is the TCPConfig for connections accepted on this port (each gets a random ISN)
+//! \param[in] c_ad supplies the local address to listen on (an IP address of "0" accepts on any)
+//! \param[in] backlog is the maximum number of connections in progress or waiting to be accepted
+void TCPMinnowStack::listen( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad, const size_t backlog )
+{
+  const lock_guard lock { mutex_ };
+  if ( not listeners_.try_emplace( c_ad.source.port(), c_tcp, c_ad.source.ipv4_numeric(), backlog ).second ) {
+    throw runtime_error( "TCPMinnowStack: already listening on port " + to_string( c_ad.source.port() ) );
+  }
+}
+
+TCPStackSocket TCPMinnowStack::accept( const uint16_t port )
+{
+  unique_lock lock { mutex_ };
+  const auto it = listeners_.find( port );
+  if ( it == listeners_.end() ) {
+    throw runtime_error( "TCPMinnowStack: accept() on port " + to_string( port ) + " without listen()" );
+  }
+
+  // references to unordered_map elements remain valid while other listeners are added
+  Listener& listener = it->second;
+  cv_.wait( lock, [&] { return abort_ or not listener.ready.empty(); } );
+  if ( listener.ready.empty() ) {
+    throw runtime_error( "TCPMinnowStack: stopped while waiting in accept()" );
+  }
+
+  TCPStackSocket ret { move( listener.ready.front() ) };
+  listener.ready.pop_front();
+  return ret;
+}
+
+//! \param[in] c_tcp is the TCPConfig for the connection (the ISN is chosen randomly)
+//! \param[in] c_ad is the source and destination of the connection
+TCPStackSocket TCPMinnowStack::connect( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad )
+{
+  constexpr uint16_t first_ephemeral = 49152;
+  constexpr size_t max_attempts = 64;
+  uniform_int_distribution<uint16_t> ephemeral_ports { first_ephemeral, UINT16_MAX };
+
+  const FlowKey requested {
+    c_ad.source.ipv4_numeric(), c_ad.source.port(), c_ad.destination.ipv4_numeric(), c_ad.destination.port() };
+
+  // The port decides which worker owns the connection, so an ephemeral port is chosen here
+  // and chosen again if that worker already has a connection with the same 4-tuple.
+  for ( size_t attempt = 0; attempt < max_attempts; attempt++ ) {
+    FlowKey key = requested;
+    if ( key.local_port == 0 ) {
+      const lock_guard lock { mutex_ };
+      key.local_port = ephemeral_ports( rand_ );
+    }
+
+    auto [owner_end, stack_end] = local_stream_socket_pair();
+    auto pending = make_shared<PendingConnect>();
+    worker_for( key ).connect( c_tcp, key, pending, move( stack_end ) );
+
+    unique_lock lock { mutex_ };
+    cv_.wait( lock, [&] { return abort_ or pending->done; } );
+    if ( pending->succeeded ) {
+      return { move( owner_end ), to_address( key.local_ip, key.local_port ), c_ad.destination };
+    }
+    if ( not pending->port_in_use or requested.local_port != 0 or abort_ ) {
+      break;
+    }
+  }
+
+  throw runtime_error( "TCPMinnowStack: could not connect to " + c_ad.destination.to_string() );
+}
+
+void TCPMinnowStack::dispatch()
+{
+  // bound the work per wakeup so that a busy device can't keep the thread from noticing abort_
+  constexpr size_t max_batch = 256;
+
+  try {
+    DatagramDevice device { datagram_fd_.duplicate(), max_batch };
+    EventLoop eventloop;
+    vector<Ref<string>> datagrams;
+    vector<bool> woken( workers_.size() );
+
+    eventloop.add_rule( "dispatch datagrams to workers", device.event_fd(), Direction::In, [&] {
+      // drop the datagrams the workers have handled, so that their buffers go back to the device's pool
+      for ( const auto& worker : workers_ ) {
+        while ( worker->handled() ) {}
+      }
+
+      device.read( datagrams );
+
+      for ( auto& datagram : datagrams ) {
+        const auto key = peek_flow( datagram );
+        if ( not key ) {
+          continue;
+        }
+
+        const size_t index = FlowKeyHash {}( *key ) % workers_.size();
+        // a full queue drops the datagram, as a busy link would
+        if ( workers_[index]->deliver( move( datagram ) ) ) {
+          woken[index] = true;
+        }
+      }
+      datagrams.clear(); // the datagrams that weren't delivered
+
+      // wake each worker once per batch
+      for ( size_t i = 0; i < workers_.size(); i++ ) {
+        if ( woken[i] ) {
+          workers_[i]->ring();
+          woken[i] = false;
+        }
+      }
+    } );
+
+    while ( not abort_ ) {
+      eventloop.wait_next_event( ABORT_CHECK_MS );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception in TCPMinnowStack dispatcher: " << e.what() << "\n";
+  }
+
+  stop();
+}
+
+TCPMinnowStack::Worker::Worker( TCPMinnowStack& stack, FileDescriptor&& datagram_fd, const bool reads_device )
+  : Worker( stack, local_stream_socket_pair(), move( datagram_fd ), reads_device )
+{}
+
+//! \param[in] stack is the stack that owns the worker
+//! \param[in] doorbell_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
+//! \param[in] datagram_fd is the worker's descriptor for the device
+//! \param[in] reads_device is whether the worker reads datagrams from `datagram_fd` (or only from the dispatcher)
+TCPMinnowStack::Worker::Worker( TCPMinnowStack& stack,
+                                pair<LocalStreamSocket, LocalStreamSocket> doorbell_pair,
+                                FileDescriptor&& datagram_fd,
+                                const bool reads_device )
+  : stack_( stack )
+  , device_( move( datagram_fd ), reads_device ? READ_DEPTH : 0 )
+  , doorbell_( move( doorbell_pair.first ) )
+  , doorbell_ring_( move( doorbell_pair.second ) )
+  , inbound_( INBOUND_QUEUE_CAPACITY )
+  , handled_( INBOUND_QUEUE_CAPACITY )
+  , rand_( get_random_engine() )
+  , doorbell_category_( eventloop_.add_category( "run commands and queued datagrams" ) )
+  , datagram_category_( eventloop_.add_category( "receive TCP segment from the network" ) )
+  , backlog_category_( eventloop_.add_category( "write queued datagrams to the network" ) )
+  , timer_category_( eventloop_.add_category( "TCPPeer timeout" ) )
+  , push_category_( eventloop_.add_category( "push bytes to TCPPeer" ) )
+  , inbound_category_( eventloop_.add_category( "read bytes from inbound stream" ) )
+{
+  doorbell_.set_blocking( false );
+
+  eventloop_.add_rule( doorbell_category_, doorbell_, Direction::In, [&] {
+    // consume the ring, then clear the flag before draining, so a datagram queued from now on rings again
+    string bytes;
+    doorbell_.read( bytes );
+    rung_ = false;
+
+    vector<function<void()>> commands;
+    {
+      const lock_guard lock { mutex_ };
+      swap( commands, commands_ );
+    }
+    for ( auto& command : commands ) {
+      command();
+    }
+
+    // each datagram goes back to the dispatcher (which alone may drop it, as its buffer is from the
+    // dispatcher's pool); any that don't fit in the queue wait to be sent back after the next round
+    while ( not unreturned_.empty() and handled_.push( move( unreturned_.back() ) ) ) {
+      unreturned_.pop_back();
+    }
+    while ( auto datagram = inbound_.pop() ) {
+      receive_datagram( *datagram );
+      if ( not handled_.push( move( *datagram ) ) ) {
+        unreturned_.push_back( move( *datagram ) );
+      }
+    }
+  } );
+
+  // with io_uring, a worker that doesn't read the device still collects its finished writes
+  if ( reads_device or device_.backend() == DatagramDevice::Backend::IOUring ) {
+    eventloop_.add_rule( datagram_category_, device_.event_fd(), Direction::In, [&] {
+      device_.read( datagrams_ );
+      for ( const auto& datagram : datagrams_ ) {
+        receive_datagram( datagram );
+      }
+      datagrams_.clear();
+    } );
+  }
+
+  // without io_uring, datagrams the device couldn't take wait for it to become writable
+  eventloop_.add_rule(
+    backlog_category_,
+    device_.fd(),
+    Direction::Out,
+    [&] { device_.flush(); },
+    [&] { return device_.write_pending(); } );
+
+  thread_ = thread( &Worker::loop, this );
+}
+
+TCPMinnowStack::Worker::~Worker()
+{
+  try {
+    ring();
+    if ( thread_.joinable() ) {
+      thread_.join();
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception destructing TCPMinnowStack worker: " << e.what() << "\n";
+  }
+}
+
+void TCPMinnowStack::Worker::ring()
+{
+  const lock_guard lock { mutex_ };
+  if ( not rung_.exchange( true ) ) {
+    doorbell_ring_.write( "!" );
+  }
+}
+
+void TCPMinnowStack::Worker::post( function<void()>&& command )
+{
+  {
+    const lock_guard lock { mutex_ };
+    commands_.push_back( move( command ) );
+  }
+  ring();
+}
+
+void TCPMinnowStack::Worker::connect( const TCPConfig& c_tcp,
+                                      const FlowKey& key,
+                                      const shared_ptr<PendingConnect>& pending,
+                                      LocalStreamSocket&& thread_data )
+{
+  post( [this, c_tcp, key, pending, thread_data = make_shared<LocalStreamSocket>( move( thread_data ) )] {
+    if ( connections_.contains( key ) ) {
+      const lock_guard lock { stack_.mutex_ };
+      pending->done = pending->port_in_use = true;
+      stack_.cv_.notify_all();
+      return;
+    }
+
+    auto connection = add_connection( key, c_tcp, move( *thread_data ) );
+    connection->pending_connect = pending;
+    tick( *connection );
+    connection->peer.push( [&]( auto x ) { transmit( key, x ); } );
+    update_state( connection ); // arms the timer that retransmits the SYN
+  } );
+}
+
+void TCPMinnowStack::Worker::receive_datagram( const string_view datagram )
+{
+  // the datagram is in one piece, so its headers are parsed in place (only the payload is copied)
+  SpanParser parser { datagram };
+  IPv4Header header;
+  header.parse( parser );
+  if ( parser.has_error() or header.proto != IPv4Header::PROTO_TCP ) {
+    return;
+  }
+  parser.truncate( header.payload_length() );
+
+  TCPSegment seg;
+  seg.parse( parser, header.pseudo_checksum() );
+  if ( parser.has_error() ) {
+    return;
+  }
+
+  const FlowKey key { header.dst, seg.udinfo.dst_port, header.src, seg.udinfo.src_port };
+
+  shared_ptr<Connection> connection;
+  if ( const auto* found = connections_.find( key ) ) {
+    connection = *found;
+  } else {
+    // only a SYN to a listening port (with room in its backlog) can start a new connection
+    if ( not seg.message.sender->SYN or seg.message.sender->RST ) {
+      return;
+    }
+
+    TCPConfig config;
+    {
+      const lock_guard lock { stack_.mutex_ };
+      const auto listener = stack_.listeners_.find( key.local_port );
+      if ( listener == stack_.listeners_.end() or ( listener->second.ip and listener->second.ip != key.local_ip )
+           or listener->second.in_progress + listener->second.ready.size() >= listener->second.backlog ) {
+        return;
+      }
+      ++listener->second.in_progress;
+      config = listener->second.config;
+    }
+
+    auto [owner_end, stack_end] = local_stream_socket_pair();
+    connection = add_connection( key, config, move( stack_end ) );
+    connection->owner_end.emplace( move( owner_end ) );
+  }
+
+  tick( *connection );
+  connection->peer.receive( move( seg.message ), [&]( auto x ) { transmit( key, x ); } );
+  update_state( connection );
+}
+
+shared_ptr<TCPMinnowStack::Connection> TCPMinnowStack::Worker::add_connection( const FlowKey& key,
+                                                                               const TCPConfig& config,
+                                                                               LocalStreamSocket&& thread_data )
+{
+  TCPConfig connection_config = config;
+  connection_config.isn = Wrap32 { static_cast<uint32_t>( rand_() ) };
+
+  auto connection = make_shared<Connection>( key, connection_config, move( thread_data ) );
+  connection->thread_data.set_blocking( false );
+  connections_.try_emplace( key, connection );
+  connection_count_ = connections_.size();
+
+  // read from the owner's writes into the outbound stream
+  connection->rules.push_back( eventloop_.add_rule(
+    push_category_,
+    connection->thread_data,
+    Direction::In,
+    [this, connection] {
+      auto& c = *connection;
+      string data;
+      data.resize( c.peer.outbound_writer().available_capacity() );
+      c.thread_data.read( data );
+      c.peer.outbound_writer().push( move( data ) );
+
+      if ( c.thread_data.eof() ) {
+        c.peer.outbound_writer().close();
+        c.outbound_shutdown = true;
+      }
+
+      tick( c );
+      c.peer.push( [&]( auto x ) { transmit( c.key, x ); } );
+      update_state( connection );
+    },
+    [connection] {
+      auto& c = *connection;
+      return c.established and c.peer.active() and not c.outbound_shutdown
+             and c.peer.outbound_writer().available_capacity() > 0;
+    },
+    [this, connection] {
+      connection->peer.outbound_writer().close();
+      connection->outbound_shutdown = true;
+      tick( *connection );
+      connection->peer.push( [&]( auto x ) { transmit( connection->key, x ); } );
+      update_state( connection );
+    },
+    [connection] { connection->peer.outbound_writer().set_error(); } ) );
+
+  // write from the inbound stream to the owner
+  connection->rules.push_back( eventloop_.add_rule(
+    inbound_category_,
+    connection->thread_data,
+    Direction::Out,
+    [this, connection] {
+      auto& c = *connection;
+      Reader& inbound = c.peer.inbound_reader();
+      if ( inbound.bytes_buffered() ) {
+        inbound.pop( c.thread_data.write( inbound.peek() ) );
+      }
+
+      if ( inbound.is_finished() or inbound.has_error() ) {
+        c.thread_data.shutdown( SHUT_WR );
+        c.inbound_shutdown = true;
+      }
+      update_state( connection );
+    },
+    [connection] {
+      const Reader& inbound = connection->peer.inbound_reader();
+      return inbound.bytes_buffered()
+             or ( ( inbound.is_finished() or inbound.has_error() ) and not connection->inbound_shutdown );
+    },
+    [this, connection] {
+      connection->inbound_shutdown = true;
+      update_state( connection );
+    },
+    [connection] { connection->peer.inbound_reader().set_error(); } ) );
+
+  return connection;
+}
+
+void TCPMinnowStack::Worker::transmit( const FlowKey& key, const TCPMessage& msg )
+{
+  TCPSegment seg { .message = { msg.sender.borrow(), msg.receiver.borrow() },
+                   .udinfo = { key.local_port, key.remote_port, 0 } };
+
+  IPv4Header header;
+  header.src = key.local_ip;
+  header.dst = key.remote_ip;
+  header.len = header.hlen * 4 + TCPSegment::HEADER_LENGTH + msg.sender->payload.size();
+
+  seg.compute_checksum( header.pseudo_checksum() );
+  header.compute_checksum();
+
+  // the headers are written into the serializer and the payload is referred to, so nothing is allocated
+  // (if too many datagrams are waiting for the device, the datagram is dropped)
+  HeaderSerializer serializer;
+  header.serialize( serializer );
+  seg.serialize( serializer );
+  device_.write( serializer.finish() );
+}
+
+void TCPMinnowStack::Worker::update_state( const shared_ptr<Connection>& connection )
+{
+  auto& c = *connection;
+  if ( c.finished ) {
+    return;
+  }
+
+  if ( not c.established and c.peer.active() and c.peer.has_ackno()
+       and c.peer.sender().sequence_numbers_in_flight() == 0 ) {
+    c.established = true;
+
+    const lock_guard lock { stack_.mutex_ };
+    if ( c.pending_connect ) {
+      c.pending_connect->done = c.pending_connect->succeeded = true;
+    } else if ( const auto listener = stack_.listeners_.find( c.key.local_port );
+                listener != stack_.listeners_.end() ) {
+      --listener->second.in_progress;
+      listener->second.ready.emplace_back( move( c.owner_end.value() ),
+                                           to_address( c.key.local_ip, c.key.local_port ),
+                                           to_address( c.key.remote_ip, c.key.remote_port ) );
+      c.owner_end.reset();
+    }
+    stack_.cv_.notify_all();
+  }
+
+  // a connection is finished once TCP is done with it and the owner has seen the end of the inbound stream
+  if ( not c.peer.active() and ( c.inbound_shutdown or not c.established ) ) {
+    c.finished = true;
+    finished_.push_back( connection );
+    return;
+  }
+
+  arm_timer( connection );
+}
+
+void TCPMinnowStack::Worker::tick( Connection& connection )
+{
+  const auto next_time = timestamp_ms();
+  if ( connection.peer.active() ) {
+    connection.peer.tick( next_time - connection.last_tick_ms,
+                          [&]( auto x ) { transmit( connection.key, x ); } );
+
+    // give up on a peer that has gone unanswered for too many retransmissions (this ends the connection)
+    if ( connection.peer.sender().consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS ) {
+      connection.peer.outbound_writer().set_error();
+      connection.peer.inbound_reader().set_error();
+    }
+  }
+  connection.last_tick_ms = next_time;
+}
+
+void TCPMinnowStack::Worker::arm_timer( const shared_ptr<Connection>& connection )
+{
+  auto& c = *connection;
+  optional<uint64_t> deadline;
+  if ( const auto remaining = c.peer.time_until_next_timeout() ) {
+    deadline = c.last_tick_ms + *remaining;
+  }
+
+  // A timer due no later than needed can stay (when it fires, the tick finds nothing due and this re-arms it),
+  // so a timeout pushed back by every acknowledgment doesn't replace the timer each time.
+  if ( not deadline.has_value()
+       or ( c.timer_deadline_ms.has_value() and *c.timer_deadline_ms <= *deadline ) ) {
+    return;
+  }
+
+  if ( c.timer.has_value() ) {
+    c.timer->cancel();
+  }
+
+  const auto now = timestamp_ms();
+  c.timer_deadline_ms = deadline;
+  c.timer = eventloop_.add_timer_rule( timer_category_, *deadline > now ? *deadline - now : 0, [this, connection] {
+    connection->timer_deadline_ms.reset();
+    tick( *connection );
+    update_state( connection );
+  } );
+}
+
+void TCPMinnowStack::Worker::remove_finished()
+{
+  for ( const auto& connection : finished_ ) {
+    auto& c = *connection;
+    for ( auto& rule : c.rules ) {
+      rule.cancel();
+    }
+    if ( c.timer.has_value() ) {
+      c.timer->cancel();
+    }
+    c.thread_data.close();
+    connections_.erase( c.key );
+
+    if ( not c.established ) {
+      const lock_guard lock { stack_.mutex_ };
+      if ( c.pending_connect ) {
+        c.pending_connect->done = true;
+        stack_.cv_.notify_all();
+      } else if ( const auto listener = stack_.listeners_.find( c.key.local_port );
+                  listener != stack_.listeners_.end() ) {
+        --listener->second.in_progress;
+      }
+    }
+  }
+  finished_.clear();
+  connection_count_ = connections_.size();
+}
+
+void TCPMinnowStack::Worker::loop()
+{
+  try {
+    // each connection's timeouts are timer rules, so the loop sleeps until an event or the next timeout
+    // (the stack rings the doorbell when it stops)
+    while ( not stack_.abort_ ) {
+      eventloop_.wait_next_event( -1 );
+      remove_finished();
+
+      // submit the datagrams written while serving this round of events together
+      device_.flush();
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception in TCPMinnowStack worker: " << e.what() << "\n";
+  }
+
+  stack_.stop();
+}
@@ -65,6 +65,11 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return timer_.get_retransmission_count();
 }
 
+optional<uint64_t> TCPSender::time_until_timeout() const
+{
+  return timer_.time_remaining();
+}
+
 void TCPSender::push( const TransmitFunction& transmit )
 {
   std::string_view input = input_.reader().peek();
@@ -90,8 +95,7 @@ void TCPSender::push( const TransmitFunction& transmit )
   }
   while ( sum < window_size && !input.empty() ) {
 
-    uint32_t len
-      = min( min( input.size(), TCPConfig::MAX_PAYLOAD_SIZE ), static_cast<size_t>( window_size - sum ) );
+    uint32_t len = min( min( input.size(), max_payload_size_ ), static_cast<size_t>( window_size - sum ) );
     auto payload = static_cast<string>( input.substr( 0, len ) );
     uint64_t checkpoint = input_.reader().bytes_popped();
     TCPSenderMessage message;
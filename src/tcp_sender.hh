@@ -2,10 +2,12 @@
 
 #include "byte_stream.hh"
 #include "debug.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
 #include <functional>
+#include <optional>
 
 class Timer
 {
@@ -41,6 +43,16 @@ public:
 
   uint64_t get_retransmission_count() const { return retransmission_count; }
 
+  // Time until the timer expires, if it is running
+  std::optional<uint64_t> time_remaining() const
+  {
+    if ( !is_started ) {
+      return {};
+    }
+    const uint64_t elapsed = live_time - start_time;
+    return RTO_ms > elapsed ? RTO_ms - elapsed : 0;
+  }
+
 private:
   std::map<uint64_t, TCPSenderMessage> message_ {};
   Wrap32 isn;
@@ -56,8 +68,15 @@ class TCPSender
 {
 public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
-  TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms )
-    : input_( std::move( input ) ), isn_( isn ), initial_RTO_ms_( initial_RTO_ms ), timer_( isn )
+  TCPSender( ByteStream&& input,
+             Wrap32 isn,
+             uint64_t initial_RTO_ms,
+             size_t max_payload_size = TCPConfig::MAX_PAYLOAD_SIZE )
+    : input_( std::move( input ) )
+    , isn_( isn )
+    , initial_RTO_ms_( initial_RTO_ms )
+    , max_payload_size_( max_payload_size )
+    , timer_( isn )
   {}
 
   /* Generate an empty TCPSenderMessage */
@@ -78,6 +97,7 @@ public:
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // For testing: how many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // For testing: how many consecutive retransmissions have happened?
+  std::optional<uint64_t> time_until_timeout() const; // How many ms until tick() will retransmit (if ever)?
   const Writer& writer() const { return input_.writer(); }
   const Reader& reader() const { return input_.reader(); }
   Writer& writer() { return input_.writer(); }
@@ -88,6 +108,7 @@ private:
   ByteStream input_;
   Wrap32 isn_;
   uint64_t initial_RTO_ms_;
+  size_t max_payload_size_;
   Timer timer_;
   uint16_t window_size_ = 1; // The size of the window
   uint64_t expect_ackno = 0; // The expected ackno
@@ -0,0 +1,199 @@
+#include "checksum.hh"
+#include "helpers.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+//! The original byte-at-a-time implementation, as the reference
+class ReferenceChecksum
+{
+  uint32_t sum_;
+  bool parity_ {};
+
+public:
+  explicit ReferenceChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
+
+  void add( string_view data )
+  {
+    for ( const uint8_t i : data ) {
+      uint16_t val = i;
+      if ( not parity_ ) {
+        val <<= 8;
+      }
+      sum_ += val;
+      parity_ = !parity_;
+    }
+  }
+
+  uint16_t value() const
+  {
+    uint32_t ret = sum_;
+    while ( ret > 0xffff ) {
+      ret = ( ret >> 16 ) + static_cast<uint16_t>( ret );
+    }
+    return ~ret;
+  }
+};
+
+vector<InternetChecksum::Kernel> supported_kernels()
+{
+  vector<InternetChecksum::Kernel> kernels;
+  for ( const auto kernel : { InternetChecksum::Kernel::Scalar, InternetChecksum::Kernel::AVX2 } ) {
+    if ( InternetChecksum::supported( kernel ) ) {
+      kernels.push_back( kernel );
+    }
+  }
+  return kernels;
+}
+
+string random_bytes( default_random_engine& rd, const size_t length )
+{
+  uniform_int_distribution<int> byte { 0, 255 };
+  string ret( length, 0 );
+  for ( auto& c : ret ) {
+    c = static_cast<char>( byte( rd ) );
+  }
+  return ret;
+}
+
+// every kernel sums every length and (mis)alignment the same way
+void test_kernels( default_random_engine& rd )
+{
+  const string data = random_bytes( rd, 4096 );
+  for ( size_t offset = 0; offset < 40; offset++ ) {
+    for ( size_t length = 0; offset + length <= data.size(); length += 1 + length / 8 ) {
+      const string_view piece = string_view { data }.substr( offset, length );
+      const uint16_t expected = InternetChecksum::sum( piece, InternetChecksum::Kernel::Scalar );
+      for ( const auto kernel : supported_kernels() ) {
+        if ( InternetChecksum::sum( piece, kernel ) != expected ) {
+          throw runtime_error( "kernels disagree at offset " + to_string( offset ) + ", length "
+                               + to_string( length ) );
+        }
+
+        // copying to a (differently misaligned) destination gives the same sum, and exactly the same bytes
+        string copy( length + 8, '#' );
+        if ( InternetChecksum::copy_and_sum( copy.data() + 3, piece, kernel ) != expected
+             or copy != "###" + string { piece } + "#####" ) {
+          throw runtime_error( "copy_and_sum is wrong at offset " + to_string( offset ) + ", length "
+                               + to_string( length ) );
+        }
+      }
+    }
+  }
+}
+
+// all-ones buffers long enough to overflow the vector lanes if they weren't flushed
+void test_long_buffers()
+{
+  for ( const size_t length : { size_t { 1 } << 20, ( size_t { 3 } << 20 ) + 37 } ) {
+    const string data( length, '\xff' );
+    // words of 0xffff sum to 0xffff, and a final odd byte (padded to 0xff00) brings the folded sum to 0xff00
+    const uint16_t expected = length % 2 ? 0xff00 : 0xffff;
+    for ( const auto kernel : supported_kernels() ) {
+      if ( InternetChecksum::sum( data, kernel ) != expected ) {
+        throw runtime_error( "wrong sum for " + to_string( length ) + " bytes of 0xff" );
+      }
+    }
+  }
+}
+
+// random data, split into pieces at random (often odd) boundaries, with a random starting sum
+void test_against_reference( default_random_engine& rd )
+{
+  for ( size_t trial = 0; trial < 20000; trial++ ) {
+    const uint32_t initial = uniform_int_distribution<uint32_t> { 0, trial % 2 ? 0xffff : UINT32_MAX / 2 }( rd );
+    const string data = random_bytes( rd, uniform_int_distribution<size_t> { 0, 3000 }( rd ) );
+
+    ReferenceChecksum reference { initial };
+    InternetChecksum check { initial };
+    string copy( data.size(), 0 );
+    for ( size_t offset = 0; offset < data.size(); ) {
+      const size_t length = uniform_int_distribution<size_t> { 0, min<size_t>( 100, data.size() - offset ) }( rd );
+      reference.add( string_view { data }.substr( offset, length ) );
+      // pieces are added either as they are, or while being copied
+      if ( length % 3 ) {
+        check.add( string_view { data }.substr( offset, length ) );
+        copy.replace( offset, length, data, offset, length );
+      } else {
+        check.add_and_copy( string_view { data }.substr( offset, length ), copy.data() + offset );
+      }
+      offset += length;
+    }
+
+    if ( reference.value() != check.value() ) {
+      throw runtime_error( "checksum of " + to_string( data.size() ) + " bytes differs from the reference" );
+    }
+    if ( copy != data ) {
+      throw runtime_error( "add_and_copy copied the wrong bytes" );
+    }
+  }
+}
+
+// a segment serialized with its checksum in one pass matches one checksummed and serialized separately
+void test_tcp_segment( default_random_engine& rd )
+{
+  for ( const size_t length : { 0, 1, 255, 256, 1000, 1459 } ) {
+    TCPSegment seg;
+    seg.udinfo = { 1234, 80, 0 };
+    seg.message.sender = TCPSenderMessage { .seqno = Wrap32 { 7 }, .payload = random_bytes( rd, length ) };
+    seg.message.receiver = TCPReceiverMessage { .ackno = Wrap32 { 99 }, .window_size = 4096 };
+    const uint32_t pseudo = uniform_int_distribution<uint32_t> { 0, 0x3ffff }( rd );
+
+    TCPSegment reference = seg;
+    reference.compute_checksum( pseudo );
+    const string fused = seg.serialize_with_checksum( pseudo );
+    if ( fused != concat( serialize( reference ) ) or seg.udinfo.cksum != reference.udinfo.cksum ) {
+      throw runtime_error( "serialize_with_checksum differs for a " + to_string( length ) + "-byte payload" );
+    }
+
+    TCPSegment parsed;
+    if ( not parse( parsed, vector<string> { fused }, pseudo )
+         or parsed.message.sender->payload != seg.message.sender->payload ) {
+      throw runtime_error( "serialize_with_checksum produced a segment that doesn't parse" );
+    }
+
+    // a device finishing a partial checksum (summing from the start of the segment) gets the same checksum
+    string partial = seg.serialize_with_partial_checksum( pseudo );
+    const uint16_t finished = InternetChecksum::sum( partial ) ^ 0xffff;
+    partial[TCPSegment::CHECKSUM_OFFSET] = static_cast<char>( finished >> 8 );
+    partial[TCPSegment::CHECKSUM_OFFSET + 1] = static_cast<char>( finished & 0xff );
+    if ( partial != fused ) {
+      throw runtime_error( "serialize_with_partial_checksum differs for a " + to_string( length )
+                           + "-byte payload" );
+    }
+
+    // a corrupt segment only parses if its checksum isn't verified
+    string corrupt = fused;
+    corrupt.back() ^= 1;
+    if ( length > 0
+         and ( parse( parsed, vector<string> { corrupt }, pseudo )
+               or not parse( parsed, vector<string> { corrupt }, pseudo, false ) ) ) {
+      throw runtime_error( "wrong checksum verification of a corrupt segment" );
+    }
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    default_random_engine rd { 1071 };
+    test_kernels( rd );
+    test_long_buffers();
+    test_against_reference( rd );
+    test_tcp_segment( rd );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include "checksum.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+// with `copy`, each round also copies the buffer (in the same pass)
+double speed_test( fstream& debug_output,
+                   const InternetChecksum::Kernel kernel,
+                   const size_t buffer_size,
+                   const bool copy )
+{
+  constexpr size_t total_bytes = size_t { 1 } << 30;
+  const size_t rounds = total_bytes / buffer_size;
+
+  default_random_engine rd { 1624 };
+  uniform_int_distribution<int> byte { 0, 255 };
+  string buffer( buffer_size, 0 );
+  for ( auto& c : buffer ) {
+    c = static_cast<char>( byte( rd ) );
+  }
+  string destination( buffer_size, 0 );
+
+  // fold the results together so the sums can't be optimized away
+  uint32_t folded = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    folded += copy ? InternetChecksum::copy_and_sum( destination.data(), buffer, kernel )
+                   : InternetChecksum::sum( buffer, kernel );
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( folded == 1 ) {
+    cerr << "(unlikely sum)\n";
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const auto gigabytes_per_second = static_cast<double>( rounds * buffer_size ) / test_duration.count() / 1e9;
+  const string name = string { kernel == InternetChecksum::Kernel::AVX2 ? "AVX2" : "scalar" }
+                      + ( copy ? ", copying" : "" );
+
+  cout << "InternetChecksum (" << name << ") with buffer_size=" << buffer_size << " reached " << fixed
+       << setprecision( 2 ) << gigabytes_per_second << " GB/s.\n";
+
+  debug_output << "   InternetChecksum (" << name << ") throughput (" << setw( 5 ) << buffer_size
+               << " bytes): " << fixed << setprecision( 2 ) << setw( 6 ) << gigabytes_per_second << " GB/s\n";
+
+  if ( gigabytes_per_second < 0.1 ) {
+    throw runtime_error( "InternetChecksum did not meet minimum speed of 0.1 GB/s" );
+  }
+
+  return gigabytes_per_second;
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  for ( const auto kernel : { InternetChecksum::Kernel::Scalar, InternetChecksum::Kernel::AVX2 } ) {
+    if ( not InternetChecksum::supported( kernel ) ) {
+      continue;
+    }
+    for ( const bool copy : { false, true } ) {
+      for ( const size_t buffer_size : { 20, 64, 576, 1500, 9000, 65536 } ) {
+        speed_test( debug_output, kernel, buffer_size, copy );
+      }
+    }
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include "datagram_device.hh"
+
+#include "eventloop.hh"
+#include "exception.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+pair<FileDescriptor, FileDescriptor> datagram_socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_SEQPACKET, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+void test_backend( const DatagramDevice::Backend backend )
+{
+  constexpr size_t num_datagrams = 100;
+
+  auto [a, b] = datagram_socket_pair();
+  DatagramDevice sender { move( a ), 0, backend };
+  DatagramDevice receiver { move( b ), 8, backend };
+
+  if ( sender.backend() != backend or receiver.backend() != backend ) {
+    throw runtime_error( "DatagramDevice did not use the requested backend" );
+  }
+
+  // datagrams of different lengths, written in bursts of ten (each burst submitted together)
+  vector<string> expected;
+  for ( size_t i = 0; i < num_datagrams; i++ ) {
+    expected.push_back( "datagram " + to_string( i ) + string( i * 37 % 1500, 'x' ) );
+    sender.write( { string { expected.back() } } );
+    if ( i % 10 == 9 ) {
+      sender.flush();
+    }
+  }
+
+  vector<Ref<string>> received;
+  EventLoop eventloop;
+  eventloop.add_rule( "read datagrams", receiver.event_fd(), Direction::In, [&] {
+    const size_t before = received.size();
+    receiver.read( received );
+    if ( received.size() - before > 8 ) {
+      throw runtime_error( "DatagramDevice::read returned more than read_depth datagrams" );
+    }
+  } );
+
+  while ( received.size() < num_datagrams ) {
+    if ( eventloop.wait_next_event( 1000 ) != EventLoop::Result::Success ) {
+      throw runtime_error( "DatagramDevice: timed out after " + to_string( received.size() ) + " datagrams" );
+    }
+  }
+
+  // with io_uring, reads (and writes) in flight together may finish in any order
+  vector<string> received_strings;
+  for ( const auto& datagram : received ) {
+    received_strings.emplace_back( datagram.get() );
+  }
+  ranges::sort( expected );
+  ranges::sort( received_strings );
+  if ( expected != received_strings ) {
+    throw runtime_error( "DatagramDevice received different datagrams than were sent" );
+  }
+
+  if ( sender.dropped() or receiver.dropped() ) {
+    throw runtime_error( "DatagramDevice dropped datagrams" );
+  }
+
+  // once handled datagrams are dropped, a steady stream of them reuses the same buffers
+  size_t allocated_after_first_round = 0;
+  for ( size_t round = 0; round < 50; round++ ) {
+    for ( size_t i = 0; i < 8; i++ ) {
+      sender.write( { "round " + to_string( round ) + string( i * 100, 'y' ) } );
+    }
+    sender.flush();
+
+    received.clear();
+    while ( received.size() < 8 ) {
+      if ( eventloop.wait_next_event( 1000 ) != EventLoop::Result::Success ) {
+        throw runtime_error( "DatagramDevice: timed out in round " + to_string( round ) );
+      }
+    }
+    received.clear();
+
+    if ( round == 0 ) {
+      allocated_after_first_round = receiver.pool().allocated();
+    } else if ( receiver.pool().allocated() != allocated_after_first_round ) {
+      throw runtime_error( "DatagramDevice allocated buffers in a steady state" );
+    }
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_backend( DatagramDevice::Backend::Syscalls );
+    if ( IOUring::supported() ) {
+      test_backend( DatagramDevice::Backend::IOUring );
+    } else {
+      cerr << "io_uring is not available; skipping its tests\n";
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include "double_buffered.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// an update changes both halves, so a reader that ever sees them differ has seen an update in progress
+struct Pair
+{
+  uint64_t first {};
+  uint64_t second {};
+};
+
+void test_update_and_read()
+{
+  DoubleBuffered<Pair> pair;
+  pair.update( []( Pair& p ) { p.first = p.second = 7; } );
+  if ( pair.read()->first != 7 or pair.read()->second != 7 ) {
+    throw runtime_error( "update did not reach the current copy" );
+  }
+  pair.update( []( Pair& p ) { p.first = p.second = 8; } );
+  if ( pair.read()->first != 8 ) {
+    throw runtime_error( "second update did not reach the current copy" );
+  }
+}
+
+void test_concurrent()
+{
+  constexpr uint64_t updates = 20000;
+  DoubleBuffered<Pair> pair;
+  atomic<bool> done = false;
+  atomic<bool> torn = false;
+
+  vector<thread> readers;
+  for ( size_t i = 0; i < 2; i++ ) {
+    readers.emplace_back( [&] {
+      uint64_t last_seen = 0;
+      while ( not done ) {
+        const auto guard = pair.read();
+        const uint64_t first = guard->first;
+        this_thread::yield(); // give the writer a chance to change the copy this reader is using
+        if ( guard->second != first or first < last_seen ) {
+          torn = true;
+        }
+        last_seen = first;
+      }
+    } );
+  }
+
+  for ( uint64_t n = 1; n <= updates; n++ ) {
+    pair.update( [n]( Pair& p ) {
+      p.first = n;
+      p.second = n;
+    } );
+  }
+  done = true;
+  for ( auto& reader : readers ) {
+    reader.join();
+  }
+
+  if ( torn ) {
+    throw runtime_error( "a reader saw a copy while it was being updated" );
+  }
+  if ( pair.read()->first != updates ) {
+    throw runtime_error( "expected " + to_string( updates ) + " updates" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_update_and_read();
+    test_concurrent();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+#include "eventloop.hh"
+#include "exception.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+//! Make sure the process may open `count` more file descriptors
+void reserve_fds( const size_t count )
+{
+  rlimit limit {};
+  CheckSystemCall( "getrlimit", getrlimit( RLIMIT_NOFILE, &limit ) );
+  if ( limit.rlim_cur < count + 64 ) {
+    limit.rlim_cur = min<rlim_t>( count + 64, limit.rlim_max );
+    CheckSystemCall( "setrlimit", setrlimit( RLIMIT_NOFILE, &limit ) );
+  }
+}
+
+double speed_test( fstream& debug_output,
+                   const EventLoop::Backend backend,
+                   const size_t num_fds,          // NOLINT(bugprone-easily-swappable-parameters)
+                   const size_t ready_per_round ) // NOLINT(bugprone-easily-swappable-parameters)
+{
+  constexpr size_t num_rounds = 200;
+
+  reserve_fds( 2 * num_fds );
+
+  // each rule reads a byte from one end of a socket pair; the test writes to the other ends
+  vector<FileDescriptor> readers;
+  vector<FileDescriptor> writers;
+  for ( size_t i = 0; i < num_fds; i++ ) {
+    array<int, 2> fds {};
+    CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+    readers.emplace_back( fds[0] );
+    writers.emplace_back( fds[1] );
+  }
+
+  EventLoop eventloop { backend };
+  const size_t category = eventloop.add_category( "read byte" );
+  size_t events_served = 0;
+  for ( auto& reader : readers ) {
+    eventloop.add_rule( category, reader, Direction::In, [&] {
+      string buffer;
+      reader.read( buffer );
+      events_served += buffer.size();
+    } );
+  }
+
+  default_random_engine rd { 789 };
+  uniform_int_distribution<size_t> which_fd { 0, num_fds - 1 };
+
+  const auto start_time = steady_clock::now();
+  for ( size_t round = 0; round < num_rounds; round++ ) {
+    const size_t target = events_served + ready_per_round;
+    for ( size_t i = 0; i < ready_per_round; i++ ) {
+      writers.at( which_fd( rd ) ).write( "x" );
+    }
+    while ( events_served < target ) {
+      if ( eventloop.wait_next_event( 1000 ) != EventLoop::Result::Success ) {
+        throw runtime_error( "EventLoop did not find the ready file descriptors" );
+      }
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( events_served != num_rounds * ready_per_round ) {
+    throw runtime_error( "EventLoop served " + to_string( events_served ) + " bytes, expected "
+                         + to_string( num_rounds * ready_per_round ) );
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const auto events_per_second = static_cast<double>( events_served ) / test_duration.count();
+  const string name = backend == EventLoop::Backend::Epoll ? "epoll" : "poll ";
+
+  cout << "EventLoop (" << name << ") with fds=" << num_fds << ", ready per round=" << ready_per_round
+       << " served " << fixed << setprecision( 1 ) << events_per_second / 1e3 << " k events/s.\n";
+
+  debug_output << "   EventLoop (" << name << ") throughput (" << setw( 4 ) << num_fds << " fds): " << fixed
+               << setprecision( 1 ) << setw( 6 ) << events_per_second / 1e3 << " k events/s\n";
+
+  if ( events_per_second < 200 ) {
+    throw runtime_error( "EventLoop did not meet minimum speed of 200 events/s" );
+  }
+
+  return events_per_second;
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  for ( const size_t num_fds : { 1000, 4000 } ) {
+    speed_test( debug_output, EventLoop::Backend::Poll, num_fds, 16 );
+    speed_test( debug_output, EventLoop::Backend::Epoll, num_fds, 16 );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include "eventloop.hh"
+#include "exception.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+void expect( const bool condition, const string& description )
+{
+  if ( not condition ) {
+    throw runtime_error( "EventLoop timers: " + description );
+  }
+}
+
+void test_backend( const EventLoop::Backend backend )
+{
+  const string name = backend == EventLoop::Backend::Epoll ? "epoll: " : "poll: ";
+
+  // one-shot and periodic timers, with no fds to watch
+  {
+    EventLoop eventloop { backend };
+    const size_t category = eventloop.add_category( "timer" );
+
+    const auto start = steady_clock::now();
+    steady_clock::time_point fired_at;
+    steady_clock::time_point first_periodic_at;
+    size_t one_shot_calls = 0;
+    size_t periodic_calls = 0;
+    eventloop.add_timer_rule( category, 30, [&] {
+      ++one_shot_calls;
+      fired_at = steady_clock::now();
+    } );
+    auto periodic = eventloop.add_timer_rule(
+      category,
+      5,
+      [&] {
+        if ( periodic_calls++ == 0 ) {
+          first_periodic_at = steady_clock::now();
+        }
+      },
+      5 );
+
+    while ( one_shot_calls == 0 ) {
+      expect( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit, name + "exited with timers pending" );
+    }
+
+    // a loaded machine may skip periods, so only the order of the timers (and not how often the periodic one
+    // has fired) is certain
+    expect( fired_at - start >= milliseconds( 30 ), name + "one-shot timer fired early" );
+    expect( periodic_calls >= 1 and first_periodic_at <= fired_at,
+            name + "periodic timer did not fire before the later one-shot timer" );
+
+    // the periodic timer keeps firing (with a generous bound on how long that takes)
+    while ( periodic_calls < 5 ) {
+      expect( eventloop.wait_next_event( -1 ) != EventLoop::Result::Exit, name + "exited with timers pending" );
+      expect( steady_clock::now() - start < seconds( 10 ), name + "periodic timer stopped firing" );
+    }
+
+    // once the periodic timer is cancelled, nothing is left to wait for
+    periodic.cancel();
+    expect( eventloop.wait_next_event( -1 ) == EventLoop::Result::Exit, name + "did not exit without rules" );
+    expect( one_shot_calls == 1, name + "one-shot timer fired more than once" );
+  }
+
+  // a timer cuts a wait on an idle fd short, and a cancelled timer never fires
+  {
+    array<int, 2> fds {};
+    CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+    FileDescriptor reader { fds[0] };
+    const FileDescriptor writer { fds[1] };
+
+    EventLoop eventloop { backend };
+    eventloop.add_rule( "read", reader, Direction::In, [&] {
+      string buffer;
+      reader.read( buffer );
+    } );
+
+    bool fired = false;
+    bool cancelled_fired = false;
+    const size_t category = eventloop.add_category( "timer" );
+    eventloop.add_timer_rule( category, 20, [&] { cancelled_fired = true; } ).cancel();
+    eventloop.add_timer_rule( category, 10, [&] { fired = true; } );
+
+    const auto start = steady_clock::now();
+    const auto result = eventloop.wait_next_event( 2000 );
+    expect( steady_clock::now() - start < milliseconds( 1000 ), name + "timer did not end the wait" );
+    expect( result == EventLoop::Result::Success and fired, name + "timer did not fire" );
+
+    expect( eventloop.wait_next_event( 50 ) == EventLoop::Result::Timeout, name + "expected a timeout" );
+    expect( not cancelled_fired, name + "cancelled timer fired" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_backend( EventLoop::Backend::Poll );
+    test_backend( EventLoop::Backend::Epoll );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+#include "flat_hash_map.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+// every key in the same place, so lookups must look past full groups and deleted slots
+struct CollidingHash
+{
+  size_t operator()( const uint32_t key [[maybe_unused]] ) const { return 0x2a; }
+};
+
+template<typename Map>
+void check_same( Map& map, const unordered_map<uint32_t, string>& reference, const string& when )
+{
+  if ( map.size() != reference.size() ) {
+    throw runtime_error( when + ": size " + to_string( map.size() ) + " instead of "
+                         + to_string( reference.size() ) );
+  }
+  size_t visited = 0;
+  map.for_each( [&]( const uint32_t key, const string& value ) {
+    const auto it = reference.find( key );
+    if ( it == reference.end() or it->second != value ) {
+      throw runtime_error( when + ": unexpected entry for key " + to_string( key ) );
+    }
+    visited++;
+  } );
+  if ( visited != reference.size() ) {
+    throw runtime_error( when + ": for_each visited " + to_string( visited ) + " entries" );
+  }
+}
+
+void test_basic()
+{
+  FlatHashMap<uint32_t, string> map;
+  if ( not map.empty() or map.find( 7 ) != nullptr or map.erase( 7 ) ) {
+    throw runtime_error( "empty map has an entry" );
+  }
+
+  const auto [value, added] = map.try_emplace( 7, "seven" );
+  if ( not added or *value != "seven" or not map.contains( 7 ) or map.size() != 1 ) {
+    throw runtime_error( "try_emplace did not add an entry" );
+  }
+  const auto [again, added_again] = map.try_emplace( 7, "SEVEN" );
+  if ( added_again or *again != "seven" ) {
+    throw runtime_error( "try_emplace replaced an entry" );
+  }
+
+  map[8] = "eight";
+  map[7] += "!";
+  if ( *map.find( 7 ) != "seven!" or *map.find( 8 ) != "eight" or map.size() != 2 ) {
+    throw runtime_error( "operator[] did not find or add an entry" );
+  }
+
+  if ( not map.erase( 7 ) or map.contains( 7 ) or map.erase( 7 ) or map.size() != 1 ) {
+    throw runtime_error( "erase did not remove exactly one entry" );
+  }
+
+  map.clear();
+  if ( not map.empty() or map.contains( 8 ) ) {
+    throw runtime_error( "clear left an entry" );
+  }
+}
+
+// random additions and removals (from a small set of keys, so they often hit), compared with unordered_map
+template<typename Hash>
+void test_random( const string& name, const uint32_t max_key )
+{
+  default_random_engine rd { 59 };
+  uniform_int_distribution<uint32_t> key_dist { 0, max_key };
+  uniform_int_distribution<unsigned> op_dist { 0, 9 };
+
+  FlatHashMap<uint32_t, string, Hash> map;
+  unordered_map<uint32_t, string> reference;
+
+  for ( unsigned i = 0; i < 100'000; i++ ) {
+    const uint32_t key = key_dist( rd );
+    const unsigned op = op_dist( rd );
+    if ( op < 4 ) {
+      const string value = to_string( i );
+      if ( map.try_emplace( key, value ).second != reference.try_emplace( key, value ).second ) {
+        throw runtime_error( name + ": try_emplace disagreed about key " + to_string( key ) );
+      }
+    } else if ( op < 8 ) {
+      if ( map.erase( key ) != ( reference.erase( key ) == 1 ) ) {
+        throw runtime_error( name + ": erase disagreed about key " + to_string( key ) );
+      }
+    } else {
+      const string* value = map.find( key );
+      const auto it = reference.find( key );
+      if ( ( value == nullptr ) != ( it == reference.end() ) or ( value != nullptr and *value != it->second ) ) {
+        throw runtime_error( name + ": find disagreed about key " + to_string( key ) );
+      }
+    }
+
+    if ( i % 10'000 == 0 ) {
+      check_same( map, reference, name );
+    }
+  }
+  check_same( map, reference, name );
+
+  // copies and moves keep every entry
+  auto copy = map;
+  check_same( copy, reference, name + " (copy)" );
+  auto moved = std::move( copy );
+  check_same( moved, reference, name + " (moved)" );
+  copy = moved;
+  check_same( copy, reference, name + " (copy-assigned)" );
+}
+
+// values that can only be moved survive the table growing and entries being removed
+void test_move_only_values()
+{
+  FlatHashMap<uint32_t, unique_ptr<uint32_t>> map;
+  for ( uint32_t key = 0; key < 1000; key++ ) {
+    map.try_emplace( key, make_unique<uint32_t>( key * 3 ) );
+  }
+  for ( uint32_t key = 0; key < 1000; key += 2 ) {
+    map.erase( key );
+  }
+  for ( uint32_t key = 0; key < 1000; key++ ) {
+    const auto* value = map.find( key );
+    if ( ( value != nullptr ) != ( key % 2 == 1 ) or ( value != nullptr and **value != key * 3 ) ) {
+      throw runtime_error( "move-only value for key " + to_string( key ) + " was lost" );
+    }
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_basic();
+    test_random<FlatHash<uint32_t>>( "random", 3000 );
+    test_random<CollidingHash>( "colliding hashes", 300 );
+    test_move_only_values();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
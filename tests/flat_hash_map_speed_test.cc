@@ -0,0 +1,171 @@
+#include "flat_hash_map.hh"
+#include "tcp_minnow_stack.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t operations = 1 << 20;
+
+template<typename Key, typename Value, typename Hash>
+const Value* lookup( const unordered_map<Key, Value, Hash>& map, const Key& key )
+{
+  const auto it = map.find( key );
+  return it == map.end() ? nullptr : &it->second;
+}
+
+template<typename Key, typename Value, typename Hash>
+const Value* lookup( const FlatHashMap<Key, Value, Hash>& map, const Key& key )
+{
+  return map.find( key );
+}
+
+struct Rates
+{
+  double hits {};
+  double misses {};
+  double churn {};
+};
+
+template<typename Key>
+struct Keys
+{
+  vector<Key> present {}; // in the map
+  vector<Key> absent {};  // not in the map
+};
+
+// lookups of keys that are (and aren't) in the map, and removing keys and adding them back, in millions per second
+template<typename Map, typename Key>
+Rates measure( const Keys<Key>& keys )
+{
+  Map map;
+  for ( size_t i = 0; i < keys.present.size(); i++ ) {
+    map.try_emplace( keys.present[i], i );
+  }
+
+  default_random_engine rd { 61 };
+  uniform_int_distribution<size_t> index_dist { 0, keys.present.size() - 1 };
+  vector<size_t> order( operations );
+  for ( auto& index : order ) {
+    index = index_dist( rd );
+  }
+
+  const auto rate = [&]( auto&& operation ) {
+    const auto start_time = steady_clock::now();
+    size_t folded = 0; // so the lookups can't be optimized away
+    for ( size_t i = 0; i < operations; i++ ) {
+      folded += operation( i );
+    }
+    const auto seconds = duration_cast<duration<double>>( steady_clock::now() - start_time ).count();
+    if ( folded == 1 ) {
+      cerr << "(unlikely sum)\n";
+    }
+    return static_cast<double>( operations ) / seconds / 1e6;
+  };
+
+  Rates rates;
+  rates.hits = rate( [&]( const size_t i ) {
+    const auto* value = lookup( map, keys.present[order[i]] );
+    if ( value == nullptr ) {
+      throw runtime_error( "key not found" );
+    }
+    return *value;
+  } );
+  rates.misses = rate( [&]( const size_t i ) {
+    return lookup( map, keys.absent[order[i] % keys.absent.size()] ) == nullptr ? 0 : size_t { 1 };
+  } );
+  rates.churn = rate( [&]( const size_t i ) {
+    const Key& key = keys.present[order[i]];
+    map.erase( key );
+    map.try_emplace( key, i );
+    return map.size();
+  } );
+  return rates;
+}
+
+template<typename Key, typename Hash>
+void compare( fstream& debug_output, const string& name, const Keys<Key>& keys )
+{
+  const Rates flat = measure<FlatHashMap<Key, size_t, Hash>>( keys );
+  const Rates node = measure<unordered_map<Key, size_t, Hash>>( keys );
+
+  cout << fixed << setprecision( 1 ) << name << " (" << keys.present.size() << " entries): FlatHashMap "
+       << flat.hits << " / " << flat.misses << " / " << flat.churn << " M/s; std::unordered_map " << node.hits
+       << " / " << node.misses << " / " << node.churn << " M/s (hits / misses / erase+add).\n";
+
+  debug_output << "   " << name << " (" << setw( 6 ) << keys.present.size() << " entries), hits: " << fixed
+               << setprecision( 1 ) << setw( 6 ) << flat.hits << " vs " << setw( 6 ) << node.hits << " M/s\n";
+
+  if ( flat.hits < 5 or flat.misses < 5 or flat.churn < 1 ) {
+    throw runtime_error( "FlatHashMap did not meet minimum speed" );
+  }
+}
+
+// random IPv4 addresses, as in an ARP cache
+Keys<uint32_t> address_keys( const size_t count )
+{
+  default_random_engine rd { 67 };
+  uniform_int_distribution<uint32_t> address_dist;
+  unordered_set<uint32_t> seen;
+  Keys<uint32_t> keys;
+  while ( keys.absent.size() < count ) {
+    const uint32_t address = address_dist( rd );
+    if ( seen.insert( address ).second ) {
+      ( keys.present.size() < count ? keys.present : keys.absent ).push_back( address );
+    }
+  }
+  return keys;
+}
+
+// connections to one listening socket from random peers, as in a server's TCP demultiplexer
+Keys<FlowKey> flow_keys( const size_t count )
+{
+  default_random_engine rd { 71 };
+  uniform_int_distribution<uint32_t> address_dist;
+  uniform_int_distribution<uint16_t> port_dist { 1024 };
+  unordered_set<FlowKey, FlowKeyHash> seen;
+  Keys<FlowKey> keys;
+  while ( keys.absent.size() < count ) {
+    const FlowKey key { 0x0a000001, 443, address_dist( rd ), port_dist( rd ) };
+    if ( seen.insert( key ).second ) {
+      ( keys.present.size() < count ? keys.present : keys.absent ).push_back( key );
+    }
+  }
+  return keys;
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  for ( const size_t count : { 1 << 10, 1 << 16 } ) {
+    compare<uint32_t, FlatHash<uint32_t>>( debug_output, "IPv4 addresses", address_keys( count ) );
+    compare<FlowKey, FlowKeyHash>( debug_output, "TCP 4-tuples", flow_keys( count ) );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
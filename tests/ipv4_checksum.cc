@@ -0,0 +1,73 @@
+#include "ipv4_header.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+IPv4Header random_header( default_random_engine& rd )
+{
+  auto random = [&]( const uint32_t max ) { return uniform_int_distribution<uint32_t> { 0, max }( rd ); };
+
+  IPv4Header header;
+  header.tos = random( UINT8_MAX );
+  header.len = IPv4Header::LENGTH + random( 1480 );
+  header.id = random( UINT16_MAX );
+  header.df = random( 1 );
+  header.ttl = 2 + random( UINT8_MAX - 2 );
+  header.proto = random( UINT8_MAX );
+  header.src = random( UINT32_MAX );
+  header.dst = random( UINT32_MAX );
+  header.compute_checksum();
+  return header;
+}
+
+// the incrementally updated checksum must match a full recomputation
+void check( const IPv4Header& header, const string& operation )
+{
+  IPv4Header recomputed = header;
+  recomputed.compute_checksum();
+  if ( header.cksum != recomputed.cksum ) {
+    throw runtime_error( operation + " gave checksum " + to_string( header.cksum ) + ", expected "
+                         + to_string( recomputed.cksum ) + " for " + header.to_string() );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    default_random_engine rd { 1624 };
+    for ( size_t trial = 0; trial < 100000; trial++ ) {
+      IPv4Header header = random_header( rd );
+
+      header.decrement_ttl();
+      check( header, "decrement_ttl" );
+
+      header.rewrite_src( uniform_int_distribution<uint32_t> {}( rd ) );
+      check( header, "rewrite_src" );
+
+      header.rewrite_dst( uniform_int_distribution<uint32_t> {}( rd ) );
+      check( header, "rewrite_dst" );
+    }
+
+    // forwarding a datagram until its TTL runs out
+    default_random_engine rd2 { 1141 };
+    IPv4Header header = random_header( rd2 );
+    header.ttl = UINT8_MAX;
+    header.compute_checksum();
+    while ( header.ttl > 1 ) {
+      header.decrement_ttl();
+      check( header, "repeated decrement_ttl" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+#include "loopback_adapter.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+TCPMessage message( const uint32_t seqno, string payload = {} )
+{
+  return { .sender = TCPSenderMessage { .seqno = Wrap32 { seqno }, .payload = move( payload ) },
+           .receiver = TCPReceiverMessage { .window_size = 1000 } };
+}
+
+void expect_seqnos( LoopbackAdapter& adapter, const vector<uint32_t>& seqnos, const string& what )
+{
+  vector<TCPMessage> segs;
+  adapter.read( segs );
+  bool same = segs.size() == seqnos.size();
+  for ( size_t i = 0; same and i < segs.size(); i++ ) {
+    same = segs[i].sender->seqno == Wrap32 { seqnos[i] };
+  }
+  if ( not same ) {
+    throw runtime_error( what + ": got " + to_string( segs.size() ) + " messages, expected "
+                         + to_string( seqnos.size() ) );
+  }
+}
+
+void test_unlimited()
+{
+  auto [a, b] = LoopbackAdapter::make_pair();
+  a.write( message( 1, "hello" ) );
+  b.write( message( 2 ) );
+  const auto at_b = b.read();
+  if ( not at_b.has_value() or at_b->sender->payload != "hello" ) {
+    throw runtime_error( "message did not arrive" );
+  }
+  expect_seqnos( a, { 2 }, "other direction" );
+  expect_seqnos( a, {}, "nothing left" );
+}
+
+void test_delay()
+{
+  auto [a, b] = LoopbackAdapter::make_pair( { .delay_ms = 5 } );
+  a.write( message( 1 ) );
+  b.tick( 4 );
+  expect_seqnos( b, {}, "before the delay" );
+  b.tick( 1 );
+  expect_seqnos( b, { 1 }, "after the delay" );
+}
+
+void test_bandwidth()
+{
+  // each message is 20 + 80 bytes, so a link of 100 bytes/ms sends one per millisecond
+  auto [a, b] = LoopbackAdapter::make_pair( { .bandwidth_bytes_per_ms = 100 } );
+  const vector<TCPMessage> burst { message( 1, string( 80, 'x' ) ),
+                                   message( 2, string( 80, 'x' ) ),
+                                   message( 3, string( 80, 'x' ) ) };
+  a.write( burst );
+  expect_seqnos( b, {}, "burst before it is sent" );
+  b.tick( 1 );
+  expect_seqnos( b, { 1 }, "first of burst" );
+  b.tick( 2 );
+  expect_seqnos( b, { 2, 3 }, "rest of burst" );
+}
+
+void test_reorder()
+{
+  auto [a, b] = LoopbackAdapter::make_pair( { .reorder_rate = UINT16_MAX, .reorder_delay_ms = 3 } );
+  a.write( message( 1 ) );
+  a.tick( 1 );
+  a.write( message( 2 ) );
+  b.tick( 2 );
+  expect_seqnos( b, {}, "held back" );
+  b.tick( 1 );
+  expect_seqnos( b, { 1 }, "first arrives late" );
+  b.tick( 1 );
+  expect_seqnos( b, { 2 }, "second arrives late" );
+}
+
+void test_queue_full()
+{
+  auto [a, b] = LoopbackAdapter::make_pair( { .queue_capacity = 2 } );
+  a.write( vector { message( 1 ), message( 2 ), message( 3 ) } );
+  if ( a.dropped() != 1 ) {
+    throw runtime_error( "expected one message dropped, got " + to_string( a.dropped() ) );
+  }
+  expect_seqnos( b, { 1, 2 }, "full queue" );
+  if ( b.read_stats().wakeups != 1 or b.read_stats().datagrams != 2 ) {
+    throw runtime_error( "read_stats did not count the batch" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_unlimited();
+    test_delay();
+    test_bandwidth();
+    test_reorder();
+    test_queue_full();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
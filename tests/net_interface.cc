@@ -249,6 +249,43 @@ int main()
       test.execute( ExpectNoFrame {} );
     }
 
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress target_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "mappings learned again last 30 seconds from then", local_eth, Address( "4.3.2.1", 0 ) };
+
+      const auto learn = ReceiveFrame { make_frame(
+        target_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, target_eth, "192.168.0.1", {}, "4.3.2.9" ) ) ) };
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.10" );
+      const auto datagram2 = make_datagram( "5.6.7.8", "13.12.11.11" );
+
+      // learn the mapping, and learn it again 20 seconds later
+      test.execute( learn );
+      test.execute( Tick { 20000 } );
+      test.execute( learn );
+
+      // 35 seconds after it was first learned, the mapping is still known
+      test.execute( Tick { 15000 } );
+      test.execute( SendDatagram { datagram, Address( "192.168.0.1", 0 ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, target_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // but 31 seconds after it was learned again, it has expired
+      test.execute( Tick { 16000 } );
+      test.execute( SendDatagram { datagram2, Address( "192.168.0.1", 0 ) } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "4.3.2.1", {}, "192.168.0.1" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+    }
+
     {
       const EthernetAddress local_eth = random_private_ethernet_address();
       const EthernetAddress remote_eth1 = random_private_ethernet_address();
@@ -884,6 +921,55 @@ int main()
       // No pending datagrams exist for this EthernetAddress, so no outbound frames
       test.execute( ExpectNoFrame {} );
     }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress eth_a = random_private_ethernet_address();
+      const EthernetAddress eth_b = random_private_ethernet_address();
+
+      NetworkInterfaceTestHarness test {
+        "pending datagrams are kept for each next hop, up to a limit", local_eth, Address( "4.3.2.1", 0 ) };
+
+      // more datagrams than can be kept for one next hop, and one for another next hop
+      vector<InternetDatagram> datagrams_a;
+      for ( size_t i = 0; i < NetworkInterface::MAX_PENDING_DATAGRAMS + 2; i++ ) {
+        datagrams_a.push_back( make_datagram( "5.6.7.8", "13.12.11." + to_string( i ) ) );
+        test.execute( SendDatagram { datagrams_a.back(), Address( "192.168.0.1", 0 ) } );
+      }
+      const auto datagram_b = make_datagram( "5.6.7.8", "13.12.12.1" );
+      test.execute( SendDatagram { datagram_b, Address( "192.168.0.2", 0 ) } );
+
+      for ( const string next_hop : { "192.168.0.1", "192.168.0.2" } ) {
+        test.execute( ExpectFrame { make_frame(
+          local_eth,
+          ETHERNET_BROADCAST,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "4.3.2.1", {}, next_hop ) ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+
+      // the reply from one next hop releases only its datagram
+      test.execute( ReceiveFrame { make_frame(
+        eth_b,
+        local_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, eth_b, "192.168.0.2", local_eth, "4.3.2.1" ) ) ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, eth_b, EthernetHeader::TYPE_IPv4, serialize( datagram_b ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // the other releases the newest datagrams it was sent, in order
+      test.execute( ReceiveFrame { make_frame(
+        eth_a,
+        local_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, eth_a, "192.168.0.1", local_eth, "4.3.2.1" ) ) ) } );
+      for ( size_t i = 2; i < datagrams_a.size(); i++ ) {
+        test.execute(
+          ExpectFrame { make_frame( local_eth, eth_a, EthernetHeader::TYPE_IPv4, serialize( datagrams_a[i] ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return EXIT_FAILURE;
@@ -0,0 +1,130 @@
+#include "arp_message.hh"
+#include "helpers.hh"
+#include "network_interface.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t neighbor_count = 16;
+constexpr size_t frames_per_round = 4096;
+constexpr auto test_duration = milliseconds { 300 };
+
+// serializes each frame, as a port writing to a socket or TAP device would, and counts the bytes
+class WirePort : public NetworkInterface::OutputPort
+{
+public:
+  uint64_t frames {};
+  uint64_t bytes {};
+
+  void transmit( const NetworkInterface& sender [[maybe_unused]], const EthernetFrame& frame ) override
+  {
+    const auto pieces = serialize( frame );
+    // check the first frames against the same frame with its header serialized afresh
+    if ( frames < neighbor_count and concat( pieces ) != concat( serialize( clone( frame ) ) ) ) {
+      throw runtime_error( "frame was serialized wrongly: " + summary( frame ) );
+    }
+    for ( const auto& piece : pieces ) {
+      bytes += piece.get().size();
+    }
+    frames++;
+  }
+};
+
+EthernetAddress neighbor_ethernet_address( const size_t n )
+{
+  return { 0x02, 0, 0, 0, 0x10, static_cast<uint8_t>( n ) };
+}
+
+Address neighbor_ip_address( const size_t n )
+{
+  return Address { "192.168.0." + to_string( n + 2 ) };
+}
+
+void speed_test( fstream& debug_output, const size_t payload_size )
+{
+  // the interface of the net_interface tests, which has learned (from ARP replies) the addresses of its neighbors
+  const EthernetAddress local_ethernet_address { 0x02, 0, 0, 0, 0, 1 };
+  const Address local_ip_address { "192.168.0.1" };
+  auto port = make_shared<WirePort>();
+  NetworkInterface interface { "eth0", port, local_ethernet_address, local_ip_address };
+
+  vector<Address> next_hops;
+  for ( size_t n = 0; n < neighbor_count; n++ ) {
+    next_hops.push_back( neighbor_ip_address( n ) );
+    ARPMessage reply;
+    reply.opcode = ARPMessage::OPCODE_REPLY;
+    reply.sender_ethernet_address = neighbor_ethernet_address( n );
+    reply.sender_ip_address = next_hops.back().ipv4_numeric();
+    reply.target_ethernet_address = local_ethernet_address;
+    reply.target_ip_address = local_ip_address.ipv4_numeric();
+    interface.recv_frame(
+      { .header = { local_ethernet_address, neighbor_ethernet_address( n ), EthernetHeader::TYPE_ARP },
+        .payload = serialize( reply ) } );
+  }
+
+  InternetDatagram dgram { { .ttl = 64, .src = local_ip_address.ipv4_numeric(), .dst = 0x08080808 } };
+  dgram.payload.emplace_back( string( payload_size, 'x' ) );
+  dgram.header.len = dgram.header.hlen * 4 + payload_size;
+  dgram.header.compute_checksum();
+
+  uint64_t frames = 0;
+  const auto start_time = steady_clock::now();
+  while ( steady_clock::now() - start_time < test_duration ) {
+    for ( size_t i = 0; i < frames_per_round; i++ ) {
+      interface.send_datagram( dgram, next_hops[i % neighbor_count] );
+    }
+    frames += frames_per_round;
+  }
+  const auto seconds = duration_cast<duration<double>>( steady_clock::now() - start_time ).count();
+
+  const uint64_t frame_size = EthernetHeader::LENGTH + dgram.header.len;
+  if ( port->frames != frames or port->bytes != frames * frame_size ) {
+    throw runtime_error( "NetworkInterface sent " + to_string( port->frames ) + " frames ("
+                         + to_string( port->bytes ) + " bytes) for " + to_string( frames ) + " datagrams" );
+  }
+
+  const double frames_per_second = static_cast<double>( frames ) / seconds;
+  cout << "NetworkInterface sent frames with " << payload_size << "-byte payloads to " << neighbor_count
+       << " neighbors at " << fixed << setprecision( 2 ) << frames_per_second / 1e6 << " M frames/s.\n";
+
+  debug_output << "   NetworkInterface (" << setw( 4 ) << payload_size << "-byte payloads): " << fixed
+               << setprecision( 2 ) << setw( 6 ) << frames_per_second / 1e6 << " M frames/s\n";
+
+  if ( frames_per_second < 1e5 ) {
+    throw runtime_error( "NetworkInterface did not meet minimum speed of 0.1 M frames/s" );
+  }
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  for ( const size_t payload_size : { 64, 1400 } ) {
+    speed_test( debug_output, payload_size );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -13,7 +13,11 @@ public:
   std::queue<EthernetFrame> frames {};
   void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x ) override
   {
+    // the clone leaves out any header the interface serialized ahead of time, so it is serialized afresh
     frames.push( clone( x ) );
+    if ( concat( serialize( x ) ) != concat( serialize( frames.back() ) ) ) {
+      throw ExpectationViolation( "frame's serialized header should match its header: " + summary( x ) );
+    }
   }
 
   EthernetFrame expect_frame() const
@@ -0,0 +1,188 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "helpers.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// `data`, split into pieces at random boundaries (so integers often straddle two buffers)
+vector<string> fragment( default_random_engine& rd, const string& data )
+{
+  vector<string> pieces;
+  for ( size_t offset = 0; offset < data.size(); ) {
+    const size_t length = uniform_int_distribution<size_t> { 1, 7 }( rd );
+    pieces.push_back( data.substr( offset, length ) );
+    offset += length;
+  }
+  return pieces;
+}
+
+// a Parser over fragments and a SpanParser over the whole buffer read the same object, and the same error
+template<class T, typename... Targs>
+void check_same( default_random_engine& rd, const string& data, const bool expect_ok, Targs... args )
+{
+  T from_fragments;
+  Parser parser { fragment( rd, data ) };
+  from_fragments.parse( parser, args... );
+
+  T from_span;
+  SpanParser span_parser { data };
+  from_span.parse( span_parser, args... );
+
+  if ( parser.has_error() != not expect_ok or span_parser.has_error() != not expect_ok ) {
+    throw runtime_error( "unexpected parse result for " + to_string( data.size() ) + " bytes" );
+  }
+  if ( expect_ok and concat( serialize( from_fragments ) ) != concat( serialize( from_span ) ) ) {
+    throw runtime_error( "Parser and SpanParser read different objects" );
+  }
+}
+
+void test_datagram( default_random_engine& rd )
+{
+  TCPSegment seg;
+  seg.udinfo = { 40000, 443, 0 };
+  seg.message.sender = TCPSenderMessage { .seqno = Wrap32 { 0x12345678 }, .SYN = true, .payload = "hello" };
+  seg.message.receiver = TCPReceiverMessage { .ackno = Wrap32 { 0xfedcba98 }, .window_size = 0xabcd };
+
+  InternetDatagram dgram;
+  dgram.header.src = 0x0a000001;
+  dgram.header.dst = 0xc0a80102;
+  dgram.header.len = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + 5;
+  dgram.payload.emplace_back( seg.serialize_with_checksum( dgram.header.pseudo_checksum() ) );
+  dgram.header.compute_checksum();
+  const string data = concat( serialize( dgram ) );
+
+  for ( size_t trial = 0; trial < 100; trial++ ) {
+    check_same<InternetDatagram>( rd, data, true );
+    check_same<IPv4Header>( rd, data.substr( 0, IPv4Header::LENGTH - 1 ), false );
+    check_same<TCPSegment>( rd, data.substr( IPv4Header::LENGTH ), true, dgram.header.pseudo_checksum() );
+    check_same<TCPSegment>( rd, data.substr( IPv4Header::LENGTH, 24 ), false, dgram.header.pseudo_checksum() );
+  }
+
+  // every field comes out the same as it went in
+  TCPSegment parsed;
+  SpanParser parser { data };
+  IPv4Header header;
+  header.parse( parser );
+  parsed.parse( parser, header.pseudo_checksum() );
+  if ( parser.has_error() or header.src != dgram.header.src or header.dst != dgram.header.dst
+       or parsed.udinfo.src_port != 40000 or parsed.message.sender->seqno != Wrap32 { 0x12345678 }
+       or parsed.message.receiver->ackno != Wrap32 { 0xfedcba98 } or parsed.message.receiver->window_size != 0xabcd
+       or not parsed.message.sender->SYN or parsed.message.sender->payload != "hello" ) {
+    throw runtime_error( "SpanParser read the wrong fields" );
+  }
+}
+
+void test_frame( default_random_engine& rd )
+{
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REQUEST;
+  arp.sender_ethernet_address = { 1, 2, 3, 4, 5, 6 };
+  arp.sender_ip_address = 0x0a000001;
+  arp.target_ip_address = 0x0a000002;
+
+  EthernetFrame frame;
+  frame.header = { ETHERNET_BROADCAST, arp.sender_ethernet_address, EthernetHeader::TYPE_ARP };
+  frame.payload = serialize( arp );
+  const string data = concat( serialize( frame ) );
+
+  for ( size_t trial = 0; trial < 100; trial++ ) {
+    check_same<EthernetFrame>( rd, data, true );
+    check_same<ARPMessage>( rd, data.substr( EthernetHeader::LENGTH ), true );
+    check_same<ARPMessage>( rd, data.substr( EthernetHeader::LENGTH, ARPMessage::LENGTH - 1 ), false );
+  }
+}
+
+// a HeaderSerializer writes the same bytes as a Serializer, without copying the payload
+void test_header_serializer()
+{
+  TCPSegment seg;
+  seg.udinfo = { 5000, 6000, 0 };
+  seg.message.sender = TCPSenderMessage { .seqno = Wrap32 { 1 }, .payload = string( 1000, 'p' ), .FIN = true };
+  seg.message.receiver = TCPReceiverMessage { .window_size = 17 };
+
+  IPv4Header ip;
+  ip.len = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + 1000;
+  seg.compute_checksum( ip.pseudo_checksum() );
+  ip.compute_checksum();
+
+  const EthernetHeader eth { { 1, 2, 3, 4, 5, 6 }, { 7, 8, 9, 10, 11, 12 }, EthernetHeader::TYPE_IPv4 };
+
+  Serializer reference;
+  eth.serialize( reference );
+  ip.serialize( reference );
+  seg.serialize( reference );
+
+  HeaderSerializer serializer;
+  eth.serialize( serializer );
+  ip.serialize( serializer );
+  seg.serialize( serializer );
+  const auto pieces = serializer.finish();
+
+  if ( pieces.size() != 2 or pieces[1].data() != seg.message.sender->payload.data()
+       or concat( pieces ) != concat( reference.finish() ) ) {
+    throw runtime_error( "HeaderSerializer wrote the wrong bytes" );
+  }
+
+  // headers that don't fit are an error, not an overflow
+  HeaderSerializer small;
+  for ( size_t i = 0; i < HeaderSerializer::CAPACITY / sizeof( uint64_t ); i++ ) {
+    small.integer( uint64_t { i } );
+  }
+  try {
+    small.integer( uint8_t { 0 } );
+  } catch ( const runtime_error& ) {
+    return;
+  }
+  throw runtime_error( "HeaderSerializer accepted headers longer than its capacity" );
+}
+
+// a datagram parsed from one buffer (with trailing padding, as an Ethernet frame may have) keeps referring to
+// that buffer: cutting off the header and the padding moves none of the payload
+void test_in_place()
+{
+  InternetDatagram dgram;
+  dgram.header.len = IPv4Header::LENGTH + 100;
+  dgram.header.compute_checksum();
+  dgram.payload.emplace_back( string( 100, 'd' ) );
+
+  vector<string> buffers;
+  buffers.push_back( concat( serialize( dgram ) ) + string( 6, 0 ) );
+  const char* const payload_start = buffers.front().data() + IPv4Header::LENGTH;
+
+  InternetDatagram parsed;
+  if ( not parse( parsed, move( buffers ) ) or parsed.payload.size() != 1
+       or parsed.payload.front().get() != string( 100, 'd' ) ) {
+    throw runtime_error( "Parser read the wrong payload from one buffer" );
+  }
+  if ( parsed.payload.front().get().data() != payload_start ) {
+    throw runtime_error( "Parser moved the payload to cut off the header" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    default_random_engine rd { 826 };
+    test_datagram( rd );
+    test_frame( rd );
+    test_header_serializer();
+    test_in_place();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+#include "double_buffered.hh"
+#include "route_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t prefix_count = 100'000;
+constexpr auto test_duration = milliseconds { 500 };
+
+// looks up destinations in bursts (as Router::route does) until told to stop
+// \returns the number of lookups
+uint64_t forward( DoubleBuffered<RouteTable>& tables,
+                  const vector<uint32_t>& destinations,
+                  const atomic<bool>& stop )
+{
+  const span<const uint32_t> all { destinations };
+  array<const ForwardingRule*, RouteTable::MAX_BURST> results {};
+  uint64_t lookups = 0;
+  size_t folded = 0; // so the lookups can't be optimized away
+
+  while ( not stop ) {
+    for ( size_t start = 0; start < all.size() and not stop; start += results.size() ) {
+      const auto burst = all.subspan( start, min( results.size(), all.size() - start ) );
+      const auto table = tables.read();
+      table->lookup( burst, results );
+      for ( size_t i = 0; i < burst.size(); i++ ) {
+        folded += results[i] == nullptr ? 0 : results[i]->interface_num;
+      }
+      lookups += burst.size();
+    }
+  }
+
+  if ( folded == 1 ) {
+    cerr << "(unlikely sum)\n";
+  }
+  return lookups;
+}
+
+// withdraws a route and puts it back (or moves it to another interface) until told to stop
+// \returns the number of route changes
+uint64_t churn( DoubleBuffered<RouteTable>& tables, const vector<ForwardingRule>& rules, const atomic<bool>& stop )
+{
+  default_random_engine rd { 43 };
+  uniform_int_distribution<size_t> rule_dist { 0, rules.size() - 1 };
+  uint64_t changes = 0;
+
+  while ( not stop ) {
+    ForwardingRule rule = rules[rule_dist( rd )];
+    if ( changes % 2 ) {
+      rule.interface_num = ( rule.interface_num + 1 ) % 16;
+      tables.update( [&]( RouteTable& table ) { table.replace( rule ); } );
+    } else {
+      tables.update( [&]( RouteTable& table ) {
+        table.remove( rule.route_prefix, rule.prefix_length );
+        table.add( rule );
+      } );
+    }
+    changes++;
+  }
+  return changes;
+}
+
+void speed_test( fstream& debug_output, const size_t forwarders, const bool with_churn )
+{
+  default_random_engine rd { 41 };
+
+  // prefixes with lengths spread roughly like a full Internet routing table (mostly /24s)
+  discrete_distribution<unsigned> length_dist { { 1, 1, 1, 1, 1, 2, 2, 3, 15, 10, 20, 30, 50, 50, 120, 100, 600 } };
+  uniform_int_distribution<uint32_t> address_dist;
+  vector<ForwardingRule> rules;
+  for ( size_t i = 0; i < prefix_count; i++ ) {
+    rules.push_back( { address_dist( rd ), static_cast<uint8_t>( 8 + length_dist( rd ) ), {}, i % 16 } );
+  }
+  DoubleBuffered<RouteTable> tables;
+  tables.update( [&]( RouteTable& table ) {
+    for ( const auto& rule : rules ) {
+      table.add( rule );
+    }
+  } );
+
+  vector<uint32_t> destinations( size_t { 1 } << 16 );
+  for ( auto& destination : destinations ) {
+    const auto& rule = rules[address_dist( rd ) % rules.size()];
+    destination = rule.route_prefix ^ ( address_dist( rd ) >> rule.prefix_length );
+  }
+
+  atomic<bool> stop = false;
+  vector<uint64_t> lookups( forwarders );
+  vector<thread> threads;
+  for ( size_t i = 0; i < forwarders; i++ ) {
+    threads.emplace_back( [&, i] { lookups[i] = forward( tables, destinations, stop ); } );
+  }
+  uint64_t changes = 0;
+  if ( with_churn ) {
+    threads.emplace_back( [&] { changes = churn( tables, rules, stop ); } );
+  }
+
+  const auto start_time = steady_clock::now();
+  this_thread::sleep_for( test_duration );
+  stop = true;
+  for ( auto& thread : threads ) {
+    thread.join();
+  }
+  const auto seconds = duration_cast<duration<double>>( steady_clock::now() - start_time ).count();
+
+  uint64_t total_lookups = 0;
+  for ( const auto count : lookups ) {
+    total_lookups += count;
+  }
+  const double lookups_per_second = static_cast<double>( total_lookups ) / seconds;
+  const double changes_per_second = static_cast<double>( changes ) / seconds;
+
+  cout << "RouteTable with " << prefix_count << " prefixes and " << forwarders << " forwarding thread(s) reached "
+       << fixed << setprecision( 1 ) << lookups_per_second / 1e6 << " M lookups/s";
+  if ( with_churn ) {
+    cout << " during " << setprecision( 0 ) << changes_per_second << " route changes/s";
+  }
+  cout << ".\n";
+
+  debug_output << "   RouteTable lookups (" << forwarders << " threads, " << ( with_churn ? "with" : "   no" )
+               << " churn): " << fixed << setprecision( 1 ) << setw( 6 ) << lookups_per_second / 1e6 << " M/s, "
+               << setprecision( 0 ) << setw( 8 ) << changes_per_second << " changes/s\n";
+
+  if ( lookups_per_second < 1e6 ) {
+    throw runtime_error( "RouteTable did not meet minimum speed of 1 M lookups/s" );
+  }
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  const size_t forwarders = clamp( thread::hardware_concurrency(), 2U, 5U ) - 1;
+  for ( const bool with_churn : { false, true } ) {
+    speed_test( debug_output, forwarders, with_churn );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
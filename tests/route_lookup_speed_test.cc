@@ -0,0 +1,196 @@
+#include "route_cache.hh"
+#include "route_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+// prefixes with lengths spread roughly like a full Internet routing table (mostly /24s)
+vector<ForwardingRule> synthetic_table( const size_t prefix_count, default_random_engine& rd )
+{
+  //                                                 /8 ... /15                        /16 ... /24
+  discrete_distribution<unsigned> length_dist { { 1, 1, 1, 1, 1, 2, 2, 3, 15, 10, 20, 30, 50, 50, 120, 100, 600 } };
+  uniform_int_distribution<uint32_t> address_dist;
+  uniform_int_distribution<size_t> interface_dist { 0, 15 };
+
+  vector<ForwardingRule> rules;
+  rules.reserve( prefix_count );
+  for ( size_t i = 0; i < prefix_count; i++ ) {
+    const auto prefix_length = static_cast<uint8_t>( 8 + length_dist( rd ) );
+    rules.push_back( { address_dist( rd ), prefix_length, {}, interface_dist( rd ) } );
+  }
+  return rules;
+}
+
+// with a `cache`, each burst is looked up through it
+double lookup_speed( const RouteTable& table,
+                     const vector<uint32_t>& destinations,
+                     const bool batched,
+                     RouteCache* cache = nullptr )
+{
+  constexpr size_t rounds = 16;
+  const span<const uint32_t> all { destinations };
+  array<const ForwardingRule*, RouteTable::MAX_BURST> results {};
+
+  // fold the results together so the lookups can't be optimized away
+  size_t folded = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t round = 0; round < rounds; round++ ) {
+    if ( batched ) {
+      for ( size_t start = 0; start < all.size(); start += results.size() ) {
+        const auto burst = all.subspan( start, min( results.size(), all.size() - start ) );
+        if ( cache ) {
+          cache->lookup( table, burst, results );
+        } else {
+          table.lookup( burst, results );
+        }
+        for ( size_t i = 0; i < burst.size(); i++ ) {
+          folded += results[i] == nullptr ? 0 : results[i]->interface_num;
+        }
+      }
+    } else {
+      for ( const uint32_t destination : destinations ) {
+        const ForwardingRule* rule = table.lookup( destination );
+        folded += rule == nullptr ? 0 : rule->interface_num;
+      }
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( folded == 1 ) {
+    cerr << "(unlikely sum)\n";
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  return static_cast<double>( rounds * destinations.size() ) / test_duration.count();
+}
+
+void speed_test( fstream& debug_output, const size_t prefix_count )
+{
+  default_random_engine rd { 41 };
+  const auto rules = synthetic_table( prefix_count, rd );
+
+  const auto build_start = steady_clock::now();
+  RouteTable table;
+  for ( const auto& rule : rules ) {
+    table.add( rule );
+  }
+  const auto build_duration = duration_cast<duration<double>>( steady_clock::now() - build_start );
+
+  // half the destinations are inside a routed prefix, and half are anywhere
+  uniform_int_distribution<uint32_t> address_dist;
+  uniform_int_distribution<size_t> rule_dist { 0, rules.size() - 1 };
+  vector<uint32_t> destinations( size_t { 1 } << 20 );
+  for ( size_t i = 0; i < destinations.size(); i++ ) {
+    const auto& rule = rules[rule_dist( rd )];
+    destinations[i] = i % 2 ? address_dist( rd )
+                            : rule.route_prefix ^ ( address_dist( rd ) >> rule.prefix_length );
+  }
+
+  // look up every destination one at a time, and then a burst at a time
+  for ( const bool batched : { false, true } ) {
+    const double lookups_per_second = lookup_speed( table, destinations, batched );
+    const auto trie_megabytes = static_cast<double>( table.trie_bytes() ) / 1e6;
+    const auto rule_megabytes = static_cast<double>( table.rule_bytes() ) / 1e6;
+    const string mode = batched ? "in bursts of " + to_string( RouteTable::MAX_BURST ) : "one at a time";
+
+    cout << "RouteTable with " << prefix_count << " prefixes (" << mode << ") reached " << fixed
+         << setprecision( 1 ) << lookups_per_second / 1e6 << " M lookups/s (trie " << trie_megabytes
+         << " MB, rules " << rule_megabytes << " MB, built in " << setprecision( 2 ) << build_duration.count()
+         << " s).\n";
+
+    debug_output << "   RouteTable lookups (" << setw( 7 ) << prefix_count << " prefixes, " << setw( 16 ) << mode
+                 << "): " << fixed << setprecision( 1 ) << setw( 6 ) << lookups_per_second / 1e6 << " M/s, trie "
+                 << setw( 6 ) << trie_megabytes << " MB\n";
+
+    if ( lookups_per_second < 1e6 ) {
+      throw runtime_error( "RouteTable did not meet minimum speed of 1 M lookups/s" );
+    }
+  }
+}
+
+// traffic to a few destinations (each one's share falls off with its rank, following Zipf's law)
+void skewed_speed_test( fstream& debug_output, const size_t prefix_count )
+{
+  default_random_engine rd { 44 };
+  const auto rules = synthetic_table( prefix_count, rd );
+  RouteTable table;
+  for ( const auto& rule : rules ) {
+    table.add( rule );
+  }
+
+  constexpr size_t popular_count = 10'000;
+  uniform_int_distribution<uint32_t> address_dist;
+  vector<uint32_t> popular( popular_count );
+  vector<double> weights( popular_count );
+  for ( size_t i = 0; i < popular_count; i++ ) {
+    const auto& rule = rules[address_dist( rd ) % rules.size()];
+    popular[i] = rule.route_prefix ^ ( address_dist( rd ) >> rule.prefix_length );
+    weights[i] = 1.0 / static_cast<double>( i + 1 );
+  }
+  discrete_distribution<size_t> rank_dist { weights.begin(), weights.end() };
+  vector<uint32_t> destinations( size_t { 1 } << 20 );
+  for ( auto& destination : destinations ) {
+    destination = popular[rank_dist( rd )];
+  }
+
+  for ( const bool cached : { false, true } ) {
+    RouteCache cache;
+    const double lookups_per_second = lookup_speed( table, destinations, true, cached ? &cache : nullptr );
+    const auto& stats = cache.stats();
+    const auto lookups = static_cast<double>( stats.hits + stats.misses );
+    const string mode = cached ? "cache of " + to_string( RouteCache::DEFAULT_ENTRIES ) : "no cache";
+
+    cout << "RouteTable with " << prefix_count << " prefixes and skewed traffic (" << mode << ") reached " << fixed
+         << setprecision( 1 ) << lookups_per_second / 1e6 << " M lookups/s";
+    if ( cached ) {
+      cout << " (" << static_cast<double>( stats.hits ) / lookups * 100 << "% hits)";
+    }
+    cout << ".\n";
+
+    debug_output << "   RouteTable lookups (" << setw( 7 ) << prefix_count << " prefixes, skewed, " << setw( 13 )
+                 << mode << "): " << fixed << setprecision( 1 ) << setw( 6 ) << lookups_per_second / 1e6
+                 << " M/s\n";
+
+    if ( lookups_per_second < 1e6 ) {
+      throw runtime_error( "RouteTable did not meet minimum speed of 1 M lookups/s" );
+    }
+  }
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  for ( const size_t prefix_count : { 100'000, 1'000'000 } ) {
+    speed_test( debug_output, prefix_count );
+  }
+  skewed_speed_test( debug_output, 1'000'000 );
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
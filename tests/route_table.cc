@@ -0,0 +1,248 @@
+#include "route_cache.hh"
+#include "route_table.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+bool matches( const ForwardingRule& rule, const uint32_t address )
+{
+  return rule.prefix_length == 0 or ( rule.route_prefix ^ address ) >> ( 32 - rule.prefix_length ) == 0;
+}
+
+// the longest matching prefix, found the slow way (the earliest rule wins a tie)
+const ForwardingRule* reference_lookup( const vector<ForwardingRule>& rules, const uint32_t address )
+{
+  const ForwardingRule* best = nullptr;
+  for ( const auto& rule : rules ) {
+    if ( matches( rule, address ) and ( best == nullptr or rule.prefix_length > best->prefix_length ) ) {
+      best = &rule;
+    }
+  }
+  return best;
+}
+
+void check( const RouteTable& table, const vector<ForwardingRule>& rules, const uint32_t address )
+{
+  const ForwardingRule* expected = reference_lookup( rules, address );
+  const ForwardingRule* actual = table.lookup( address );
+  if ( ( expected == nullptr ) != ( actual == nullptr )
+       or ( expected != nullptr and actual->interface_num != expected->interface_num ) ) {
+    throw runtime_error( "lookup of " + Address::from_ipv4_numeric( address ).ip() + " found the wrong rule" );
+  }
+}
+
+void test_small()
+{
+  RouteTable table;
+  if ( table.lookup( 0x0a000001 ) != nullptr ) {
+    throw runtime_error( "empty table matched" );
+  }
+
+  // host bits past the prefix length are ignored
+  table.add( { 0x0a0000ff, 8, {}, 1 } );
+  table.add( { 0x0a010000, 16, {}, 2 } );
+  table.add( { 0x0a010200, 24, {}, 3 } );
+  table.add( { 0x0a010203, 32, {}, 4 } );
+  table.add( { 0x0a010000, 16, {}, 5 } ); // the same prefix again
+
+  const vector<pair<uint32_t, size_t>> expected {
+    { 0x0a7f0000, 1 }, { 0x0a01ff00, 2 }, { 0x0a010201, 3 }, { 0x0a010203, 4 }, { 0x0a010204, 3 } };
+  for ( const auto& [address, interface_num] : expected ) {
+    const auto* rule = table.lookup( address );
+    if ( rule == nullptr or rule->interface_num != interface_num ) {
+      throw runtime_error( "lookup of " + Address::from_ipv4_numeric( address ).ip() + " found the wrong rule" );
+    }
+  }
+  if ( table.lookup( 0x0b000000 ) != nullptr ) {
+    throw runtime_error( "address outside every prefix matched" );
+  }
+
+  // a default route added after longer prefixes doesn't displace them
+  table.add( { 0, 0, {}, 6 } );
+  if ( table.lookup( 0x0b000000 )->interface_num != 6 or table.lookup( 0x0a010203 )->interface_num != 4 ) {
+    throw runtime_error( "default route was added wrong" );
+  }
+}
+
+void test_random()
+{
+  default_random_engine rd { 41 };
+  uniform_int_distribution<uint32_t> address_dist;
+  uniform_int_distribution<unsigned> length_dist { 0, 32 };
+  uniform_int_distribution<unsigned> shift_dist { 0, 31 };
+
+  // a few prefixes nested inside each other, so many rules overlap
+  const vector<uint32_t> bases { address_dist( rd ), address_dist( rd ), address_dist( rd ) };
+
+  for ( unsigned round = 0; round < 20; round++ ) {
+    RouteTable table;
+    vector<ForwardingRule> rules;
+    for ( size_t i = 0; i < 200; i++ ) {
+      const auto prefix_length = static_cast<uint8_t>( length_dist( rd ) );
+      const uint32_t noise = address_dist( rd ) >> shift_dist( rd );
+      const ForwardingRule rule { bases.at( i % bases.size() ) ^ noise, prefix_length, {}, i };
+      table.add( rule );
+      rules.push_back( rule );
+
+      check( table, rules, bases.at( i % bases.size() ) ^ ( address_dist( rd ) >> 20 ) );
+    }
+
+    vector<uint32_t> addresses;
+    for ( size_t i = 0; i < 2000; i++ ) {
+      const uint32_t base = bases.at( i % bases.size() );
+      addresses.push_back( base ^ ( address_dist( rd ) >> shift_dist( rd ) ) );
+      check( table, rules, addresses.back() );
+    }
+
+    // a batch (longer than one burst) finds the same rules
+    vector<const ForwardingRule*> found( addresses.size() );
+    table.lookup( addresses, found );
+    for ( size_t i = 0; i < addresses.size(); i++ ) {
+      if ( found[i] != table.lookup( addresses[i] ) ) {
+        throw runtime_error( "batched lookup of " + Address::from_ipv4_numeric( addresses[i] ).ip()
+                             + " found a different rule" );
+      }
+    }
+  }
+}
+
+void test_remove_and_replace()
+{
+  default_random_engine rd { 43 };
+  uniform_int_distribution<uint32_t> address_dist;
+  uniform_int_distribution<unsigned> length_dist { 0, 32 };
+  uniform_int_distribution<unsigned> shift_dist { 0, 31 };
+  uniform_int_distribution<unsigned> action_dist { 0, 9 };
+  const vector<uint32_t> bases { address_dist( rd ), address_dist( rd ) };
+
+  RouteTable table;
+  vector<ForwardingRule> rules; // with host bits clear, and one rule per prefix
+  const auto find = [&]( const uint32_t prefix, const uint8_t prefix_length ) {
+    return find_if( rules.begin(), rules.end(), [&]( const auto& rule ) {
+      return rule.prefix_length == prefix_length and matches( rule, prefix );
+    } );
+  };
+
+  for ( size_t i = 0; i < 3000; i++ ) {
+    const uint32_t base = bases.at( i % bases.size() );
+    const unsigned action = action_dist( rd );
+
+    if ( action < 4 or rules.empty() ) {
+      // add (or replace) a rule for a random prefix
+      const auto prefix_length = static_cast<uint8_t>( length_dist( rd ) );
+      const uint32_t prefix = base ^ ( address_dist( rd ) >> shift_dist( rd ) );
+      const ForwardingRule rule { prefix, prefix_length, {}, i };
+      const auto existing = find( prefix, prefix_length );
+      if ( action % 2 ) {
+        table.replace( rule );
+        if ( existing != rules.end() ) {
+          existing->interface_num = i;
+        } else {
+          rules.push_back( rule );
+        }
+      } else {
+        table.add( rule );
+        if ( existing == rules.end() ) {
+          rules.push_back( rule );
+        }
+      }
+    } else if ( action < 7 ) {
+      // remove a rule the table has
+      const auto victim = rules.begin() + static_cast<ptrdiff_t>( address_dist( rd ) % rules.size() );
+      if ( not table.remove( victim->route_prefix, victim->prefix_length ) ) {
+        throw runtime_error( "remove did not find a rule the table has" );
+      }
+      rules.erase( victim );
+    } else {
+      // remove a prefix the table (probably) doesn't have
+      const auto prefix_length = static_cast<uint8_t>( length_dist( rd ) );
+      const uint32_t prefix = address_dist( rd );
+      if ( table.remove( prefix, prefix_length ) != ( find( prefix, prefix_length ) != rules.end() ) ) {
+        throw runtime_error( "remove of a missing rule gave the wrong result" );
+      }
+      erase_if( rules, [&]( const auto& rule ) {
+        return rule.prefix_length == prefix_length and matches( rule, prefix );
+      } );
+    }
+
+    if ( table.size() != rules.size() ) {
+      throw runtime_error( "table has " + to_string( table.size() ) + " rules, expected "
+                           + to_string( rules.size() ) );
+    }
+    for ( size_t j = 0; j < 10; j++ ) {
+      check( table, rules, base ^ ( address_dist( rd ) >> shift_dist( rd ) ) );
+    }
+  }
+}
+
+void test_cache()
+{
+  RouteTable table;
+  table.add( { 0x0a000000, 8, {}, 1 } );
+  table.add( { 0x0a010000, 16, {}, 2 } );
+
+  RouteCache cache;
+  const vector<uint32_t> addresses { 0x0a010001, 0x0a020001, 0x0b000001, 0x0a010001, 0x0a020001, 0x0a010001 };
+  vector<const ForwardingRule*> found( addresses.size() );
+
+  const auto check_all = [&]( RouteCache& with_cache, const string& when ) {
+    with_cache.lookup( table, addresses, found );
+    for ( size_t i = 0; i < addresses.size(); i++ ) {
+      if ( found[i] != table.lookup( addresses[i] ) ) {
+        throw runtime_error( "cached lookup of " + Address::from_ipv4_numeric( addresses[i] ).ip() + " " + when
+                             + " found a different rule" );
+      }
+    }
+  };
+
+  check_all( cache, "at first" );
+  if ( cache.stats().hits != 3 or cache.stats().misses != 3 ) {
+    throw runtime_error( "cache did not count its hits and misses" );
+  }
+  check_all( cache, "again" );
+  if ( cache.stats().hits != 9 ) {
+    throw runtime_error( "cache did not hit on the second pass" );
+  }
+
+  // a cache with two places, so addresses collide
+  RouteCache tiny_cache { 2 };
+  check_all( tiny_cache, "in a tiny cache" );
+  check_all( tiny_cache, "in a tiny cache again" );
+
+  // a change to the table makes every entry stale
+  table.remove( 0x0a010000, 16 );
+  const auto before_change = cache.stats();
+  check_all( cache, "after a route was removed" );
+  if ( cache.stats().misses - before_change.misses < 3 ) {
+    throw runtime_error( "cache was not invalidated by a change to the table" );
+  }
+  table.replace( { 0x0a000000, 8, {}, 3 } );
+  check_all( cache, "after a route was replaced" );
+  if ( found[0]->interface_num != 3 ) {
+    throw runtime_error( "cache kept a replaced route" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_small();
+    test_random();
+    test_remove_and_replace();
+    test_cache();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
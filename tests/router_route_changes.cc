@@ -0,0 +1,214 @@
+#include "arp_message.hh"
+#include "helpers.hh"
+#include "network_interface_test_harness.hh"
+#include "router.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr size_t interface_count = 3;
+constexpr size_t datagrams_per_round = 50;
+
+// the destinations whose route changes (none of the interfaces' own networks)
+constexpr uint32_t changing_prefix = ( 10U << 24 ) | ( 9U << 16 );
+
+EthernetAddress ethernet_address( const size_t n )
+{
+  return { 0x02, 0, 0, 0, static_cast<uint8_t>( n >> 8 ), static_cast<uint8_t>( n ) };
+}
+
+uint32_t network( const size_t n )
+{
+  return ( 10U << 24 ) | static_cast<uint32_t>( n << 16 );
+}
+
+// the host on each interface's network that the router already knows the Ethernet address of
+uint32_t host( const size_t n )
+{
+  return network( n ) | 2;
+}
+
+// a router whose interface n connects to 10.n.0.0/16
+struct TestRouter
+{
+  Router router {};
+  vector<shared_ptr<FramesOut>> ports {};
+
+  TestRouter()
+  {
+    for ( size_t n = 0; n < interface_count; n++ ) {
+      ports.push_back( make_shared<FramesOut>() );
+      const Address address = Address::from_ipv4_numeric( network( n ) | 1 );
+      const auto id = router.add_interface(
+        make_shared<NetworkInterface>( "eth" + to_string( n ), ports.back(), ethernet_address( n ), address ) );
+      router.add_route( network( n ), 16, {}, id );
+
+      // an ARP request (for someone else) from the host teaches the router its Ethernet address
+      ARPMessage arp;
+      arp.opcode = ARPMessage::OPCODE_REQUEST;
+      arp.sender_ethernet_address = ethernet_address( 1000 + n );
+      arp.sender_ip_address = host( n );
+      arp.target_ip_address = network( n ) | 3;
+      router.interface( id )->recv_frame(
+        { .header = { ETHERNET_BROADCAST, ethernet_address( 1000 + n ), EthernetHeader::TYPE_ARP },
+          .payload = serialize( arp ) } );
+    }
+  }
+
+  // datagrams to a few hosts in the changing prefix, received by interface 0, and routed
+  void forward()
+  {
+    for ( size_t i = 0; i < datagrams_per_round; i++ ) {
+      const uint32_t dst = changing_prefix | static_cast<uint32_t>( i % 4 + 5 );
+      InternetDatagram dgram { { .ttl = 64, .src = host( 0 ), .dst = dst } };
+      dgram.payload.emplace_back( to_string( i ) );
+      dgram.header.len = dgram.header.hlen * 4 + dgram.payload.back()->size();
+      dgram.header.compute_checksum();
+      router.interface( 0 )->datagrams_received().push( move( dgram ) );
+    }
+    router.route();
+  }
+
+  // how many frames each interface sent (to the host on its network), which are then discarded
+  vector<size_t> take_sent( const string& when )
+  {
+    vector<size_t> sent( interface_count );
+    for ( size_t n = 0; n < interface_count; n++ ) {
+      auto& frames = ports.at( n )->frames;
+      for ( ; not frames.empty(); frames.pop() ) {
+        InternetDatagram dgram;
+        if ( not parse( dgram, frames.front().payload ) or frames.front().header.dst != ethernet_address( 1000 + n )
+             or ( dgram.header.dst & 0xffff0000 ) != changing_prefix ) {
+          throw runtime_error( when + ": interface " + to_string( n ) + " sent an unexpected frame" );
+        }
+        sent[n]++;
+      }
+    }
+    return sent;
+  }
+
+  // every datagram forwarded in one round went out on `interface_num` (or, if none, was dropped)
+  void expect_sent_on( const optional<size_t> interface_num, const string& when )
+  {
+    forward();
+    const auto sent = take_sent( when );
+    for ( size_t n = 0; n < interface_count; n++ ) {
+      const size_t expected = n == interface_num ? datagrams_per_round : 0;
+      if ( sent[n] != expected ) {
+        throw runtime_error( when + ": interface " + to_string( n ) + " sent " + to_string( sent[n] )
+                             + " datagrams, expected " + to_string( expected ) );
+      }
+    }
+  }
+};
+
+void expect( const bool condition, const string& description )
+{
+  if ( not condition ) {
+    throw runtime_error( description );
+  }
+}
+
+// routes removed and replaced between bursts: each burst goes where the routes say at the time
+void test_changes( const size_t threads, const bool route_cache )
+{
+  const string name = to_string( threads ) + " thread(s)" + ( route_cache ? " with route cache: " : ": " );
+  TestRouter test;
+  test.router.set_threads( threads );
+  if ( route_cache ) {
+    test.router.enable_route_cache();
+  }
+
+  test.router.add_route( 0, 0, Address::from_ipv4_numeric( host( 0 ) ), 0 );
+  test.router.add_route( changing_prefix, 16, Address::from_ipv4_numeric( host( 1 ) ), 1 );
+  test.expect_sent_on( 1, name + "added route" );
+  test.expect_sent_on( 1, name + "added route (again)" );
+
+  test.router.replace_route( changing_prefix, 16, Address::from_ipv4_numeric( host( 2 ) ), 2 );
+  test.expect_sent_on( 2, name + "replaced route" );
+
+  expect( test.router.remove_route( changing_prefix, 16 ), name + "removing the route failed" );
+  expect( not test.router.remove_route( changing_prefix, 16 ), name + "removed the route twice" );
+  test.expect_sent_on( 0, name + "removed route (so the default route applies)" );
+
+  expect( test.router.remove_route( 0, 0 ), name + "removing the default route failed" );
+  test.expect_sent_on( {}, name + "removed default route (so nothing is sent)" );
+
+  test.router.replace_route( changing_prefix, 16, Address::from_ipv4_numeric( host( 1 ) ), 1 );
+  test.expect_sent_on( 1, name + "route replaced when there was none" );
+
+  if ( route_cache ) {
+    const auto stats = test.router.route_cache_stats();
+    expect( stats.has_value() and stats->hits > 0, name + "route cache was never used" );
+  }
+}
+
+// a control thread replaces the route over and over while datagrams are forwarded: none is lost or sent
+// anywhere but the two interfaces the route switches between, and once it stops, the last route is followed
+void test_concurrent_changes( const size_t threads )
+{
+  const string name = to_string( threads ) + " thread(s), changes from another thread: ";
+  TestRouter test;
+  test.router.set_threads( threads );
+  test.router.enable_route_cache();
+  test.router.add_route( changing_prefix, 16, Address::from_ipv4_numeric( host( 1 ) ), 1 );
+
+  atomic<bool> done { false };
+  thread control { [&] {
+    for ( size_t i = 0; not done; i++ ) {
+      const size_t n = i % 2 + 1;
+      test.router.replace_route( changing_prefix, 16, Address::from_ipv4_numeric( host( n ) ), n );
+    }
+  } };
+
+  vector<size_t> sent( interface_count );
+  constexpr size_t rounds = 200;
+  try {
+    for ( size_t round = 0; round < rounds; round++ ) {
+      test.forward();
+      const auto round_sent = test.take_sent( name + "round " + to_string( round ) );
+      for ( size_t n = 0; n < interface_count; n++ ) {
+        sent[n] += round_sent[n];
+      }
+    }
+  } catch ( ... ) {
+    done = true;
+    control.join();
+    throw;
+  }
+  done = true;
+  control.join();
+
+  expect( sent[0] == 0 and sent[1] + sent[2] == rounds * datagrams_per_round,
+          name + "sent " + to_string( sent[0] ) + "/" + to_string( sent[1] ) + "/" + to_string( sent[2] )
+            + " datagrams on interfaces 0/1/2" );
+
+  test.router.replace_route( changing_prefix, 16, Address::from_ipv4_numeric( host( 2 ) ), 2 );
+  test.expect_sent_on( 2, name + "after the changes stopped" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    for ( const size_t threads : { 1, 2 } ) {
+      test_changes( threads, false );
+      test_changes( threads, true );
+      test_concurrent_changes( threads );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
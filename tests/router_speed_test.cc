@@ -0,0 +1,240 @@
+#include "arp_message.hh"
+#include "helpers.hh"
+#include "router.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t interface_count = 8;
+constexpr size_t datagrams_per_interface = 2048; // received by each interface before each call to route()
+constexpr auto test_duration = milliseconds { 300 };
+
+// counts frames (ports of different interfaces are used from different threads)
+class CountingPort : public NetworkInterface::OutputPort
+{
+public:
+  atomic<uint64_t> frames {};
+  atomic<const char*> last_payload {}; // where the payload of the last frame sent was
+  void transmit( const NetworkInterface& sender [[maybe_unused]], const EthernetFrame& frame ) override
+  {
+    frames.fetch_add( 1, memory_order_relaxed );
+    last_payload.store( frame.payload.back().get().data(), memory_order_relaxed );
+  }
+};
+
+EthernetAddress ethernet_address( const size_t n )
+{
+  return { 0x02, 0, 0, 0, static_cast<uint8_t>( n >> 8 ), static_cast<uint8_t>( n ) };
+}
+
+uint32_t network( const size_t n )
+{
+  return ( 10U << 24 ) | static_cast<uint32_t>( n << 16 );
+}
+
+// each interface reaches a gateway (whose Ethernet address it already knows) that leads to a share of the
+// Internet, split into /12s
+void set_up( Router& router, vector<shared_ptr<CountingPort>>& ports )
+{
+  for ( size_t n = 0; n < interface_count; n++ ) {
+    ports.push_back( make_shared<CountingPort>() );
+    const Address address = Address::from_ipv4_numeric( network( n ) | 1 );
+    const auto id = router.add_interface(
+      make_shared<NetworkInterface>( "eth" + to_string( n ), ports.back(), ethernet_address( n ), address ) );
+
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REQUEST;
+    arp.sender_ethernet_address = ethernet_address( 1000 + n );
+    arp.sender_ip_address = network( n ) | 2;
+    arp.target_ip_address = network( n ) | 3;
+    router.interface( id )->recv_frame(
+      { .header = { ETHERNET_BROADCAST, ethernet_address( 1000 + n ), EthernetHeader::TYPE_ARP },
+        .payload = serialize( arp ) } );
+  }
+  for ( uint32_t prefix = 0; prefix < ( 1U << 12 ); prefix++ ) {
+    const size_t n = prefix % interface_count;
+    router.add_route( prefix << 20, 12, Address::from_ipv4_numeric( network( n ) | 2 ), n );
+  }
+}
+
+InternetDatagram make_datagram( const size_t from, const uint32_t dst, const string& payload )
+{
+  InternetDatagram dgram { { .ttl = 64, .src = network( from ) | 2, .dst = dst } };
+  dgram.payload.emplace_back( string { payload } );
+  dgram.header.len = dgram.header.hlen * 4 + payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+void check_sent( const vector<shared_ptr<CountingPort>>& ports, const uint64_t datagrams )
+{
+  uint64_t frames = 0;
+  for ( const auto& port : ports ) {
+    frames += port->frames;
+  }
+  if ( frames != datagrams ) {
+    throw runtime_error( "Router sent " + to_string( frames ) + " frames for " + to_string( datagrams )
+                         + " datagrams" );
+  }
+}
+
+void speed_test( fstream& debug_output, const size_t threads )
+{
+  Router router;
+  vector<shared_ptr<CountingPort>> ports;
+  set_up( router, ports );
+  router.set_threads( threads );
+
+  default_random_engine rd { 47 };
+  uniform_int_distribution<uint32_t> address_dist;
+  const string payload( 64, 'x' );
+
+  uint64_t datagrams = 0;
+  duration<double> routing_time {};
+  while ( routing_time < test_duration ) {
+    for ( size_t n = 0; n < interface_count; n++ ) {
+      for ( size_t i = 0; i < datagrams_per_interface; i++ ) {
+        router.interface( n )->datagrams_received().push( make_datagram( n, address_dist( rd ), payload ) );
+      }
+    }
+
+    const auto start_time = steady_clock::now();
+    router.route();
+    routing_time += steady_clock::now() - start_time;
+    datagrams += interface_count * datagrams_per_interface;
+  }
+
+  check_sent( ports, datagrams );
+
+  const double datagrams_per_second = static_cast<double>( datagrams ) / routing_time.count();
+  cout << "Router with " << interface_count << " interfaces and " << threads << " thread(s) reached " << fixed
+       << setprecision( 2 ) << datagrams_per_second / 1e6 << " M datagrams/s.\n";
+
+  debug_output << "   Router (" << threads << " threads): " << fixed << setprecision( 2 ) << setw( 6 )
+               << datagrams_per_second / 1e6 << " M datagrams/s\n";
+
+  if ( datagrams_per_second < 1e5 ) {
+    throw runtime_error( "Router did not meet minimum speed of 0.1 M datagrams/s" );
+  }
+}
+
+// a frame carrying `dgram`, in a buffer from `buffers` (as read from the wire)
+EthernetFrame read_frame( BufferPool& buffers, const size_t n, const InternetDatagram& dgram )
+{
+  const string bytes = concat( serialize( dgram ) );
+  PooledBuffer& buffer = buffers.take();
+  ranges::copy( bytes, buffer.storage().begin() );
+
+  EthernetFrame frame {
+    .header = { ethernet_address( n ), ethernet_address( 1000 + n ), EthernetHeader::TYPE_IPv4 }, .payload = {} };
+  frame.payload.emplace_back( buffer, bytes.size() );
+  return frame;
+}
+
+// Forwards frames from receipt (each in one pooled buffer, as read from the wire) to transmission, with one thread
+void frame_speed_test( fstream& debug_output, const size_t payload_size )
+{
+  Router router;
+  vector<shared_ptr<CountingPort>> ports;
+  set_up( router, ports );
+
+  default_random_engine rd { 53 };
+  uniform_int_distribution<uint32_t> address_dist;
+  const string payload( payload_size, 'x' );
+  BufferPool buffers { 2048 };
+  size_t allocated_after_first_round = 0;
+
+  uint64_t datagrams = 0;
+  duration<double> forwarding_time {};
+  vector<EthernetFrame> frames;
+  while ( forwarding_time < test_duration ) {
+    frames.clear();
+    for ( size_t n = 0; n < interface_count; n++ ) {
+      for ( size_t i = 0; i < datagrams_per_interface; i++ ) {
+        frames.push_back( read_frame( buffers, n, make_datagram( n, address_dist( rd ), payload ) ) );
+      }
+    }
+
+    const auto start_time = steady_clock::now();
+    for ( size_t n = 0; n < interface_count; n++ ) {
+      for ( size_t i = 0; i < datagrams_per_interface; i++ ) {
+        router.interface( n )->recv_frame( move( frames[n * datagrams_per_interface + i] ) );
+      }
+    }
+    router.route();
+    forwarding_time += steady_clock::now() - start_time;
+    datagrams += interface_count * datagrams_per_interface;
+    allocated_after_first_round = allocated_after_first_round ? allocated_after_first_round : buffers.allocated();
+  }
+
+  check_sent( ports, datagrams );
+
+  // once forwarded, frames give their buffers back, so each round reuses the same ones
+  if ( buffers.allocated() != allocated_after_first_round or buffers.available() != buffers.allocated() ) {
+    throw runtime_error( "Router kept the buffers of forwarded frames" );
+  }
+
+  // the payload is sent from where it was received: only the headers in front of it were parsed and rewritten
+  EthernetFrame frame = read_frame( buffers, 0, make_datagram( 0, address_dist( rd ), payload ) );
+  const char* const received_payload = frame.payload.back().get().data() + IPv4Header::LENGTH;
+  for ( const auto& port : ports ) {
+    port->last_payload = nullptr;
+  }
+  router.interface( 0 )->recv_frame( move( frame ) );
+  router.route();
+  if ( ranges::none_of( ports, [&]( const auto& port ) { return port->last_payload == received_payload; } ) ) {
+    throw runtime_error( "Router copied the payload of a forwarded frame" );
+  }
+
+  const double datagrams_per_second = static_cast<double>( datagrams ) / forwarding_time.count();
+  const double gigabits_per_second = datagrams_per_second * static_cast<double>( payload_size ) * 8 / 1e9;
+  cout << "Router forwarded frames with " << payload_size << "-byte payloads at " << fixed << setprecision( 2 )
+       << datagrams_per_second / 1e6 << " M datagrams/s (" << gigabits_per_second << " Gbit/s of payload).\n";
+
+  debug_output << "   Router (frames, " << setw( 4 ) << payload_size << "-byte payloads): " << fixed
+               << setprecision( 2 ) << setw( 6 ) << datagrams_per_second / 1e6 << " M datagrams/s\n";
+
+  if ( datagrams_per_second < 1e5 ) {
+    throw runtime_error( "Router did not meet minimum speed of 0.1 M datagrams/s" );
+  }
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  for ( const size_t threads : { 1, 2, 4 } ) {
+    speed_test( debug_output, threads );
+  }
+  for ( const size_t payload_size : { 64, 1400 } ) {
+    frame_speed_test( debug_output, payload_size );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
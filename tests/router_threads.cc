@@ -0,0 +1,144 @@
+#include "arp_message.hh"
+#include "helpers.hh"
+#include "network_interface_test_harness.hh"
+#include "router.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr size_t interface_count = 5;
+constexpr size_t datagrams_per_pair = 100;
+
+EthernetAddress ethernet_address( const size_t n )
+{
+  return { 0x02, 0, 0, 0, static_cast<uint8_t>( n >> 8 ), static_cast<uint8_t>( n ) };
+}
+
+uint32_t network( const size_t n )
+{
+  return ( 10U << 24 ) | static_cast<uint32_t>( n << 16 );
+}
+
+// the host on each interface's network that every datagram to that network goes to
+uint32_t host( const size_t n )
+{
+  return network( n ) | 2;
+}
+
+// a router whose interface n connects to 10.n.0.0/16 (and already knows the Ethernet address of 10.n.0.2)
+struct TestRouter
+{
+  Router router {};
+  vector<shared_ptr<FramesOut>> ports {};
+
+  TestRouter()
+  {
+    for ( size_t n = 0; n < interface_count; n++ ) {
+      ports.push_back( make_shared<FramesOut>() );
+      const Address address = Address::from_ipv4_numeric( network( n ) | 1 );
+      const auto id = router.add_interface(
+        make_shared<NetworkInterface>( "eth" + to_string( n ), ports.back(), ethernet_address( n ), address ) );
+      router.add_route( network( n ), 16, {}, id );
+
+      // an ARP request (for someone else) from the host teaches the router its Ethernet address
+      ARPMessage arp;
+      arp.opcode = ARPMessage::OPCODE_REQUEST;
+      arp.sender_ethernet_address = ethernet_address( 1000 + n );
+      arp.sender_ip_address = host( n );
+      arp.target_ip_address = network( n ) | 3;
+      router.interface( id )->recv_frame(
+        { .header = { ETHERNET_BROADCAST, ethernet_address( 1000 + n ), EthernetHeader::TYPE_ARP },
+          .payload = serialize( arp ) } );
+    }
+  }
+
+  // from every interface to every other, datagrams numbered in the order they are received
+  void receive_traffic()
+  {
+    for ( size_t from = 0; from < interface_count; from++ ) {
+      for ( size_t seqno = 0; seqno < datagrams_per_pair; seqno++ ) {
+        for ( size_t to = 0; to < interface_count; to++ ) {
+          if ( to == from ) {
+            continue;
+          }
+          InternetDatagram dgram { { .ttl = 64, .src = host( from ), .dst = host( to ) } };
+          dgram.payload.emplace_back( to_string( seqno ) );
+          dgram.header.len = dgram.header.hlen * 4 + dgram.payload.back()->size();
+          dgram.header.compute_checksum();
+          router.interface( from )->datagrams_received().push( move( dgram ) );
+        }
+      }
+    }
+  }
+
+  // every interface sent every datagram meant for it, and each source's datagrams in order
+  void check_sent( const string& when )
+  {
+    for ( size_t to = 0; to < interface_count; to++ ) {
+      vector<size_t> next_seqno( interface_count );
+      auto& frames = ports.at( to )->frames;
+      for ( ; not frames.empty(); frames.pop() ) {
+        InternetDatagram dgram;
+        if ( not parse( dgram, frames.front().payload )
+             or frames.front().header.dst != ethernet_address( 1000 + to ) or dgram.header.dst != host( to )
+             or dgram.header.ttl != 63 ) {
+          throw runtime_error( when + ": interface " + to_string( to ) + " sent an unexpected frame" );
+        }
+        const size_t from = ( dgram.header.src >> 16 ) & 0xff;
+        if ( concat( dgram.payload ) != to_string( next_seqno.at( from ) ) ) {
+          throw runtime_error( when + ": datagrams from " + to_string( from ) + " to " + to_string( to )
+                               + " were reordered" );
+        }
+        next_seqno.at( from )++;
+      }
+
+      for ( size_t from = 0; from < interface_count; from++ ) {
+        if ( from != to and next_seqno[from] != datagrams_per_pair ) {
+          throw runtime_error( when + ": interface " + to_string( to ) + " sent "
+                               + to_string( next_seqno[from] ) + " datagrams from " + to_string( from ) );
+        }
+      }
+    }
+  }
+};
+
+void test_threads( TestRouter& test, const size_t threads )
+{
+  test.router.set_threads( threads );
+  for ( unsigned round = 0; round < 3; round++ ) {
+    test.receive_traffic();
+    test.router.route();
+    test.check_sent( to_string( threads ) + " threads, round " + to_string( round ) );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    TestRouter test;
+    test.router.enable_route_cache();
+    for ( const size_t threads : { 1, 3, 2, 1, 4 } ) {
+      test_threads( test, threads );
+    }
+
+    // five thread counts, three rounds each
+    const auto stats = test.router.route_cache_stats();
+    const size_t lookups = 5 * 3 * interface_count * ( interface_count - 1 ) * datagrams_per_pair;
+    if ( not stats.has_value() or stats->hits + stats->misses != lookups ) {
+      throw runtime_error( "route caches did not count every lookup" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include "tcp_over_udp.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+UDPSocket bound_socket()
+{
+  UDPSocket socket;
+  socket.bind( Address { "127.0.0.1", 0 } );
+  return socket;
+}
+
+TCPMessage message( const uint32_t seqno, string payload, const bool SYN = false )
+{
+  return { .sender = TCPSenderMessage { .seqno = Wrap32 { seqno }, .SYN = SYN, .payload = move( payload ) },
+           .receiver = TCPReceiverMessage { .window_size = 1000 } };
+}
+
+// read until `count` segments have arrived (or a second has passed)
+vector<TCPMessage> read_segments( TCPOverUDPAdapter& adapter, const size_t count )
+{
+  vector<TCPMessage> segs;
+  for ( size_t attempt = 0; segs.size() < count and attempt < 1000; attempt++ ) {
+    if ( adapter.read( segs ) == 0 ) {
+      this_thread::sleep_for( chrono::milliseconds { 1 } );
+    }
+  }
+  if ( segs.size() != count ) {
+    throw runtime_error( "expected " + to_string( count ) + " segments, got " + to_string( segs.size() ) );
+  }
+  return segs;
+}
+
+void test_adapter( const bool segmentation_offload )
+{
+  UDPSocket client_socket = bound_socket();
+  UDPSocket server_socket = bound_socket();
+  UDPSocket stranger = bound_socket();
+  const Address client_address = client_socket.local_address();
+  const Address server_address = server_socket.local_address();
+
+  TCPOverUDPAdapter client { move( client_socket ), segmentation_offload };
+  client.config_mut().source = client_address;
+  client.config_mut().destination = server_address;
+
+  TCPOverUDPAdapter server { move( server_socket ), segmentation_offload };
+  server.config_mut().source = server_address;
+  server.set_listening( true );
+
+  // a listening adapter ignores everything but a SYN, and then takes the sender of the SYN as its peer
+  client.write( message( 1, "not a SYN" ) );
+  client.write( message( 2, "", true ) );
+  const auto syn = read_segments( server, 1 );
+  if ( not syn.front().sender->SYN or server.listening() or server.config().destination != client_address ) {
+    throw runtime_error( "listening adapter did not accept the SYN" );
+  }
+
+  // datagrams from anyone else are ignored
+  stranger.sendto( server_address, "hello" );
+  TCPSegment forged { .message = message( 3, "forged" ) };
+  stranger.sendto( server_address, forged.serialize_with_checksum( 0 ) );
+
+  // a burst of full-size segments, and a shorter one (with offload, all in one write)
+  vector<TCPMessage> burst;
+  for ( uint32_t i = 0; i < 20; i++ ) {
+    burst.push_back( message( 1000 * i, string( 1000, static_cast<char>( 'a' + i ) ) ) );
+  }
+  burst.push_back( message( 20000, "short" ) );
+
+  const unsigned writes_before = client.fd().write_count();
+  client.write( burst );
+  const unsigned writes = client.fd().write_count() - writes_before;
+  if ( writes != ( segmentation_offload ? 1 : burst.size() ) ) {
+    throw runtime_error( "burst took " + to_string( writes ) + " datagram writes" );
+  }
+
+  const auto received = read_segments( server, burst.size() );
+  for ( size_t i = 0; i < burst.size(); i++ ) {
+    if ( received[i].sender->seqno != burst[i].sender->seqno
+         or received[i].sender->payload != burst[i].sender->payload
+         or received[i].receiver->window_size != 1000 ) {
+      throw runtime_error( "segment " + to_string( i ) + " arrived changed" );
+    }
+  }
+
+  // the other way, one at a time (a datagram sent on the loopback interface is waiting once sent)
+  server.write( message( 7, "reply" ) );
+  const auto reply = client.read();
+  if ( not reply.has_value() or reply->sender->payload != "reply" ) {
+    throw runtime_error( "reply did not arrive" );
+  }
+
+  if ( server.read_stats().datagrams < burst.size() + 4 ) {
+    throw runtime_error( "read_stats did not count every datagram" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test_adapter( false );
+    test_adapter( true );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
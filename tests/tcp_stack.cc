@@ -0,0 +1,135 @@
+#include "tcp_minnow_stack.hh"
+
+#include "exception.hh"
+
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+pair<FileDescriptor, FileDescriptor> datagram_socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+string read_until_eof( TCPStackSocket& socket )
+{
+  string ret;
+  while ( not socket.eof() ) {
+    string buffer;
+    socket.read( buffer );
+    ret.append( buffer );
+  }
+  return ret;
+}
+
+void expect_equal( const string& what, const string& expected, const string& actual )
+{
+  if ( expected != actual ) {
+    throw runtime_error( what + ": expected \"" + expected + "\", got \"" + actual + "\"" );
+  }
+}
+
+void test_stacks( const size_t server_workers, const size_t client_workers )
+{
+  constexpr size_t num_connections = 8;
+  constexpr uint16_t server_port = 5144;
+
+  TCPConfig c_tcp;
+  c_tcp.rt_timeout = 20;
+
+  auto [server_fd, client_fd] = datagram_socket_pair();
+  TCPMinnowStack server { move( server_fd ), server_workers };
+  TCPMinnowStack client { move( client_fd ), client_workers };
+
+  FdAdapterConfig server_config;
+  server_config.source = Address { "10.144.0.1", server_port };
+  server.listen( c_tcp, server_config, num_connections );
+
+  // open every connection before accepting any: the listener's backlog must hold all of them
+  map<uint16_t, TCPStackSocket> client_sockets;
+  for ( size_t i = 0; i < num_connections; i++ ) {
+    FdAdapterConfig client_config;
+    client_config.source = Address { "10.144.0.2" };
+    client_config.destination = server_config.source;
+    auto socket = client.connect( c_tcp, client_config );
+    const uint16_t port = socket.local_address().port();
+    socket.write( "hello from port " + to_string( port ) );
+    socket.shutdown( SHUT_WR );
+    if ( not client_sockets.emplace( port, move( socket ) ).second ) {
+      throw runtime_error( "two connections share local port " + to_string( port ) );
+    }
+  }
+
+  if ( client.connection_count() != num_connections ) {
+    throw runtime_error( "client stack has " + to_string( client.connection_count() ) + " connections, expected "
+                         + to_string( num_connections ) );
+  }
+
+  for ( size_t i = 0; i < num_connections; i++ ) {
+    auto socket = server.accept( server_port );
+    const uint16_t port = socket.peer_address().port();
+    if ( not client_sockets.contains( port ) ) {
+      throw runtime_error( "accepted connection from unknown port " + to_string( port ) );
+    }
+    expect_equal( "server received", "hello from port " + to_string( port ), read_until_eof( socket ) );
+    socket.write( "goodbye to port " + to_string( port ) );
+  }
+
+  for ( auto& [port, socket] : client_sockets ) {
+    expect_equal( "client received", "goodbye to port " + to_string( port ), read_until_eof( socket ) );
+  }
+}
+
+// a connection to an address that never answers fails once its SYN has been retransmitted too many times
+void test_unanswered_connect()
+{
+  TCPConfig c_tcp;
+  c_tcp.rt_timeout = 2;
+
+  auto [client_fd, silent_fd] = datagram_socket_pair(); // nothing reads from silent_fd
+  TCPMinnowStack client { move( client_fd ), 1 };
+
+  FdAdapterConfig client_config;
+  client_config.source = Address { "10.144.0.2" };
+  client_config.destination = Address { "10.144.0.1", 5144 };
+  try {
+    client.connect( c_tcp, client_config );
+  } catch ( const runtime_error& ) {
+    return;
+  }
+  throw runtime_error( "connect() to an address that never answers should have failed" );
+}
+
+void program_body()
+{
+  test_stacks( 1, 1 );
+
+  // connections sharded across workers (with a dispatcher thread) on one or both sides
+  test_stacks( 3, 1 );
+  test_stacks( 2, 4 );
+
+  test_unanswered_connect();
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+#include "tcp_minnow_stack.hh"
+
+#include "exception.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+//! A connected pair of datagram sockets standing in for a link between two hosts
+pair<FileDescriptor, FileDescriptor> link_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_SEQPACKET, 0, fds.data() ) );
+  for ( const int fd : fds ) {
+    const int buffer_size = 4 * 1024 * 1024;
+    CheckSystemCall( "setsockopt", setsockopt( fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof( buffer_size ) ) );
+  }
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+double speed_test( fstream& debug_output,
+                   const size_t num_workers, // NOLINT(bugprone-easily-swappable-parameters)
+                   const size_t num_flows,   // NOLINT(bugprone-easily-swappable-parameters)
+                   const size_t bytes_per_flow )
+{
+  constexpr uint16_t server_port = 5144;
+
+  TCPConfig c_tcp;
+  c_tcp.rt_timeout = 10;
+
+  auto [server_fd, client_fd] = link_pair();
+  TCPMinnowStack server { move( server_fd ), num_workers };
+  TCPMinnowStack client { move( client_fd ), num_workers };
+
+  FdAdapterConfig server_config;
+  server_config.source = Address { "10.144.0.1", server_port };
+  server.listen( c_tcp, server_config, num_flows );
+
+  const string chunk( 65536, 'x' );
+
+  const auto start_time = steady_clock::now();
+
+  // each flow sends from its own thread; the main thread accepts and hands each connection to a reader
+  vector<thread> senders;
+  for ( size_t i = 0; i < num_flows; i++ ) {
+    FdAdapterConfig client_config;
+    client_config.source = Address { "10.144.0.2" };
+    client_config.destination = server_config.source;
+    senders.emplace_back( [&client, &chunk, c_tcp, client_config, bytes_per_flow] {
+      auto socket = client.connect( c_tcp, client_config );
+      for ( size_t sent = 0; sent < bytes_per_flow; ) {
+        sent += socket.write( string_view { chunk }.substr( 0, bytes_per_flow - sent ) );
+      }
+      socket.shutdown( SHUT_WR );
+      string buffer;
+      while ( not socket.eof() ) {
+        buffer.clear();
+        socket.read( buffer );
+      }
+    } );
+  }
+
+  vector<size_t> received( num_flows );
+  vector<thread> receivers;
+  for ( size_t i = 0; i < num_flows; i++ ) {
+    receivers.emplace_back( [&received, i, socket = make_shared<TCPStackSocket>( server.accept( server_port ) )] {
+      string buffer;
+      while ( not socket->eof() ) {
+        buffer.clear();
+        socket->read( buffer );
+        received[i] += buffer.size();
+      }
+    } );
+  }
+
+  for ( auto& receiver : receivers ) {
+    receiver.join();
+  }
+
+  const auto stop_time = steady_clock::now();
+
+  for ( auto& sender : senders ) {
+    sender.join();
+  }
+
+  for ( const auto bytes : received ) {
+    if ( bytes != bytes_per_flow ) {
+      throw runtime_error( "flow received " + to_string( bytes ) + " bytes, expected "
+                           + to_string( bytes_per_flow ) );
+    }
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const auto gigabits_per_second
+    = 8 * static_cast<double>( num_flows * bytes_per_flow ) / test_duration.count() / 1e9;
+
+  cout << "TCPMinnowStack with workers=" << num_workers << ", flows=" << num_flows << " reached " << fixed
+       << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "   TCPMinnowStack throughput (" << num_workers << " worker"
+               << ( num_workers == 1 ? "):  " : "s): " ) << fixed << setprecision( 2 ) << setw( 5 )
+               << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.05 ) {
+    throw runtime_error( "TCPMinnowStack did not meet minimum speed of 0.05 Gbit/s" );
+  }
+
+  return gigabits_per_second;
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  constexpr size_t num_flows = 8;
+  constexpr size_t bytes_per_flow = 1 << 21;
+
+  // the scaling from more workers depends on the number of cores available
+  speed_test( debug_output, 1, num_flows, bytes_per_flow );
+  speed_test( debug_output, 2, num_flows, bytes_per_flow );
+  speed_test( debug_output, 4, num_flows, bytes_per_flow );
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
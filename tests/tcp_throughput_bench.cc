@@ -0,0 +1,197 @@
+#include "loopback_adapter.hh"
+#include "tcp_peer.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+struct BenchConfig
+{
+  size_t mss;
+  size_t window;
+  double loss;
+};
+
+struct BenchResult
+{
+  double gigabits_per_second;
+  double segments_per_second;
+  uint64_t retransmissions;
+};
+
+//! Two TCPPeers connected by a pair of LoopbackAdapters, run in one thread
+class LoopbackBench
+{
+  TCPPeer sender_;
+  TCPPeer receiver_;
+  LossyFdAdapter<LoopbackAdapter> sender_end_;
+  LossyFdAdapter<LoopbackAdapter> receiver_end_;
+  Wrap32 isn_;
+
+  uint64_t next_seqno_ {}; // the absolute sequence number after the last one sent so far
+  uint64_t segments_ {};
+  uint64_t retransmissions_ {};
+  vector<TCPMessage> segs_ {};
+
+  // count the segments the sender sends, and which resend sequence numbers it has sent before
+  void sent( const TCPMessage& msg )
+  {
+    const size_t length = msg.sender->sequence_length();
+    if ( length == 0 ) {
+      return;
+    }
+    segments_++;
+    const uint64_t seqno = msg.sender->seqno.unwrap( isn_, next_seqno_ );
+    if ( seqno < next_seqno_ ) {
+      retransmissions_++;
+    }
+    next_seqno_ = max( next_seqno_, seqno + length );
+  }
+
+  // deliver the messages that have arrived at `end` to `peer`
+  bool deliver( LossyFdAdapter<LoopbackAdapter>& end, TCPPeer& peer, const TCPPeer::TransmitFunction& transmit )
+  {
+    segs_.clear();
+    end.read( segs_ );
+    for ( auto& seg : segs_ ) {
+      peer.receive( move( seg ), transmit );
+    }
+    return not segs_.empty();
+  }
+
+public:
+  LoopbackBench( const TCPConfig& config,
+                 pair<LoopbackAdapter, LoopbackAdapter> ends,
+                 const uint16_t loss_rate )
+    : sender_( config )
+    , receiver_( config )
+    , sender_end_( move( ends.first ) )
+    , receiver_end_( move( ends.second ) )
+    , isn_( config.isn )
+  {
+    sender_end_.config_mut().loss_rate_up = loss_rate;
+    receiver_end_.config_mut().loss_rate_up = loss_rate;
+  }
+
+  BenchResult run( const string& data, const size_t total_bytes )
+  {
+    const TCPPeer::TransmitFunction send_data = [&]( const TCPMessage& msg ) {
+      sent( msg );
+      sender_end_.write( msg );
+    };
+    const TCPPeer::TransmitFunction send_ack = [&]( const TCPMessage& msg ) { receiver_end_.write( msg ); };
+
+    size_t pushed = 0;
+    size_t received = 0;
+
+    const auto start_time = steady_clock::now();
+    while ( received < total_bytes ) {
+      // the application writes as much as the sender has room for
+      Writer& writer = sender_.outbound_writer();
+      while ( pushed < total_bytes and writer.available_capacity() > 0 ) {
+        const size_t offset = pushed % data.size();
+        const size_t length = min(
+          { data.size() - offset, total_bytes - pushed, static_cast<size_t>( writer.available_capacity() ) } );
+        writer.push( data.substr( offset, length ) );
+        pushed += length;
+      }
+      if ( pushed == total_bytes and not writer.is_closed() ) {
+        writer.close();
+      }
+      sender_.push( send_data );
+
+      bool progress = deliver( receiver_end_, receiver_, send_ack );
+
+      // the application reads (and checks) what has arrived
+      Reader& reader = receiver_.inbound_reader();
+      while ( reader.bytes_buffered() > 0 ) {
+        const string_view chunk = reader.peek();
+        const size_t offset = received % data.size();
+        const size_t length = min( chunk.size(), data.size() - offset );
+        if ( chunk.substr( 0, length ) != string_view { data }.substr( offset, length ) ) {
+          throw runtime_error( "received data differs from what was sent" );
+        }
+        reader.pop( length );
+        received += length;
+      }
+
+      progress |= deliver( sender_end_, sender_, send_data );
+
+      // when nothing is left to do now, let a simulated millisecond pass
+      if ( not progress ) {
+        sender_.tick( 1, send_data );
+        receiver_.tick( 1, send_ack );
+        sender_end_.tick( 1 );
+        receiver_end_.tick( 1 );
+      }
+    }
+    const auto duration = duration_cast<chrono::duration<double>>( steady_clock::now() - start_time ).count();
+
+    return { 8 * static_cast<double>( total_bytes ) / duration / 1e9,
+             static_cast<double>( segments_ ) / duration,
+             retransmissions_ };
+  }
+};
+
+BenchResult bench( const BenchConfig& bench_config, const string& data, const size_t total_bytes )
+{
+  TCPConfig config;
+  config.max_payload_size = bench_config.mss;
+  config.recv_capacity = bench_config.window;
+  config.send_capacity = bench_config.window;
+  config.rt_timeout = 10;
+
+  const auto loss_rate
+    = static_cast<uint16_t>( bench_config.loss * static_cast<double>( numeric_limits<uint16_t>::max() ) );
+  LoopbackBench loopback { config, LoopbackAdapter::make_pair(), loss_rate };
+  return loopback.run( data, total_bytes );
+}
+
+void program_body( const size_t total_bytes )
+{
+  string data( 1 << 20, 0 );
+  default_random_engine rd { 144 };
+  for ( auto& ch : data ) {
+    ch = static_cast<char>( rd() );
+  }
+
+  cout << "Two TCPPeers over an in-memory link, sending " << total_bytes / 1000000 << " MB each run\n\n";
+  cout << "   MSS   window   loss    Gbit/s   segments/s   retransmissions\n";
+
+  for ( const size_t mss : { 536, 1000, 1460 } ) {
+    for ( const size_t window : { 16000, 65000 } ) {
+      for ( const double loss : { 0.0, 0.01 } ) {
+        const auto result = bench( { mss, window, loss }, data, total_bytes );
+        cout << setw( 6 ) << mss << setw( 9 ) << window << setw( 6 ) << fixed << setprecision( 0 ) << loss * 100
+             << "%" << setw( 10 ) << setprecision( 2 ) << result.gigabits_per_second << setw( 13 )
+             << setprecision( 0 ) << result.segments_per_second << setw( 18 ) << result.retransmissions << "\n";
+      }
+    }
+  }
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    const auto args = span( argv, argc );
+    const size_t megabytes = args.size() > 1 ? stoul( args[1] ) : 32;
+    program_body( megabytes * 1000000 );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -29,7 +29,8 @@ string ARPMessage::to_string() const
   return ss.str();
 }
 
-void ARPMessage::parse( Parser& parser )
+template<class ParserT>
+void ARPMessage::parse( ParserT& parser )
 {
   parser.integer( hardware_type );
   parser.integer( protocol_type );
@@ -55,7 +56,11 @@ void ARPMessage::parse( Parser& parser )
   parser.integer( target_ip_address );
 }
 
-void ARPMessage::serialize( Serializer& serializer ) const
+template void ARPMessage::parse( Parser& );
+template void ARPMessage::parse( SpanParser& );
+
+template<class SerializerT>
+void ARPMessage::serialize( SerializerT& serializer ) const
 {
   if ( not supported() ) {
     throw runtime_error( "ARPMessage: unsupported field combination (must be Ethernet/IP, and request or reply)" );
@@ -79,3 +84,6 @@ void ARPMessage::serialize( Serializer& serializer ) const
   }
   serializer.integer( target_ip_address );
 }
+
+template void ARPMessage::serialize( Serializer& ) const;
+template void ARPMessage::serialize( HeaderSerializer& ) const;
@@ -30,6 +30,8 @@ struct ARPMessage
   // Is this type of ARP message supported by the parser?
   bool supported() const;
 
-  void parse( Parser& parser );
-  void serialize( Serializer& serializer ) const;
+  template<class ParserT> // Parser or SpanParser
+  void parse( ParserT& parser );
+  template<class SerializerT> // Serializer or HeaderSerializer
+  void serialize( SerializerT& serializer ) const;
 };
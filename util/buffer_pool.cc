@@ -0,0 +1,60 @@
+#include "buffer_pool.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+PooledBuffer::PooledBuffer( BufferPool& pool, const size_t index, const size_t size )
+  : storage_( size, 0 ), index_( index ), pool_( &pool )
+{}
+
+void PooledBuffer::drop_ref()
+{
+  if ( --refs_ ) {
+    return;
+  }
+  if ( pool_ ) {
+    pool_->give_back( *this );
+  } else {
+    delete this; // NOLINT(*-owning-memory): the pool let go of it when it was destroyed
+  }
+}
+
+BufferPool::BufferPool( const size_t buffer_size ) : buffer_size_( buffer_size ) {}
+
+PooledBuffer& BufferPool::take()
+{
+  if ( free_.empty() ) {
+    reserve( buffers_.size() + 1 );
+  }
+
+  PooledBuffer& buffer = *free_.back();
+  free_.pop_back();
+  return buffer;
+}
+
+void BufferPool::give_back( PooledBuffer& buffer )
+{
+  if ( buffer.pool_ != this or buffer.refs_ ) {
+    throw runtime_error( "BufferPool: buffer given back while it is referred to, or to the wrong pool" );
+  }
+  free_.push_back( &buffer );
+}
+
+void BufferPool::reserve( const size_t count )
+{
+  while ( buffers_.size() < count ) {
+    buffers_.push_back( make_unique<PooledBuffer>( *this, buffers_.size(), buffer_size_ ) );
+    free_.push_back( buffers_.back().get() );
+  }
+}
+
+BufferPool::~BufferPool()
+{
+  for ( auto& buffer : buffers_ ) {
+    if ( buffer->refs_ ) {
+      buffer->pool_ = nullptr;
+      buffer.release(); // NOLINT(*-unused-return-value): the last Ref frees it
+    }
+  }
+}
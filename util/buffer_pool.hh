@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class BufferPool;
+
+template<typename T>
+class Ref;
+
+//! \brief A fixed-size packet buffer that belongs to a BufferPool
+//! \details The buffer is read into once, then shared by the Refs (Ref<std::string>) to it, each of which
+//! may refer to just part of it (e.g. the payload after a parsed header). They count their references,
+//! and when the last one lets go, the buffer goes back to its pool to be read into again.
+class PooledBuffer
+{
+  std::string storage_; //!< Sized once and never reallocated (the kernel may be reading into it)
+  size_t index_;        //!< Position among the pool's buffers (e.g. to use it as an io_uring registered buffer)
+  BufferPool* pool_;    //!< Null once the pool has been destroyed
+  size_t refs_ {};
+
+  friend class BufferPool;
+  friend class Ref<std::string>;
+
+  void add_ref() { ++refs_; }
+  void drop_ref(); //!< Give the buffer back to its pool (or free it, if there is none) once unreferenced
+
+public:
+  PooledBuffer( BufferPool& pool, size_t index, size_t size );
+
+  //! Where to read (the storage can be written but must not be resized)
+  std::string& storage() { return storage_; }
+  const std::string& storage() const { return storage_; }
+
+  size_t index() const { return index_; }
+
+  //! \name
+  //! Refs point to the buffer, so it cannot be moved or copied
+
+  //!@{
+  PooledBuffer( const PooledBuffer& other ) = delete;
+  PooledBuffer& operator=( const PooledBuffer& other ) = delete;
+  PooledBuffer( PooledBuffer&& other ) = delete;
+  PooledBuffer& operator=( PooledBuffer&& other ) = delete;
+  ~PooledBuffer() = default;
+  //!@}
+};
+
+//! \brief Fixed-size packet buffers, reused so that packet processing in a steady state doesn't allocate them
+//! \details A packet is read directly into a buffer taken from the pool, and handed on as a Ref that shares
+//! the buffer (Ref<std::string>{ buffer, length }); parsing narrows Refs to the parts they refer to, without
+//! copying. A pool is not thread-safe: each thread keeps its own, and Refs to its buffers that are handed to
+//! another thread come back through a queue before they are dropped.
+class BufferPool
+{
+  size_t buffer_size_;
+  std::vector<std::unique_ptr<PooledBuffer>> buffers_ {}; //!< Every buffer (so that each stays put)
+  std::vector<PooledBuffer*> free_ {};
+
+public:
+  //! \param[in] buffer_size is the size of every buffer (the longest packet that can be read into one)
+  explicit BufferPool( size_t buffer_size );
+
+  //! A buffer that nothing refers to yet (a new one only if none is free). The caller shares it by
+  //! constructing a Ref to it, or gives it back (e.g. if a read found nothing).
+  PooledBuffer& take();
+
+  //! Return a taken buffer that no Ref refers to
+  void give_back( PooledBuffer& buffer );
+
+  //! Allocate buffers (ready to take) until there are at least `count`, e.g. to register them with io_uring
+  void reserve( size_t count );
+
+  //! Buffer `index` (indices count the buffers in the order they were allocated)
+  PooledBuffer& at( size_t index ) { return *buffers_.at( index ); }
+
+  size_t buffer_size() const { return buffer_size_; }
+
+  //! Number of buffers allocated (which stops growing once every buffer is reused)
+  size_t allocated() const { return buffers_.size(); }
+
+  //! Number of buffers ready for reuse
+  size_t available() const { return free_.size(); }
+
+  //! \name
+  //! Buffers point back to their pool, so it cannot be moved or copied
+
+  //!@{
+  BufferPool( const BufferPool& other ) = delete;
+  BufferPool& operator=( const BufferPool& other ) = delete;
+  BufferPool( BufferPool&& other ) = delete;
+  BufferPool& operator=( BufferPool&& other ) = delete;
+  //!@}
+
+  //! Free the buffers, except those that Refs still refer to (which are freed when the last one lets go)
+  ~BufferPool();
+};
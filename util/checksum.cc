@@ -0,0 +1,151 @@
+#include "checksum.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+//! One's-complement sum of `data` as 16-bit words in the machine's byte order, not yet folded, and
+//! (if `Copy`) a copy of `data` at `copy_to`, made in the same pass.
+//! Each 64-bit word is added as two 32-bit halves, so the 64-bit total can't overflow.
+template<bool Copy>
+uint64_t sum_scalar( const char* data, size_t length, [[maybe_unused]] char* copy_to )
+{
+  uint64_t total = 0;
+  for ( ; length >= sizeof( uint64_t ); length -= sizeof( uint64_t ), data += sizeof( uint64_t ) ) {
+    uint64_t word {};
+    memcpy( &word, data, sizeof( word ) );
+    total += ( word & UINT32_MAX ) + ( word >> 32 );
+    if constexpr ( Copy ) {
+      memcpy( copy_to, &word, sizeof( word ) );
+      copy_to += sizeof( word );
+    }
+  }
+
+  // the remaining bytes, padded with zeros (so a final odd byte is the high-order byte of its word)
+  uint64_t word {};
+  memcpy( &word, data, length );
+  if constexpr ( Copy ) {
+    memcpy( copy_to, data, length );
+  }
+  return total + ( word & UINT32_MAX ) + ( word >> 32 );
+}
+
+#if defined( __x86_64__ )
+template<bool Copy>
+__attribute__( ( target( "avx2" ) ) ) uint64_t sum_avx2( const char* data, size_t length, char* copy_to )
+{
+  constexpr size_t block = sizeof( __m256i );
+
+  // Each 32-bit lane gains one 16-bit word per block, so the lanes are flushed to `total` before they can
+  // overflow.
+  constexpr size_t max_blocks_per_flush = 32768;
+
+  uint64_t total = 0;
+  const __m256i zero = _mm256_setzero_si256();
+  while ( length >= block ) {
+    size_t blocks = min( length / block, max_blocks_per_flush );
+    length -= blocks * block;
+
+    __m256i low = zero;
+    __m256i high = zero;
+    for ( ; blocks > 0; blocks--, data += block ) {
+      const auto* const source = reinterpret_cast<const __m256i*>( data ); // NOLINT(*-reinterpret-cast)
+      const __m256i v = _mm256_loadu_si256( source );
+      low = _mm256_add_epi32( low, _mm256_unpacklo_epi16( v, zero ) );
+      high = _mm256_add_epi32( high, _mm256_unpackhi_epi16( v, zero ) );
+      if constexpr ( Copy ) {
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( copy_to ), v ); // NOLINT(*-reinterpret-cast)
+        copy_to += block;
+      }
+    }
+
+    // widen the 32-bit lanes to 64 bits and add them up
+    const __m256i wide = _mm256_add_epi64( _mm256_add_epi64( _mm256_unpacklo_epi32( low, zero ),
+                                                             _mm256_unpackhi_epi32( low, zero ) ),
+                                           _mm256_add_epi64( _mm256_unpacklo_epi32( high, zero ),
+                                                             _mm256_unpackhi_epi32( high, zero ) ) );
+    const __m128i half = _mm_add_epi64( _mm256_castsi256_si128( wide ), _mm256_extracti128_si256( wide, 1 ) );
+    total += static_cast<uint64_t>( _mm_cvtsi128_si64( half ) )
+             + static_cast<uint64_t>( _mm_extract_epi64( half, 1 ) );
+  }
+
+  // blocks are an even number of bytes, so the rest starts on a word boundary
+  return total + sum_scalar<Copy>( data, length, copy_to );
+}
+#endif
+
+//! Fold a one's-complement sum to 16 bits and put it in network byte order
+uint16_t fold( uint64_t total )
+{
+  while ( total > 0xffff ) {
+    total = ( total >> 16 ) + ( total & 0xffff );
+  }
+
+  const auto ret = static_cast<uint16_t>( total );
+  if constexpr ( endian::native == endian::little ) {
+    return static_cast<uint16_t>( ret << 8 | ret >> 8 );
+  }
+  return ret;
+}
+} // namespace
+
+bool InternetChecksum::supported( const Kernel kernel )
+{
+  switch ( kernel ) {
+    case Kernel::Scalar:
+      return true;
+    case Kernel::AVX2:
+#if defined( __x86_64__ )
+      return __builtin_cpu_supports( "avx2" );
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+InternetChecksum::Kernel InternetChecksum::best_kernel()
+{
+  static const Kernel best = supported( Kernel::AVX2 ) ? Kernel::AVX2 : Kernel::Scalar;
+  return best;
+}
+
+uint16_t InternetChecksum::sum( const string_view data, const Kernel kernel )
+{
+  switch ( kernel ) {
+    case Kernel::Scalar:
+      return fold( sum_scalar<false>( data.data(), data.size(), nullptr ) );
+    case Kernel::AVX2:
+#if defined( __x86_64__ )
+      if ( best_kernel() == Kernel::AVX2 ) {
+        return fold( sum_avx2<false>( data.data(), data.size(), nullptr ) );
+      }
+#endif
+      break;
+  }
+  throw runtime_error( "InternetChecksum: kernel not supported by this CPU" );
+}
+
+uint16_t InternetChecksum::copy_and_sum( char* dst, const string_view data, const Kernel kernel )
+{
+  switch ( kernel ) {
+    case Kernel::Scalar:
+      return fold( sum_scalar<true>( data.data(), data.size(), dst ) );
+    case Kernel::AVX2:
+#if defined( __x86_64__ )
+      if ( best_kernel() == Kernel::AVX2 ) {
+        return fold( sum_avx2<true>( data.data(), data.size(), dst ) );
+      }
+#endif
+      break;
+  }
+  throw runtime_error( "InternetChecksum: kernel not supported by this CPU" );
+}
@@ -1,38 +1,89 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <ranges>
+#include <string_view>
 
 //! The internet checksum algorithm
+//! \details The one's-complement sum is computed a machine word (or with AVX2, 32 bytes) at a time in
+//! the machine's byte order, and byte-swapped to network order once at the end, which gives the same
+//! result ([RFC 1071](\ref rfc::rfc1071), section 2).
 class InternetChecksum
 {
+public:
+  //! Implementations of the one's-complement sum
+  enum class Kernel : uint8_t
+  {
+    Scalar, //!< 64-bit words, on any CPU
+    AVX2    //!< 256-bit vectors, on x86-64 CPUs that support AVX2
+  };
+
+  //! Whether the CPU can run `kernel`
+  static bool supported( Kernel kernel );
+
+  //! The fastest kernel the CPU supports (chosen once, at the first call)
+  static Kernel best_kernel();
+
+  //! Shorter data is summed by Kernel::Scalar, which is faster when there is too little to vectorize
+  static constexpr size_t MIN_VECTOR_LENGTH = 256;
+
+  //! One's-complement sum of `data` as big-endian 16-bit words (with a final odd byte padded with zero),
+  //! folded to 16 bits
+  static uint16_t sum( std::string_view data )
+  {
+    return sum( data, data.size() < MIN_VECTOR_LENGTH ? Kernel::Scalar : best_kernel() );
+  }
+  static uint16_t sum( std::string_view data, Kernel kernel );
+
+  //! Copy `data` to `dst` (which must have room for it), and return the same sum as sum(), in one pass
+  static uint16_t copy_and_sum( char* dst, std::string_view data )
+  {
+    return copy_and_sum( dst, data, data.size() < MIN_VECTOR_LENGTH ? Kernel::Scalar : best_kernel() );
+  }
+  static uint16_t copy_and_sum( char* dst, std::string_view data, Kernel kernel );
+
+  //! The checksum after a 16-bit word of the checksummed data changes from `old_word` to `new_word`,
+  //! computed from the old checksum ([RFC 1624](\ref rfc::rfc1624), equation 3)
+  static uint16_t update( uint16_t checksum, uint16_t old_word, uint16_t new_word )
+  {
+    // HC' = ~(~HC + ~m + m'), in one's-complement arithmetic
+    uint32_t ret = static_cast<uint16_t>( ~checksum );
+    ret += static_cast<uint16_t>( ~old_word );
+    ret += new_word;
+    ret = ( ret >> 16 ) + ( ret & 0xffff );
+    ret += ret >> 16;
+    return ~static_cast<uint16_t>( ret );
+  }
+
+  //! The checksum after a 32-bit field (e.g. an address) of the checksummed data changes
+  static uint16_t update32( const uint16_t checksum, const uint32_t old_value, const uint32_t new_value )
+  {
+    const uint16_t high = update( checksum, old_value >> 16, new_value >> 16 );
+    return update( high, static_cast<uint16_t>( old_value ), static_cast<uint16_t>( new_value ) );
+  }
+
 private:
-  uint32_t sum_;
-  bool parity_ {};
+  uint64_t sum_;
+  bool parity_ {}; //!< Whether an odd number of bytes have been added (so the next byte is a low-order byte)
 
 public:
   explicit InternetChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
-  void add( std::string_view data )
-  {
-    for ( const uint8_t i : data ) {
-      uint16_t val = i;
-      if ( not parity_ ) {
-        val <<= 8;
-      }
-      sum_ += val;
-      parity_ = !parity_;
-    }
-  }
+
+  void add( std::string_view data ) { add_partial( sum( data ), data.size() ); }
+
+  //! Add `data`, copying it to `dst` (which must have room for it) in the same pass
+  void add_and_copy( std::string_view data, char* dst ) { add_partial( copy_and_sum( dst, data ), data.size() ); }
 
   uint16_t value() const
   {
-    uint32_t ret = sum_;
+    uint64_t ret = sum_;
 
     while ( ret > 0xffff ) {
       ret = ( ret >> 16 ) + static_cast<uint16_t>( ret );
     }
 
-    return ~ret;
+    return ~static_cast<uint16_t>( ret );
   }
 
   void add( std::ranges::range auto&& data )
@@ -41,4 +92,16 @@ public:
       add( std::string_view { x } );
     }
   }
+
+private:
+  //! Add the sum of `length` bytes
+  void add_partial( uint16_t partial, const size_t length )
+  {
+    if ( parity_ ) {
+      // data that starts at an odd offset contributes the byte-swapped sum
+      partial = static_cast<uint16_t>( partial << 8 | partial >> 8 );
+    }
+    sum_ += partial;
+    parity_ ^= ( length & 1 ) != 0;
+  }
 };
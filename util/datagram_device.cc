@@ -0,0 +1,258 @@
+#include "datagram_device.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <span>
+
+using namespace std;
+
+namespace {
+// io_uring user data: reads are tagged with the index of their buffer, writes with their slot
+constexpr uint64_t WRITE_TAG = uint64_t { 1 } << 32;
+constexpr uint64_t CANCEL_TAG = uint64_t { 2 } << 32;
+} // namespace
+
+DatagramDevice::Backend DatagramDevice::default_backend()
+{
+  return IOUring::supported() ? Backend::IOUring : Backend::Syscalls;
+}
+
+DatagramDevice::DatagramDevice( FileDescriptor&& fd, const size_t read_depth, const Backend backend )
+  : fd_( move( fd ) ), read_depth_( read_depth )
+{
+  if ( backend == Backend::Syscalls ) {
+    fd_.set_blocking( false );
+    return;
+  }
+
+  // io_uring waits for the device asynchronously (a non-blocking device would fail operations with EAGAIN)
+  fd_.set_blocking( true );
+  ring_.emplace( static_cast<unsigned>( read_depth_ + MAX_WRITES ) );
+
+  // the pool's first buffers are registered, and the reads start in them
+  pool_.reserve( read_depth_ );
+  vector<iovec> iovecs;
+  for ( size_t i = 0; i < read_depth_; i++ ) {
+    auto& storage = pool_.at( i ).storage();
+    iovecs.push_back( { storage.data(), storage.size() } );
+  }
+  for ( size_t i = 0; i < read_depth_; i++ ) {
+    read_buffers_.push_back( &pool_.take() );
+  }
+  reading_.assign( read_depth_, false );
+  if ( read_depth_ > 0 ) {
+    try {
+      ring_->register_buffers( iovecs );
+      registered_buffers_ = read_depth_;
+    } catch ( const unix_error& e ) {
+      // e.g. over the locked-memory limit: read into the same buffers without registering them
+      cerr << "DatagramDevice: not registering io_uring buffers (" << e.what() << ")\n";
+    }
+  }
+
+  write_buffers_.resize( MAX_WRITES );
+  write_iovecs_.resize( MAX_WRITES );
+  free_write_slots_.resize( MAX_WRITES );
+  iota( free_write_slots_.rbegin(), free_write_slots_.rend(), 0 );
+
+  for ( size_t i = 0; i < read_depth_; i++ ) {
+    start_read( i );
+  }
+  ring_->submit();
+}
+
+DatagramDevice::~DatagramDevice()
+{
+  if ( not ring_ ) {
+    return;
+  }
+
+  try {
+    // the kernel may still be writing into read buffers (or reading from write buffers), so finish every
+    // operation before the buffers are freed
+    for ( size_t i = 0; i < read_depth_; i++ ) {
+      if ( reading_[i] ) {
+        ring_->cancel( i, CANCEL_TAG );
+      }
+    }
+    vector<bool> writing( MAX_WRITES, true );
+    for ( const auto slot : free_write_slots_ ) {
+      writing[slot] = false;
+    }
+    for ( size_t slot = 0; slot < MAX_WRITES; slot++ ) {
+      if ( writing[slot] ) {
+        ring_->cancel( WRITE_TAG | slot, CANCEL_TAG );
+      }
+    }
+
+    read_depth_ = 0; // don't restart reads as they finish
+    while ( ranges::find( reading_, true ) != reading_.end() or free_write_slots_.size() < MAX_WRITES ) {
+      ring_->submit_and_wait( 1 );
+      process_completions();
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception destructing DatagramDevice: " << e.what() << "\n";
+  }
+}
+
+void DatagramDevice::start_read( const size_t index )
+{
+  PooledBuffer& buffer = *read_buffers_[index];
+  const bool queued
+    = buffer.index() < registered_buffers_
+        ? ring_->read_fixed( fd_, buffer.storage(), static_cast<uint16_t>( buffer.index() ), index )
+        : ring_->read( fd_, buffer.storage(), index );
+  if ( not queued ) {
+    throw runtime_error( "DatagramDevice: io_uring submission ring is full" );
+  }
+  reading_[index] = true;
+}
+
+void DatagramDevice::process_completions()
+{
+  completions_.clear();
+  ring_->reap( completions_ );
+
+  for ( const auto& [user_data, result] : completions_ ) {
+    if ( user_data == CANCEL_TAG ) {
+      continue;
+    }
+
+    if ( user_data & WRITE_TAG ) {
+      free_write_slots_.push_back( static_cast<uint32_t>( user_data & ~WRITE_TAG ) );
+      if ( result < 0 ) {
+        // the device can't take the datagram right now
+        if ( result != -EAGAIN and result != -ENOBUFS and result != -ECANCELED ) {
+          throw unix_error( "io_uring write", -result );
+        }
+        ++dropped_;
+      }
+      continue;
+    }
+
+    const size_t index = user_data;
+    reading_[index] = false;
+    if ( result > 0 ) {
+      // the datagram keeps the buffer it was read into, and the next read goes into another
+      received_.emplace_back( *read_buffers_[index], static_cast<size_t>( result ) );
+      read_buffers_[index] = &pool_.take();
+    } else if ( result == 0 ) {
+      eof_ = true;
+      continue;
+    } else if ( result != -EAGAIN and result != -EINTR and result != -ECANCELED ) {
+      throw unix_error( "io_uring read", -result );
+    }
+
+    if ( index < read_depth_ ) {
+      start_read( index );
+    }
+  }
+}
+
+void DatagramDevice::read( vector<Ref<string>>& datagrams )
+{
+  if ( not ring_ ) {
+    // drain the device (up to a batch) until it would block
+    for ( size_t i = 0; i < max( read_depth_, size_t { 1 } ); i++ ) {
+      auto datagram = fd_.read( pool_ );
+      if ( datagram.empty() ) {
+        eof_ = fd_.eof();
+        break;
+      }
+      datagrams.push_back( move( datagram ) );
+    }
+    return;
+  }
+
+  // reset the eventfd, then collect what has finished and restart the reads
+  ring_->completion_fd().read( event_count_ );
+  process_completions();
+  ring_->submit();
+
+  for ( auto& datagram : received_ ) {
+    datagrams.push_back( move( datagram ) );
+  }
+  received_.clear();
+}
+
+void DatagramDevice::write( const vector<Ref<string>>& buffers )
+{
+  vector<string_view> views;
+  views.reserve( buffers.size() );
+  for ( const auto& buffer : buffers ) {
+    views.emplace_back( buffer.get() );
+  }
+  write( views );
+}
+
+void DatagramDevice::write( const span<const string_view> buffers )
+{
+  if ( not ring_ ) {
+    // keep the datagrams in order: write now only if none are waiting
+    if ( backlog_.empty() and fd_.write( buffers ) > 0 ) {
+      return;
+    }
+    if ( backlog_.size() >= MAX_WRITES ) {
+      ++dropped_;
+      return;
+    }
+    // the datagram is copied into a pooled buffer (or, if it is too long for one, a string of its own)
+    size_t size = 0;
+    for ( const auto buffer : buffers ) {
+      size += buffer.size();
+    }
+    if ( size > pool_.buffer_size() ) {
+      string datagram;
+      for ( const auto buffer : buffers ) {
+        datagram.append( buffer );
+      }
+      backlog_.emplace_back( move( datagram ) );
+      return;
+    }
+    PooledBuffer& datagram = pool_.take();
+    char* next = datagram.storage().data();
+    for ( const auto buffer : buffers ) {
+      next = ranges::copy( buffer, next ).out;
+    }
+    backlog_.emplace_back( datagram, size );
+    return;
+  }
+
+  if ( free_write_slots_.empty() ) {
+    process_completions();
+    if ( free_write_slots_.empty() ) {
+      ++dropped_;
+      return;
+    }
+  }
+
+  // the buffers may be borrowed, so the datagram is copied into a slot that lives until the write finishes
+  const uint32_t slot = free_write_slots_.back();
+  free_write_slots_.pop_back();
+  auto& datagram = write_buffers_[slot];
+  datagram.clear();
+  for ( const auto buffer : buffers ) {
+    datagram.append( buffer );
+  }
+  write_iovecs_[slot] = { datagram.data(), datagram.size() };
+
+  if ( not ring_->writev( fd_, span { &write_iovecs_[slot], 1 }, WRITE_TAG | slot ) ) {
+    free_write_slots_.push_back( slot );
+    ++dropped_;
+  }
+}
+
+void DatagramDevice::flush()
+{
+  if ( ring_ ) {
+    ring_->submit();
+    return;
+  }
+
+  while ( not backlog_.empty() and fd_.write( backlog_.front().get() ) > 0 ) {
+    backlog_.pop_front();
+  }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "buffer_pool.hh"
+#include "file_descriptor.hh"
+#include "io_uring.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! \brief Reads and writes datagrams on a packet device (e.g. a TunFD), in batches
+//! \details With Backend::IOUring, reads are kept in flight in (registered) buffers and writes are
+//! queued until flush(), so a burst of datagrams in either direction costs one system call. With
+//! Backend::Syscalls, the device is non-blocking and each datagram is its own read or write.
+//! Either way, up to MAX_WRITES datagrams wait for the device to take them; any more are dropped,
+//! as on a busy link. Datagrams are read directly into (and queued writes copied into) buffers from a
+//! BufferPool, and returned as Refs that share those buffers: once the Refs to a datagram are dropped, its
+//! buffer is read into again, so a steady stream of datagrams doesn't allocate buffers.
+class DatagramDevice
+{
+public:
+  enum class Backend : uint8_t
+  {
+    Syscalls, //!< [read(2)](\ref man2::read) and [writev(2)](\ref man2::writev) on the non-blocking device
+    IOUring   //!< [io_uring](\ref man7::io_uring) operations on the (blocking) device
+  };
+
+  static constexpr size_t READ_BUFFER_SIZE = 16384; //!< Longest datagram that can be read
+  static constexpr size_t MAX_WRITES = 256;         //!< Most datagrams waiting to be written
+
+  //! Backend::IOUring if the kernel allows it, else Backend::Syscalls
+  static Backend default_backend();
+
+  //! \param[in] fd is the device
+  //! \param[in] read_depth is the most datagrams read() returns at once (and with io_uring, the number of
+  //!            reads kept in flight); zero if the device will only be written
+  //! \param[in] backend is how to read and write the device
+  //! \note Every DatagramDevice on the same device must use the same backend (which sets its blocking mode).
+  explicit DatagramDevice( FileDescriptor&& fd, size_t read_depth = 32, Backend backend = default_backend() );
+
+  Backend backend() const { return ring_ ? Backend::IOUring : Backend::Syscalls; }
+
+  //! The fd that an EventLoop should watch (Direction::In) to call read(): the device itself, or
+  //! the io_uring completion eventfd (which also reports finished writes)
+  FileDescriptor& event_fd() { return ring_ ? ring_->completion_fd() : fd_; }
+
+  //! Append the datagrams received so far (at most `read_depth`) to `datagrams`
+  //! \note The Refs share buffers from this device's pool, so they must be dropped on the thread that
+  //! reads the device (Refs handed to another thread come back through a queue).
+  void read( std::vector<Ref<std::string>>& datagrams );
+
+  //! The pool that datagram buffers come from
+  const BufferPool& pool() const { return pool_; }
+
+  //! Write a datagram, or queue it to be written by flush() (with io_uring, or if the device is full)
+  void write( std::span<const std::string_view> buffers );
+  void write( const std::vector<Ref<std::string>>& buffers );
+
+  //! Submit the queued writes together (with io_uring), or retry the writes the device couldn't take
+  void flush();
+
+  //! Whether flush() should be called when the device becomes writable (Backend::Syscalls)
+  bool write_pending() const { return not backlog_.empty(); }
+
+  //! The device (an EventLoop can watch it for Direction::Out to call flush() when write_pending())
+  FileDescriptor& fd() { return fd_; }
+
+  //! Number of datagrams dropped because too many were waiting to be written
+  size_t dropped() const { return dropped_; }
+
+  //! Whether the device has reported end of file
+  bool eof() const { return eof_; }
+
+  //! \name
+  //! The kernel refers to this object's buffers during io_uring operations, so it cannot be moved or copied
+
+  //!@{
+  DatagramDevice( const DatagramDevice& other ) = delete;
+  DatagramDevice& operator=( const DatagramDevice& other ) = delete;
+  DatagramDevice( DatagramDevice&& other ) = delete;
+  DatagramDevice& operator=( DatagramDevice&& other ) = delete;
+  //!@}
+
+  //! Cancel the io_uring operations in flight, and wait for them to finish
+  ~DatagramDevice();
+
+private:
+  FileDescriptor fd_;
+  size_t read_depth_;
+  bool eof_ {};
+  size_t dropped_ {};
+  BufferPool pool_ { READ_BUFFER_SIZE };
+
+  // Backend::Syscalls
+  std::deque<Ref<std::string>> backlog_ {}; //!< Datagrams the device couldn't take yet
+
+  // Backend::IOUring
+  std::vector<PooledBuffer*> read_buffers_ {};  //!< One for each read in flight
+  std::vector<bool> reading_ {};                //!< Whether each read buffer has a read in flight
+  size_t registered_buffers_ {};                //!< The pool's buffers below this index are registered
+  std::vector<Ref<std::string>> received_ {};   //!< Datagrams from completed reads not yet returned by read()
+  std::vector<std::string> write_buffers_ {};   //!< Datagrams being written, by slot
+  std::vector<iovec> write_iovecs_ {};
+  std::vector<uint32_t> free_write_slots_ {};
+  std::vector<IOUring::Completion> completions_ {};
+  std::string event_count_ {}; //!< What was read from the completion eventfd
+  std::optional<IOUring> ring_ {}; //!< Destroyed before the buffers the kernel may still refer to
+
+  //! Queue the read for buffer `index`
+  void start_read( size_t index );
+
+  //! Handle the finished io_uring operations
+  void process_completions();
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+//! \brief Two copies of a T: readers use the current one without locks while a writer updates the other
+//! \details A form of read-copy-update (the "left-right" technique). A writer applies each update to the copy
+//! readers aren't using, makes it current, waits for the readers still using the old copy to finish, and then
+//! applies the same update to that one. So each update runs twice, and must leave both copies the same.
+template<typename T>
+class DoubleBuffered
+{
+  static constexpr size_t CACHE_LINE = 64;
+
+  struct alignas( CACHE_LINE ) ReaderCount
+  {
+    std::atomic<uint64_t> count {};
+  };
+
+  std::array<T, 2> copies_ {};
+  alignas( CACHE_LINE ) std::atomic<unsigned> current_ {};
+  std::array<ReaderCount, 2> readers_ {}; // the readers using each copy
+  std::mutex writer_mutex_ {};            // updates happen one at a time
+
+public:
+  //! Keeps the copy a reader is using from being updated until the ReadGuard is destroyed
+  class ReadGuard
+  {
+    const T* value_;
+    std::atomic<uint64_t>* readers_;
+
+  public:
+    ReadGuard( const T& value, std::atomic<uint64_t>& readers ) : value_( &value ), readers_( &readers ) {}
+    ReadGuard( ReadGuard&& other ) noexcept
+      : value_( other.value_ ), readers_( std::exchange( other.readers_, nullptr ) )
+    {}
+    ReadGuard( const ReadGuard& other ) = delete;
+    ReadGuard& operator=( const ReadGuard& other ) = delete;
+    ReadGuard& operator=( ReadGuard&& other ) = delete;
+
+    ~ReadGuard()
+    {
+      if ( readers_ ) {
+        readers_->fetch_sub( 1, std::memory_order_release );
+      }
+    }
+
+    const T& operator*() const { return *value_; }
+    const T* operator->() const { return value_; }
+  };
+
+  //! Start reading the current copy (never waits for a writer)
+  ReadGuard read()
+  {
+    while ( true ) {
+      const unsigned current = current_.load();
+      readers_[current].count.fetch_add( 1 );
+
+      // if a writer switched copies in between, it may not have seen this reader, so try again
+      if ( current_.load() == current ) {
+        return { copies_[current], readers_[current].count };
+      }
+      readers_[current].count.fetch_sub( 1, std::memory_order_release );
+    }
+  }
+
+  //! Apply `apply` (a function that takes a T&) to both copies, waiting for readers of each to finish
+  template<typename Update>
+  void update( Update&& apply )
+  {
+    const std::lock_guard lock { writer_mutex_ };
+    const unsigned old = current_.load( std::memory_order_relaxed );
+
+    apply( copies_[1 - old] );
+    current_.store( 1 - old );
+    while ( readers_[old].count.load() != 0 ) {
+      std::this_thread::yield();
+    }
+    apply( copies_[old] );
+  }
+};
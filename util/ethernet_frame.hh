@@ -3,6 +3,7 @@
 #include "ethernet_header.hh"
 #include "parser.hh"
 
+#include <string>
 #include <vector>
 
 struct EthernetFrame
@@ -10,15 +11,25 @@ struct EthernetFrame
   EthernetHeader header {};
   std::vector<Ref<std::string>> payload {};
 
-  void parse( Parser& parser )
+  // The header already serialized (a template the sender keeps for each neighbor), or null to serialize `header`.
+  // It belongs to the sender, so it is only valid while the frame is being transmitted (clone() leaves it out).
+  const std::string* serialized_header {};
+
+  template<class ParserT> // Parser or SpanParser
+  void parse( ParserT& parser )
   {
     header.parse( parser );
     parser.all_remaining( payload );
   }
 
-  void serialize( Serializer& serializer ) const
+  template<class SerializerT> // Serializer or HeaderSerializer
+  void serialize( SerializerT& serializer ) const
   {
-    header.serialize( serializer );
+    if ( serialized_header != nullptr ) {
+      serializer.buffer( Ref<std::string>::borrow( *serialized_header ) );
+    } else {
+      header.serialize( serializer );
+    }
     serializer.buffer( payload );
   }
 };
@@ -41,7 +41,8 @@ string EthernetHeader::to_string() const
   return ss.str();
 }
 
-void EthernetHeader::parse( Parser& parser )
+template<class ParserT>
+void EthernetHeader::parse( ParserT& parser )
 {
   // read destination address
   for ( auto& b : dst ) {
@@ -57,7 +58,11 @@ void EthernetHeader::parse( Parser& parser )
   parser.integer( type );
 }
 
-void EthernetHeader::serialize( Serializer& serializer ) const
+template void EthernetHeader::parse( Parser& );
+template void EthernetHeader::parse( SpanParser& );
+
+template<class SerializerT>
+void EthernetHeader::serialize( SerializerT& serializer ) const
 {
   // write destination address
   for ( const auto& b : dst ) {
@@ -72,3 +77,6 @@ void EthernetHeader::serialize( Serializer& serializer ) const
   // write frame type (e.g. IPv4, ARP, or something else)
   serializer.integer( type );
 }
+
+template void EthernetHeader::serialize( Serializer& ) const;
+template void EthernetHeader::serialize( HeaderSerializer& ) const;
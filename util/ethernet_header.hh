@@ -29,6 +29,8 @@ struct EthernetHeader
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
-  void parse( Parser& parser );
-  void serialize( Serializer& serializer ) const;
+  template<class ParserT> // Parser or SpanParser
+  void parse( ParserT& parser );
+  template<class SerializerT> // Serializer or HeaderSerializer
+  void serialize( SerializerT& serializer ) const;
 };
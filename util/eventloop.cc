@@ -1,12 +1,37 @@
 #include "eventloop.hh"
 #include "exception.hh"
 
+#include <chrono>
+#include <climits>
 #include <cstring>
 #include <iostream>
+#include <span>
 #include <sys/socket.h>
 
 using namespace std;
 
+namespace {
+// epoll events that make a rule in the given direction ready
+uint32_t direction_events( const EventLoop::Direction direction )
+{
+  return direction == EventLoop::Direction::In ? EPOLLIN : EPOLLOUT;
+}
+
+// epoll user data: the fd number, and the generation of its registration (to recognize stale events)
+uint64_t epoll_key( const int fd_num, const uint32_t generation )
+{
+  return ( static_cast<uint64_t>( generation ) << 32 ) | static_cast<uint32_t>( fd_num );
+}
+} // namespace
+
+EventLoop::EventLoop( const Backend backend ) : _backend( backend )
+{
+  _rule_categories.reserve( 64 );
+  if ( _backend == Backend::Epoll ) {
+    _epoll_fd.emplace( CheckSystemCall( "epoll_create1", ::epoll_create1( EPOLL_CLOEXEC ) ) );
+  }
+}
+
 unsigned int EventLoop::FDRule::service_count() const
 {
   return direction == Direction::In ? fd.read_count() : fd.write_count();
@@ -38,6 +63,12 @@ EventLoop::FDRule::FDRule( BasicRule&& base,
   , error( move( s_error ) )
 {}
 
+EventLoop::TimerRule::TimerRule( BasicRule&& base,
+                                 const chrono::steady_clock::time_point s_deadline,
+                                 const chrono::milliseconds s_period )
+  : BasicRule( move( base ) ), deadline( s_deadline ), period( s_period )
+{}
+
 EventLoop::RuleHandle EventLoop::add_rule( size_t category_id,
                                            FileDescriptor& fd,
                                            Direction direction,
@@ -50,10 +81,38 @@ EventLoop::RuleHandle EventLoop::add_rule( size_t category_id,
     throw out_of_range( "bad category_id" );
   }
 
-  _fd_rules.emplace_back( make_shared<FDRule>(
-    BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, error ) );
+  auto rule = make_shared<FDRule>(
+    BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, error );
+
+  if ( _backend == Backend::Poll ) {
+    _fd_rules.push_back( rule );
+    return RuleHandle { rule };
+  }
+
+  auto entry = _epoll_entries.find( fd.fd_num() );
+  if ( entry != _epoll_entries.end() and entry->second.rules.front()->fd.closed() ) {
+    // the fd number was closed and reused before the old rules were dropped: replace the stale registration
+    for ( const auto& old_rule : entry->second.rules ) {
+      if ( not old_rule->cancel_requested ) {
+        old_rule->cancel();
+      }
+    }
+    _epoll_entries.erase( entry );
+    entry = _epoll_entries.end();
+  }
+
+  if ( entry == _epoll_entries.end() ) {
+    // register the fd with no events yet (errors and hangups are always reported)
+    entry = _epoll_entries.emplace( fd.fd_num(), EpollEntry { ++_epoll_generation } ).first;
+    epoll_event event { 0, { .u64 = epoll_key( fd.fd_num(), entry->second.generation ) } };
+    if ( ::epoll_ctl( _epoll_fd->fd_num(), EPOLL_CTL_ADD, fd.fd_num(), &event ) < 0 ) {
+      _epoll_entries.erase( entry );
+      throw unix_error( "epoll_ctl" );
+    }
+  }
+  entry->second.rules.push_back( rule );
 
-  return RuleHandle { _fd_rules.back() };
+  return RuleHandle { rule };
 }
 
 EventLoop::RuleHandle EventLoop::add_rule( const size_t category_id,
@@ -69,6 +128,24 @@ EventLoop::RuleHandle EventLoop::add_rule( const size_t category_id,
   return RuleHandle { _non_fd_rules.back() };
 }
 
+EventLoop::RuleHandle EventLoop::add_timer_rule( const size_t category_id,
+                                                 const uint64_t delay_ms,
+                                                 const CallbackT& callback,
+                                                 const uint64_t period_ms,
+                                                 const InterestT& interest )
+{
+  if ( category_id >= _rule_categories.size() ) {
+    throw out_of_range( "bad category_id" );
+  }
+
+  auto rule = make_shared<TimerRule>( BasicRule { category_id, interest, callback },
+                                     chrono::steady_clock::now() + chrono::milliseconds( delay_ms ),
+                                     chrono::milliseconds( period_ms ) );
+  _timer_rules.push( rule );
+
+  return RuleHandle { rule };
+}
+
 void EventLoop::RuleHandle::cancel()
 {
   const shared_ptr<BasicRule> rule_shared_ptr = rule_weak_ptr_.lock();
@@ -77,42 +154,138 @@ void EventLoop::RuleHandle::cancel()
   }
 }
 
-// NOLINTBEGIN(*-cognitive-complexity)
-// NOLINTBEGIN(*-signed-bitwise)
-EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
+bool EventLoop::serve_non_fd_rules()
 {
-  // first, handle the non-file-descriptor-related rules
-  {
-    for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
-      auto& this_rule = **it;
-      bool rule_fired = false;
+  for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
+    auto& this_rule = **it;
+    bool rule_fired = false;
 
-      if ( this_rule.cancel_requested ) {
-        it = _non_fd_rules.erase( it );
-        continue;
+    if ( this_rule.cancel_requested ) {
+      it = _non_fd_rules.erase( it );
+      continue;
+    }
+
+    uint8_t iterations = 0;
+    while ( this_rule.interest() ) {
+      if ( iterations++ >= 128 ) {
+        throw runtime_error( "EventLoop: busy wait detected: rule \""
+                             + _rule_categories.at( this_rule.category_id ).name + "\" is still interested after "
+                             + to_string( iterations ) + " iterations" );
       }
 
-      uint8_t iterations = 0;
-      while ( this_rule.interest() ) {
-        if ( iterations++ >= 128 ) {
-          throw runtime_error( "EventLoop: busy wait detected: rule \""
-                               + _rule_categories.at( this_rule.category_id ).name + "\" is still interested after "
-                               + to_string( iterations ) + " iterations" );
-        }
+      rule_fired = true;
+      this_rule.callback();
+    }
 
-        rule_fired = true;
-        this_rule.callback();
-      }
+    if ( rule_fired ) {
+      return true; /* only serve one rule on each iteration */
+    }
 
-      if ( rule_fired ) {
-        return Result::Success; /* only serve one rule on each iteration */
-      }
+    ++it;
+  }
+  return false;
+}
+
+bool EventLoop::serve_timer_rules()
+{
+  const auto now = chrono::steady_clock::now();
+  if ( _timer_rules.empty() or _timer_rules.top()->deadline > now ) {
+    return false;
+  }
+
+  // take every due timer before running any, so a callback that adds a timer can't make this loop forever
+  vector<shared_ptr<TimerRule>> due;
+  while ( not _timer_rules.empty() and _timer_rules.top()->deadline <= now ) {
+    due.push_back( _timer_rules.top() );
+    _timer_rules.pop();
+  }
 
-      ++it;
+  bool rule_fired = false;
+  for ( const auto& rule : due ) {
+    auto& this_rule = *rule;
+    if ( this_rule.cancel_requested ) {
+      continue;
     }
+
+    if ( this_rule.interest() ) {
+      rule_fired = true;
+      this_rule.callback();
+    }
+
+    if ( this_rule.period.count() and not this_rule.cancel_requested ) {
+      this_rule.deadline += ( ( now - this_rule.deadline ) / this_rule.period + 1 ) * this_rule.period;
+      _timer_rules.push( rule );
+    }
+  }
+
+  return rule_fired;
+}
+
+int EventLoop::timer_timeout( const int timeout_ms )
+{
+  // drop cancelled timers from the top of the heap, so they don't cut the wait short
+  while ( not _timer_rules.empty() and _timer_rules.top()->cancel_requested ) {
+    _timer_rules.pop();
+  }
+
+  if ( _timer_rules.empty() ) {
+    return timeout_ms;
+  }
+
+  // round up, so the wait doesn't end just before the timer is due
+  const auto until_due
+    = chrono::ceil<chrono::milliseconds>( _timer_rules.top()->deadline - chrono::steady_clock::now() );
+  const int64_t until_due_ms = clamp<int64_t>( until_due.count(), 0, INT_MAX );
+  if ( timeout_ms >= 0 and timeout_ms <= until_due_ms ) {
+    return timeout_ms;
+  }
+  return static_cast<int>( until_due_ms );
+}
+
+void EventLoop::report_error( const FDRule& rule ) const
+{
+  /* see if fd is a socket */
+  int socket_error = 0;
+  socklen_t optlen = sizeof( socket_error );
+  const int ret = getsockopt( rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
+  if ( ret == -1 and errno == ENOTSOCK ) {
+    cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( rule.category_id ).name << "\"\n";
+  } else if ( ret == -1 ) {
+    throw unix_error( "getsockopt" );
+  } else if ( optlen != sizeof( socket_error ) ) {
+    throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
+  } else if ( socket_error ) {
+    cerr << "error on polled socket for rule \"" << _rule_categories.at( rule.category_id ).name
+         << "\": " << strerror( socket_error ) << "\n";
+  }
+}
+
+EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
+{
+  // first, handle the non-file-descriptor-related rules
+  if ( serve_non_fd_rules() ) {
+    return Result::Success;
   }
 
-  // now the file-descriptor-related rules. poll any "interested" file descriptors
+  // then any timers that are already due
+  if ( serve_timer_rules() ) {
+    return Result::Success;
+  }
+
+  // wait for the fds, but no longer than until the next timer is due
+  const int wait_ms = timer_timeout( timeout_ms );
+  const Result result = _backend == Backend::Epoll ? wait_epoll( wait_ms ) : wait_poll( wait_ms );
+  if ( result == Result::Timeout and serve_timer_rules() ) {
+    return Result::Success;
+  }
+  return result;
+}
+
+// NOLINTBEGIN(*-cognitive-complexity)
+// NOLINTBEGIN(*-signed-bitwise)
+EventLoop::Result EventLoop::wait_poll( const int timeout_ms )
+{
+  // poll any "interested" file descriptors
   vector<pollfd> pollfds {};
   pollfds.reserve( _fd_rules.size() );
   bool something_to_poll = false;
@@ -153,13 +326,17 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
     ++it;
   }
 
-  // quit if there is nothing left to poll
-  if ( not something_to_poll ) {
+  // quit if there is nothing left to poll (or to wait for)
+  if ( not something_to_poll and _timer_rules.empty() ) {
     return Result::Exit;
   }
 
   // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
-  if ( 0 == CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), timeout_ms ) ) ) {
+  const int ready_count = ::poll( pollfds.data(), pollfds.size(), timeout_ms );
+  if ( ready_count < 0 and errno == EINTR ) {
+    return Result::Timeout; // interrupted, e.g. to run io_uring completions
+  }
+  if ( 0 == CheckSystemCall( "poll", ready_count ) ) {
     return Result::Timeout;
   }
 
@@ -170,22 +347,7 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 
     const auto poll_error = static_cast<bool>( this_pollfd.revents & ( POLLERR | POLLNVAL ) );
     if ( poll_error ) {
-      /* see if fd is a socket */
-      int socket_error = 0;
-      socklen_t optlen = sizeof( socket_error );
-      const int ret = getsockopt( this_rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
-      if ( ret == -1 and errno == ENOTSOCK ) {
-        cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\"\n";
-      } else if ( ret == -1 ) {
-        throw unix_error( "getsockopt" );
-      } else if ( optlen != sizeof( socket_error ) ) {
-        throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
-      } else if ( socket_error ) {
-        cerr << "error on polled socket for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\": " << strerror( socket_error ) << "\n";
-      }
-
+      report_error( this_rule );
       this_rule.error();
       this_rule.cancel();
       it = _fd_rules.erase( it );
@@ -223,5 +385,117 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 
   return Result::Success;
 }
+
+EventLoop::Result EventLoop::wait_epoll( const int timeout_ms )
+{
+  // Drop cancelled and defunct rules, and update each fd's registration if its rules' interest changed.
+  bool something_to_poll = false;
+  for ( auto entry = _epoll_entries.begin(); entry != _epoll_entries.end(); ) {
+    auto& [fd_num, registration] = *entry;
+    uint32_t wanted = 0;
+
+    erase_if( registration.rules, [&]( const shared_ptr<FDRule>& rule ) {
+      auto& this_rule = *rule;
+      if ( this_rule.cancel_requested ) {
+        // if rule is cancelled externally (or after a hangup or error below), don't call the cancellation callback
+        return true;
+      }
+
+      if ( ( this_rule.direction == Direction::In && this_rule.fd.eof() ) or this_rule.fd.closed() ) {
+        this_rule.cancel();
+        return true;
+      }
+
+      this_rule.polled = this_rule.interest();
+      if ( this_rule.polled ) {
+        wanted |= direction_events( this_rule.direction );
+      }
+      return false;
+    } );
+
+    if ( registration.rules.empty() ) {
+      // a closed fd has already left the epoll set (unless another descriptor refers to the same file)
+      if ( ::epoll_ctl( _epoll_fd->fd_num(), EPOLL_CTL_DEL, fd_num, nullptr ) < 0 and errno != EBADF
+           and errno != ENOENT ) {
+        throw unix_error( "epoll_ctl" );
+      }
+      entry = _epoll_entries.erase( entry );
+      continue;
+    }
+
+    if ( wanted != registration.events ) {
+      epoll_event event { wanted, { .u64 = epoll_key( fd_num, registration.generation ) } };
+      CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll_fd->fd_num(), EPOLL_CTL_MOD, fd_num, &event ) );
+      registration.events = wanted;
+    }
+
+    something_to_poll |= wanted != 0;
+    ++entry;
+  }
+
+  // quit if there is nothing left to poll (or to wait for)
+  if ( not something_to_poll and _timer_rules.empty() ) {
+    return Result::Exit;
+  }
+
+  _epoll_events.resize( max( size_t { 16 }, min( _epoll_entries.size(), size_t { 1024 } ) ) );
+  const int max_events = static_cast<int>( _epoll_events.size() );
+  const int ready_count = ::epoll_wait( _epoll_fd->fd_num(), _epoll_events.data(), max_events, timeout_ms );
+  if ( ready_count < 0 and errno == EINTR ) {
+    return Result::Timeout; // interrupted, e.g. to run io_uring completions
+  }
+  if ( 0 == CheckSystemCall( "epoll_wait", ready_count ) ) {
+    return Result::Timeout;
+  }
+
+  // Serve every ready rule. Callbacks can cancel or add rules, so each rule is checked again just before it runs.
+  for ( const auto& event : span { _epoll_events.data(), static_cast<size_t>( ready_count ) } ) {
+    const auto entry = _epoll_entries.find( static_cast<int>( event.data.u64 & UINT32_MAX ) );
+    if ( entry == _epoll_entries.end() or entry->second.generation != event.data.u64 >> 32 ) {
+      continue; // an event for an fd whose registration has since been removed
+    }
+
+    const auto rules = entry->second.rules;
+    for ( const auto& rule : rules ) {
+      auto& this_rule = *rule;
+      if ( this_rule.cancel_requested or this_rule.fd.closed() ) {
+        continue;
+      }
+
+      if ( event.events & EPOLLERR ) {
+        report_error( this_rule );
+        this_rule.error();
+        this_rule.cancel();
+        this_rule.cancel_requested = true; // erase on the next wait
+        continue;
+      }
+
+      const bool ready = this_rule.polled and ( event.events & direction_events( this_rule.direction ) );
+      const bool hup = event.events & EPOLLHUP;
+      if ( hup and ( ( this_rule.polled and not ready ) or this_rule.direction == Direction::Out ) ) {
+        // same as Backend::Poll: a hangup with nothing left to read (or on a writer) leaves the fd defunct
+        this_rule.cancel();
+        this_rule.cancel_requested = true;
+        continue;
+      }
+
+      // an earlier callback in this batch may have changed the rule's interest
+      if ( not ready or not this_rule.interest() ) {
+        continue;
+      }
+
+      const auto count_before = this_rule.service_count();
+      this_rule.callback();
+
+      if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.interest() ) {
+        throw runtime_error( "EventLoop: busy wait detected: rule \""
+                             + _rule_categories.at( this_rule.category_id ).name
+                             + "\" did not read/write fd and is still interested" );
+      }
+    }
+  }
+
+  return Result::Success;
+}
 // NOLINTEND(*-signed-bitwise)
 // NOLINTEND(*-cognitive-complexity)
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <memory>
+#include <optional>
 #include <poll.h>
+#include <queue>
+#include <sys/epoll.h>
+#include <unordered_map>
 
 #include "file_descriptor.hh"
 
@@ -18,6 +24,15 @@ public:
     Out // Callback will be triggered when Rule::fd is writable.
   };
 
+  //! The system call used to wait for file descriptors.
+  enum class Backend : uint8_t
+  {
+    Poll, //!< [poll(2)](\ref man2::poll): the rules are rebuilt into a pollfd array on each wait,
+          //!< and one ready rule is served per wait.
+    Epoll //!< [epoll(7)](\ref man7::epoll): registrations persist between waits (updated only when
+          //!< a rule's interest changes), and every ready rule is served per wait.
+  };
+
 private:
   using CallbackT = std::function<void( void )>;
   using InterestT = std::function<bool( void )>;
@@ -43,6 +58,7 @@ private:
     Direction direction; //!< Direction::In for reading from fd, Direction::Out for writing to fd.
     CallbackT cancel;    //!< A callback that is called when the rule is cancelled (e.g. on EOF or hangup)
     CallbackT error;     //!< A callback that is called when the fd has an error before cancellation
+    bool polled {};      //!< Whether the rule was interested when the current wait began (Backend::Epoll)
 
     FDRule( BasicRule&& base, FileDescriptor&& s_fd, Direction s_direction, CallbackT s_cancel, CallbackT s_error );
 
@@ -51,20 +67,68 @@ private:
     unsigned int service_count() const;
   };
 
+  struct TimerRule : public BasicRule
+  {
+    std::chrono::steady_clock::time_point deadline; //!< When the callback is next due
+    std::chrono::milliseconds period;               //!< Time between calls, or zero for a one-shot timer
+
+    TimerRule( BasicRule&& base,
+               std::chrono::steady_clock::time_point s_deadline,
+               std::chrono::milliseconds s_period );
+  };
+
+  //! Orders the timer heap so that the earliest deadline is on top
+  struct LaterDeadline
+  {
+    bool operator()( const std::shared_ptr<TimerRule>& a, const std::shared_ptr<TimerRule>& b ) const
+    {
+      return a->deadline > b->deadline;
+    }
+  };
+
+  //! An fd registered with epoll, shared by all of the rules on that fd
+  struct EpollEntry
+  {
+    uint32_t generation;                        //!< Distinguishes this registration from earlier ones on the fd
+    uint32_t events {};                         //!< Events currently registered with the kernel
+    std::vector<std::shared_ptr<FDRule>> rules {};
+  };
+
   std::vector<RuleCategory> _rule_categories {};
-  std::list<std::shared_ptr<FDRule>> _fd_rules {};
+  std::list<std::shared_ptr<FDRule>> _fd_rules {}; //!< Rules on fds (Backend::Poll)
   std::list<std::shared_ptr<BasicRule>> _non_fd_rules {};
+  std::priority_queue<std::shared_ptr<TimerRule>, std::vector<std::shared_ptr<TimerRule>>, LaterDeadline>
+    _timer_rules {}; //!< Min-heap by deadline (cancelled timers are dropped when they reach the top)
+
+  Backend _backend;
+  std::optional<FileDescriptor> _epoll_fd {};
+  std::unordered_map<int, EpollEntry> _epoll_entries {}; //!< Rules on fds, by fd number (Backend::Epoll)
+  uint32_t _epoll_generation {};
+  std::vector<epoll_event> _epoll_events {};
+
+  //! Runs the interested non-fd rules; returns true if any ran.
+  bool serve_non_fd_rules();
+
+  //! Runs the interested timer rules that are due; returns true if any ran.
+  bool serve_timer_rules();
+
+  //! Shortens `timeout_ms` so the wait ends when the earliest timer is due.
+  int timer_timeout( int timeout_ms );
+
+  //! Reports an error on a rule's fd
+  void report_error( const FDRule& rule ) const;
 
 public:
-  EventLoop() { _rule_categories.reserve( 64 ); }
+  EventLoop() : EventLoop( Backend::Poll ) {}
+  explicit EventLoop( Backend backend );
 
   //! Returned by each call to EventLoop::wait_next_event.
   enum class Result : uint8_t
   {
     Success, //!< At least one Rule was triggered.
-    Timeout, //!< No rules were triggered before timeout.
-    Exit     //!< All rules have been canceled or were uninterested; make no further calls to
-             //!< EventLoop::wait_next_event.
+    Timeout, //!< No rules were triggered before timeout (or the wait was interrupted by a signal).
+    Exit     //!< All rules have been canceled or were uninterested (and no timers are pending);
+             //!< make no further calls to EventLoop::wait_next_event.
   };
 
   size_t add_category( const std::string& name );
@@ -93,15 +157,32 @@ public:
   RuleHandle
   add_rule( size_t category_id, const CallbackT& callback, const InterestT& interest = [] { return true; } );
 
-  //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+  //! Calls `callback` once, `delay_ms` from now, and then (if `period_ms` is nonzero) every `period_ms`
+  //! \details wait_next_event sleeps no longer than until the earliest timer is due. Periods that
+  //! pass without a wait (e.g. while a callback runs) are skipped, not made up.
+  RuleHandle add_timer_rule( size_t category_id,
+                             uint64_t delay_ms,
+                             const CallbackT& callback,
+                             uint64_t period_ms = 0,
+                             const InterestT& interest = [] { return true; } );
+
+  //! Calls [poll(2)](\ref man2::poll) or [epoll_wait(2)](\ref man2::epoll_wait) and then executes
+  //! callback for each ready fd (one per call with Backend::Poll), or runs the timers that are due.
+  //! \param[in] timeout_ms is the longest to wait (negative to wait until a rule or timer is ready)
   Result wait_next_event( int timeout_ms );
 
+  Backend backend() const { return _backend; }
+
   // convenience function to add category and rule at the same time
   template<typename... Targs>
   auto add_rule( const std::string& name, Targs&&... Fargs )
   {
     return add_rule( add_category( name ), std::forward<Targs>( Fargs )... );
   }
+
+private:
+  Result wait_poll( int timeout_ms );
+  Result wait_epoll( int timeout_ms );
 };
 
 using Direction = EventLoop::Direction;
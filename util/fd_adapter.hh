@@ -1,17 +1,53 @@
 #pragma once
 
 #include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+template<class T>
+concept TCPDatagramAdapter = requires( T a, TCPMessage seg ) {
+  { a.write( seg ) } -> std::same_as<void>;
+
+  { a.read() } -> std::same_as<std::optional<TCPMessage>>;
+};
+
+//! An adapter that can also read every datagram that is waiting, and write several, at once
+template<class T>
+concept TCPBatchDatagramAdapter
+  = TCPDatagramAdapter<T> and requires( T a, std::vector<TCPMessage>& segs, std::span<const TCPMessage> out ) {
+      { a.read( segs ) } -> std::same_as<size_t>;
+
+      { a.write( out ) } -> std::same_as<void>;
+    };
 
 //! \brief Basic functionality for file descriptor adaptors
 //! \details See TCPOverIPv4OverTunFdAdapter for more information.
 class FdAdapterBase
 {
+public:
+  //! How many datagrams each batched read found waiting
+  struct ReadStats
+  {
+    uint64_t wakeups {};   //!< Batched reads
+    uint64_t datagrams {}; //!< Datagrams they read (whether or not they belonged to the connection)
+
+    double datagrams_per_wakeup() const { return wakeups ? static_cast<double>( datagrams ) / wakeups : 0; }
+  };
+
 private:
   FdAdapterConfig _cfg {}; //!< Configuration values
   bool _listen = false;    //!< Is the connected TCP FSM in listen state?
+  ReadStats _read_stats {};
 
 protected:
   FdAdapterConfig& config_mutable() { return _cfg; }
+  ReadStats& read_stats_mutable() { return _read_stats; }
 
 public:
   //! \brief Set the listening flag
@@ -30,6 +66,9 @@ public:
   //! \returns a mutable reference
   FdAdapterConfig& config_mut() { return _cfg; }
 
+  //! Datagrams per batched read, so far
+  const ReadStats& read_stats() const { return _read_stats; }
+
   //! Called periodically when time elapses
   void tick( const size_t unused [[maybe_unused]] ) {}
 };
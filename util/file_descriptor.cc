@@ -2,6 +2,7 @@
 
 #include "exception.hh"
 
+#include <array>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
@@ -149,9 +150,35 @@ void FileDescriptor::read( vector<string>& buffers )
   }
 }
 
+Ref<string> FileDescriptor::read( BufferPool& pool )
+{
+  PooledBuffer& buffer = pool.take();
+  string& storage = buffer.storage();
+
+  const ssize_t bytes_read = ::read( fd_num(), storage.data(), storage.size() );
+  if ( bytes_read < 0 ) {
+    const int error = errno;
+    pool.give_back( buffer );
+    if ( internal_fd_->non_blocking_ and ( error == EAGAIN or error == EINPROGRESS ) ) {
+      return {};
+    }
+    throw unix_error { "read", error };
+  }
+
+  register_read();
+
+  if ( bytes_read == 0 ) {
+    internal_fd_->eof_ = true;
+    pool.give_back( buffer );
+    return {};
+  }
+
+  return { buffer, static_cast<size_t>( bytes_read ) };
+}
+
 size_t FileDescriptor::write( string_view buffer )
 {
-  return write( vector<string_view> { buffer } );
+  return write( span { &buffer, 1 } );
 }
 
 size_t FileDescriptor::write( const vector<Ref<string>>& buffers )
@@ -164,21 +191,29 @@ size_t FileDescriptor::write( const vector<Ref<string>>& buffers )
   return write( views );
 }
 
-size_t FileDescriptor::write( const vector<string_view>& buffers )
+size_t FileDescriptor::write( span<const string_view> buffers )
 {
-  vector<iovec> iovecs;
-  iovecs.reserve( buffers.size() );
+  // the iovecs for a few buffers (e.g. headers and a payload) go on the stack
+  array<iovec, 8> few_iovecs {};
+  vector<iovec> many_iovecs;
+  if ( buffers.size() > few_iovecs.size() ) {
+    many_iovecs.resize( buffers.size() );
+  }
+  const span<iovec> iovecs
+    = many_iovecs.empty() ? span { few_iovecs }.first( buffers.size() ) : span { many_iovecs };
+
   size_t total_size = 0;
-  for ( const auto x : buffers ) {
-    iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } ); // NOLINT(*-const-cast)
-    total_size += x.size();
+  for ( size_t i = 0; i < buffers.size(); i++ ) {
+    iovecs[i] = { const_cast<char*>( buffers[i].data() ), buffers[i].size() }; // NOLINT(*-const-cast)
+    total_size += buffers[i].size();
   }
 
   const ssize_t bytes_written
     = CheckSystemCall( "writev", ::writev( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) ) );
   register_write();
 
-  if ( bytes_written == 0 and total_size != 0 ) {
+  // a non-blocking fd that would block writes nothing (CheckSystemCall returns 0 for EAGAIN)
+  if ( bytes_written == 0 and total_size != 0 and not internal_fd_->non_blocking_ ) {
     throw runtime_error( "write returned 0 given non-empty input buffer" );
   }
 
@@ -3,6 +3,8 @@
 #include "ref.hh"
 #include <cstddef>
 #include <memory>
+#include <span>
+#include <string_view>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -65,10 +67,14 @@ public:
   void read( std::string& buffer );
   void read( std::vector<std::string>& buffers );
 
+  // Read into a buffer from `pool`, returning (a shared Ref to) the bytes read; the Ref is empty if nothing
+  // was read (at EOF, or if the fd is non-blocking and would block)
+  Ref<std::string> read( BufferPool& pool );
+
   // Attempt to write a buffer
-  // returns number of bytes written
+  // returns number of bytes written (zero if the fd is non-blocking and would block)
   size_t write( std::string_view buffer );
-  size_t write( const std::vector<std::string_view>& buffers );
+  size_t write( std::span<const std::string_view> buffers );
   size_t write( const std::vector<Ref<std::string>>& buffers );
 
   // Close the underlying file descriptor
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+//! Default hash for FlatHashMap: mixes every bit of an integer key into every bit of the hash (std::hash of an
+//! integer is the integer itself, whose low bits alone would choose where to look)
+template<typename Key>
+struct FlatHash
+{
+  static_assert( std::is_integral_v<Key>, "FlatHash needs an integer key (give FlatHashMap a hash for others)" );
+
+  size_t operator()( const Key key ) const
+  {
+    uint64_t h = static_cast<uint64_t>( key ) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    h ^= h >> 32;
+    return h;
+  }
+};
+
+//! \brief A hash map that keeps its entries in flat arrays (open addressing), for small keys such as IPv4
+//! addresses or TCP 4-tuples that are looked up far more often than they are added or removed
+//! \details Slots are arranged in groups of 16, and each slot has a control byte: empty, deleted, or (if full)
+//! 7 bits of its key's hash. A lookup compares the control bytes of a whole group with one SIMD instruction, and
+//! only compares keys in the slots whose 7 bits match, so it usually touches one group of control bytes and one
+//! key. Keys and values are kept in separate arrays, so probing doesn't pull values into the cache.
+//! Keys must be default-constructible and cheap to copy. Values are constructed only in full slots. Adding an
+//! entry may move the others, so a pointer to a value is valid only until the next try_emplace().
+template<typename Key, typename Value, typename Hash = FlatHash<Key>>
+class FlatHashMap
+{
+  static constexpr size_t GROUP_SIZE = 16;
+
+  static constexpr int8_t EMPTY = -128;  // never used (so a lookup can stop here)
+  static constexpr int8_t DELETED = -2;  // used and then erased (a lookup must look past it)
+  static constexpr uint64_t H2_MASK = 0x7f; // the part of a hash kept in a full slot's control byte
+
+  struct alignas( GROUP_SIZE ) Group
+  {
+    std::array<int8_t, GROUP_SIZE> control {};
+
+    Group() { control.fill( EMPTY ); }
+
+    //! Bitmask of the slots whose control byte is `value`
+    uint32_t match( const int8_t value ) const
+    {
+#if defined( __SSE2__ )
+      const __m128i bytes = _mm_load_si128( reinterpret_cast<const __m128i*>( control.data() ) ); // NOLINT
+      return static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, _mm_set1_epi8( value ) ) ) );
+#else
+      uint32_t mask = 0;
+      for ( size_t i = 0; i < GROUP_SIZE; i++ ) {
+        mask |= static_cast<uint32_t>( control[i] == value ) << i;
+      }
+      return mask;
+#endif
+    }
+
+    //! Bitmask of the slots that are empty or deleted (the only control bytes with the sign bit set)
+    uint32_t match_free() const
+    {
+#if defined( __SSE2__ )
+      const __m128i bytes = _mm_load_si128( reinterpret_cast<const __m128i*>( control.data() ) ); // NOLINT
+      return static_cast<uint32_t>( _mm_movemask_epi8( bytes ) );
+#else
+      uint32_t mask = 0;
+      for ( size_t i = 0; i < GROUP_SIZE; i++ ) {
+        mask |= static_cast<uint32_t>( control[i] < 0 ) << i;
+      }
+      return mask;
+#endif
+    }
+  };
+
+  struct ValueSlot
+  {
+    alignas( Value ) std::byte bytes[sizeof( Value )]; // NOLINT(*-c-arrays)
+  };
+
+  std::vector<Group> groups_ {};
+  std::vector<Key> keys_ {};
+  std::unique_ptr<ValueSlot[]> values_ {}; // NOLINT(*-c-arrays)
+  size_t size_ {};
+  size_t deleted_ {};
+  [[no_unique_address]] Hash hash_ {};
+
+  size_t capacity() const { return keys_.size(); }
+  int8_t& control( const size_t slot ) { return groups_[slot / GROUP_SIZE].control[slot % GROUP_SIZE]; }
+  Value& value( const size_t slot ) { return *std::launder( reinterpret_cast<Value*>( values_[slot].bytes ) ); }
+  const Value& value( const size_t slot ) const
+  {
+    return *std::launder( reinterpret_cast<const Value*>( values_[slot].bytes ) );
+  }
+
+  //! Visit the groups where `hash` could be, in order (stopping when `visit` returns true). Each group is
+  //! visited once, since the steps grow by one and the number of groups is a power of two.
+  template<typename Visit>
+  void probe( const uint64_t hash, Visit&& visit ) const
+  {
+    const size_t mask = groups_.size() - 1;
+    size_t group = ( hash >> 7 ) & mask;
+    for ( size_t step = 1; not visit( group ); step++ ) {
+      group = ( group + step ) & mask;
+    }
+  }
+
+  //! The slot holding `key`, or capacity() if none
+  size_t find_slot( const Key& key, const uint64_t hash ) const
+  {
+    size_t found = capacity();
+    if ( size_ == 0 ) {
+      return found;
+    }
+    const auto h2 = static_cast<int8_t>( hash & H2_MASK );
+    probe( hash, [&]( const size_t group ) {
+      for ( uint32_t matches = groups_[group].match( h2 ); matches != 0; matches &= matches - 1 ) {
+        const size_t slot = group * GROUP_SIZE + std::countr_zero( matches );
+        if ( keys_[slot] == key ) {
+          found = slot;
+          return true;
+        }
+      }
+      return groups_[group].match( EMPTY ) != 0;
+    } );
+    return found;
+  }
+
+  //! The first free slot where `hash` could go
+  size_t free_slot( const uint64_t hash ) const
+  {
+    size_t slot {};
+    probe( hash, [&]( const size_t group ) {
+      const uint32_t free = groups_[group].match_free();
+      slot = group * GROUP_SIZE + std::countr_zero( free );
+      return free != 0;
+    } );
+    return slot;
+  }
+
+  //! Move every entry into a table of `group_count` groups (which also clears away the deleted slots)
+  void rehash( const size_t group_count )
+  {
+    FlatHashMap old { std::move( *this ) };
+    groups_.resize( group_count );
+    keys_.resize( group_count * GROUP_SIZE );
+    values_ = std::make_unique<ValueSlot[]>( keys_.size() ); // NOLINT(*-c-arrays)
+
+    for ( size_t slot = 0; slot < old.capacity(); slot++ ) {
+      if ( old.control( slot ) >= 0 ) {
+        const uint64_t hash = hash_( old.keys_[slot] );
+        const size_t to = free_slot( hash );
+        control( to ) = static_cast<int8_t>( hash & H2_MASK );
+        keys_[to] = old.keys_[slot];
+        new ( values_[to].bytes ) Value( std::move( old.value( slot ) ) );
+        size_++;
+      }
+    }
+  }
+
+  //! Make room for one more entry: at most 7/8 of the slots may be full or deleted
+  void reserve_one()
+  {
+    if ( ( size_ + deleted_ + 1 ) * 8 <= capacity() * 7 ) {
+      return;
+    }
+    // if the table is at most half full (counting only full slots), clearing the deleted ones makes room
+    const bool grow = ( size_ + 1 ) * 2 > capacity();
+    rehash( groups_.empty() ? 1 : groups_.size() * ( grow ? 2 : 1 ) );
+  }
+
+public:
+  FlatHashMap() = default;
+  explicit FlatHashMap( Hash hash ) : hash_( std::move( hash ) ) {}
+
+  FlatHashMap( const FlatHashMap& other )
+    : groups_( other.groups_ )
+    , keys_( other.keys_ )
+    , values_( std::make_unique<ValueSlot[]>( other.capacity() ) ) // NOLINT(*-c-arrays)
+    , size_( other.size_ )
+    , deleted_( other.deleted_ )
+    , hash_( other.hash_ )
+  {
+    for ( size_t slot = 0; slot < capacity(); slot++ ) {
+      if ( control( slot ) >= 0 ) {
+        new ( values_[slot].bytes ) Value( other.value( slot ) );
+      }
+    }
+  }
+
+  FlatHashMap( FlatHashMap&& other ) noexcept
+    : groups_( std::move( other.groups_ ) )
+    , keys_( std::move( other.keys_ ) )
+    , values_( std::move( other.values_ ) )
+    , size_( std::exchange( other.size_, 0 ) )
+    , deleted_( std::exchange( other.deleted_, 0 ) )
+    , hash_( other.hash_ )
+  {
+    other.groups_.clear();
+    other.keys_.clear();
+  }
+
+  FlatHashMap& operator=( const FlatHashMap& other )
+  {
+    if ( this != &other ) {
+      *this = FlatHashMap { other };
+    }
+    return *this;
+  }
+
+  FlatHashMap& operator=( FlatHashMap&& other ) noexcept
+  {
+    if ( this != &other ) {
+      clear();
+      groups_ = std::move( other.groups_ );
+      keys_ = std::move( other.keys_ );
+      values_ = std::move( other.values_ );
+      size_ = std::exchange( other.size_, 0 );
+      deleted_ = std::exchange( other.deleted_, 0 );
+      hash_ = other.hash_;
+      other.groups_.clear();
+      other.keys_.clear();
+    }
+    return *this;
+  }
+
+  ~FlatHashMap() { clear(); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  //! The value for `key`, or nullptr if there is none
+  Value* find( const Key& key )
+  {
+    const size_t slot = find_slot( key, hash_( key ) );
+    return slot == capacity() ? nullptr : &value( slot );
+  }
+
+  const Value* find( const Key& key ) const
+  {
+    const size_t slot = find_slot( key, hash_( key ) );
+    return slot == capacity() ? nullptr : &value( slot );
+  }
+
+  bool contains( const Key& key ) const { return find( key ) != nullptr; }
+
+  //! Add `key` with a value constructed from `args`, unless it is already there
+  //! \returns the key's value, and whether it was added
+  template<typename... Args>
+  std::pair<Value*, bool> try_emplace( const Key& key, Args&&... args )
+  {
+    const uint64_t hash = hash_( key );
+    if ( const size_t slot = find_slot( key, hash ); slot != capacity() ) {
+      return { &value( slot ), false };
+    }
+
+    reserve_one();
+    const size_t slot = free_slot( hash );
+    if ( control( slot ) == DELETED ) {
+      deleted_--;
+    }
+    control( slot ) = static_cast<int8_t>( hash & H2_MASK );
+    keys_[slot] = key;
+    Value* const added = new ( values_[slot].bytes ) Value( std::forward<Args>( args )... );
+    size_++;
+    return { added, true };
+  }
+
+  Value& operator[]( const Key& key ) { return *try_emplace( key ).first; }
+
+  //! Remove `key` (and its value)
+  //! \returns false if it wasn't there
+  bool erase( const Key& key )
+  {
+    const size_t slot = find_slot( key, hash_( key ) );
+    if ( slot == capacity() ) {
+      return false;
+    }
+    value( slot ).~Value();
+    size_--;
+
+    // A lookup stops at a group with an empty slot, so a slot can become empty again only if its group already
+    // has one (and so has never been full, and no lookup has had to look past it)
+    if ( groups_[slot / GROUP_SIZE].match( EMPTY ) != 0 ) {
+      control( slot ) = EMPTY;
+    } else {
+      control( slot ) = DELETED;
+      deleted_++;
+    }
+    return true;
+  }
+
+  //! Remove every entry (keeping the memory)
+  void clear()
+  {
+    for ( size_t slot = 0; slot < capacity(); slot++ ) {
+      if ( control( slot ) >= 0 ) {
+        value( slot ).~Value();
+      }
+    }
+    for ( auto& group : groups_ ) {
+      group = Group {};
+    }
+    size_ = deleted_ = 0;
+  }
+
+  //! Call `visit( key, value )` for every entry (in no particular order)
+  template<typename Visit>
+  void for_each( Visit&& visit )
+  {
+    for ( size_t slot = 0; slot < capacity(); slot++ ) {
+      if ( control( slot ) >= 0 ) {
+        visit( std::as_const( keys_[slot] ), value( slot ) );
+      }
+    }
+  }
+};
@@ -55,12 +55,12 @@ std::string summary( const EthernetFrame& frame );
 // Explicitly copy ("clone") a frame or datagram
 inline EthernetFrame clone( const EthernetFrame& x )
 {
-  auto duplicate_payload = x.payload | std::views::transform( []( auto& i ) { return i.get(); } );
+  auto duplicate_payload = x.payload | std::views::transform( []( auto& i ) { return std::string { i.get() }; } );
   return { x.header, { duplicate_payload.begin(), duplicate_payload.end() } };
 }
 
 inline InternetDatagram clone( const InternetDatagram& x )
 {
-  auto duplicate_payload = x.payload | std::views::transform( []( auto& i ) { return i.get(); } );
+  auto duplicate_payload = x.payload | std::views::transform( []( auto& i ) { return std::string { i.get() }; } );
   return { x.header, { duplicate_payload.begin(), duplicate_payload.end() } };
 }
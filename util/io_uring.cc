@@ -0,0 +1,225 @@
+#include "io_uring.hh"
+
+#include "exception.hh"
+
+#include <atomic>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+// offset for reads and writes that don't seek (as with read(2) and write(2))
+constexpr uint64_t CURRENT_POSITION = UINT64_MAX;
+
+int io_uring_setup( const unsigned entries, io_uring_params& params )
+{
+  return static_cast<int>( ::syscall( __NR_io_uring_setup, entries, &params ) ); // NOLINT(*-vararg)
+}
+
+int io_uring_enter( const int ring_fd, const unsigned to_submit, const unsigned min_complete, const unsigned flags )
+{
+  // NOLINTNEXTLINE(*-vararg)
+  return static_cast<int>( ::syscall( __NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0 ) );
+}
+
+int io_uring_register( const int ring_fd, const unsigned opcode, const void* arg, const unsigned nr_args )
+{
+  return static_cast<int>( ::syscall( __NR_io_uring_register, ring_fd, opcode, arg, nr_args ) ); // NOLINT(*-vararg)
+}
+
+// the ring's head and tail indices are shared with the kernel
+unsigned load_acquire( unsigned* const index )
+{
+  return atomic_ref { *index }.load( memory_order_acquire );
+}
+
+void store_release( unsigned* const index, const unsigned value )
+{
+  atomic_ref { *index }.store( value, memory_order_release );
+}
+} // namespace
+
+bool IOUring::supported()
+{
+  static const bool is_supported = [] {
+    io_uring_params params {};
+    const int fd = io_uring_setup( 1, params );
+    if ( fd < 0 ) {
+      return false;
+    }
+    ::close( fd );
+    return true;
+  }();
+  return is_supported;
+}
+
+IOUring::Mapping::Mapping( const FileDescriptor& ring_fd, const size_t length, const uint64_t offset )
+  : addr_( ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd.fd_num(), offset ) )
+  , length_( length )
+{
+  if ( addr_ == MAP_FAILED ) { // NOLINT(*-cstyle-cast, *-int-to-ptr)
+    throw unix_error( "mmap" );
+  }
+}
+
+IOUring::Mapping::~Mapping()
+{
+  ::munmap( addr_, length_ );
+}
+
+//! \param[in] entries is the minimum size of the submission ring (the kernel rounds it up to a power of two)
+IOUring::IOUring( const unsigned entries )
+  : params_()
+  , ring_fd_( CheckSystemCall( "io_uring_setup", io_uring_setup( entries, params_ ) ) )
+  , eventfd_( CheckSystemCall( "eventfd", ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK ) ) )
+  , sq_ring_( ring_fd_, params_.sq_off.array + params_.sq_entries * sizeof( unsigned ), IORING_OFF_SQ_RING )
+  , cq_ring_( ring_fd_, params_.cq_off.cqes + params_.cq_entries * sizeof( io_uring_cqe ), IORING_OFF_CQ_RING )
+  , sqes_( ring_fd_, params_.sq_entries * sizeof( io_uring_sqe ), IORING_OFF_SQES )
+  , sq_entries_( params_.sq_entries )
+  , sq_mask_( *sq_ring_.at<unsigned>( params_.sq_off.ring_mask ) )
+  , sq_head_( sq_ring_.at<unsigned>( params_.sq_off.head ) )
+  , sq_tail_shared_( sq_ring_.at<unsigned>( params_.sq_off.tail ) )
+  , sq_array_( sq_ring_.at<unsigned>( params_.sq_off.array ) )
+  , sqe_array_( sqes_.at<io_uring_sqe>( 0 ) )
+  , cq_mask_( *cq_ring_.at<unsigned>( params_.cq_off.ring_mask ) )
+  , cq_head_( cq_ring_.at<unsigned>( params_.cq_off.head ) )
+  , cq_tail_( cq_ring_.at<unsigned>( params_.cq_off.tail ) )
+  , cqe_array_( cq_ring_.at<io_uring_cqe>( params_.cq_off.cqes ) )
+  , sq_tail_( *sq_tail_shared_ )
+  , submitted_tail_( sq_tail_ )
+{
+  const int efd = eventfd_.fd_num();
+  CheckSystemCall( "io_uring_register", io_uring_register( ring_fd_.fd_num(), IORING_REGISTER_EVENTFD, &efd, 1 ) );
+}
+
+void IOUring::register_buffers( const span<const iovec> buffers )
+{
+  const auto count = static_cast<unsigned>( buffers.size() );
+  CheckSystemCall( "io_uring_register",
+                   io_uring_register( ring_fd_.fd_num(), IORING_REGISTER_BUFFERS, buffers.data(), count ) );
+}
+
+io_uring_sqe* IOUring::next_sqe()
+{
+  if ( sq_tail_ - load_acquire( sq_head_ ) >= sq_entries_ ) {
+    return nullptr;
+  }
+
+  const unsigned index = sq_tail_ & sq_mask_;
+  sq_array_[index] = index;
+  io_uring_sqe* const sqe = &sqe_array_[index];
+  memset( sqe, 0, sizeof( *sqe ) );
+  ++sq_tail_;
+  return sqe;
+}
+
+bool IOUring::read_fixed( const FileDescriptor& fd, string& buffer, const uint16_t index, const uint64_t user_data )
+{
+  return queue_read( IORING_OP_READ_FIXED, fd, buffer, index, user_data );
+}
+
+bool IOUring::read( const FileDescriptor& fd, string& buffer, const uint64_t user_data )
+{
+  return queue_read( IORING_OP_READ, fd, buffer, 0, user_data );
+}
+
+bool IOUring::queue_read( const uint8_t opcode,
+                          const FileDescriptor& fd,
+                          string& buffer,
+                          const uint16_t index,
+                          const uint64_t user_data )
+{
+  io_uring_sqe* const sqe = next_sqe();
+  if ( not sqe ) {
+    return false;
+  }
+
+  sqe->opcode = opcode;
+  sqe->fd = fd.fd_num();
+  sqe->addr = reinterpret_cast<uint64_t>( buffer.data() ); // NOLINT(*-reinterpret-cast)
+  sqe->len = static_cast<uint32_t>( buffer.size() );
+  sqe->off = CURRENT_POSITION;
+  sqe->buf_index = index;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool IOUring::writev( const FileDescriptor& fd, const span<const iovec> iovecs, const uint64_t user_data )
+{
+  io_uring_sqe* const sqe = next_sqe();
+  if ( not sqe ) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = fd.fd_num();
+  sqe->addr = reinterpret_cast<uint64_t>( iovecs.data() ); // NOLINT(*-reinterpret-cast)
+  sqe->len = static_cast<uint32_t>( iovecs.size() );
+  sqe->off = CURRENT_POSITION;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool IOUring::cancel( const uint64_t target, const uint64_t user_data )
+{
+  io_uring_sqe* const sqe = next_sqe();
+  if ( not sqe ) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = target;
+  sqe->user_data = user_data;
+  return true;
+}
+
+unsigned IOUring::submit()
+{
+  const unsigned to_submit = queued();
+  if ( to_submit == 0 ) {
+    return 0;
+  }
+  enter( 0 );
+  return to_submit;
+}
+
+void IOUring::submit_and_wait( const unsigned count )
+{
+  enter( count );
+}
+
+void IOUring::enter( const unsigned min_complete )
+{
+  const unsigned to_submit = queued();
+  store_release( sq_tail_shared_, sq_tail_ );
+  submitted_tail_ = sq_tail_;
+
+  const unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+  int submitted = -1;
+  do {
+    submitted = io_uring_enter( ring_fd_.fd_num(), to_submit, min_complete, flags );
+  } while ( submitted < 0 and errno == EINTR and min_complete );
+  CheckSystemCall( "io_uring_enter", submitted );
+
+  // the kernel consumes every entry unless it runs out of memory, so a short count is an error
+  if ( static_cast<unsigned>( submitted ) != to_submit ) {
+    throw runtime_error( "io_uring_enter submitted " + to_string( submitted ) + " of " + to_string( to_submit )
+                         + " operations" );
+  }
+}
+
+void IOUring::reap( vector<Completion>& completions )
+{
+  unsigned head = *cq_head_;
+  const unsigned tail = load_acquire( cq_tail_ );
+  for ( ; head != tail; ++head ) {
+    const io_uring_cqe& cqe = cqe_array_[head & cq_mask_];
+    completions.push_back( { cqe.user_data, cqe.res } );
+  }
+  store_release( cq_head_, head );
+}
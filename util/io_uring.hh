@@ -0,0 +1,136 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <span>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+//! \brief A minimal [io_uring](\ref man7::io_uring) instance, driven by raw system calls
+//! \details Operations are queued in the submission ring and handed to the kernel together by
+//! submit(), in one [io_uring_enter(2)](\ref man2::io_uring_enter) call. As operations finish, the
+//! kernel posts to the completion ring and signals completion_fd(), which an EventLoop can watch.
+class IOUring
+{
+public:
+  //! A finished operation: the `user_data` it was queued with, and its result (or -errno)
+  struct Completion
+  {
+    uint64_t user_data;
+    int32_t result;
+  };
+
+  //! Returns true if the kernel allows io_uring (it can be disabled by sysctl or seccomp)
+  static bool supported();
+
+  //! Create a ring with room for at least `entries` queued operations
+  explicit IOUring( unsigned entries );
+
+  //! Register buffers for read_fixed(), which must not be reallocated while registered
+  void register_buffers( std::span<const iovec> buffers );
+
+  //! Queue a read into registered buffer `index` (returns false if the submission ring is full)
+  bool read_fixed( const FileDescriptor& fd, std::string& buffer, uint16_t index, uint64_t user_data );
+
+  //! Queue a read into an unregistered buffer (returns false if the submission ring is full)
+  bool read( const FileDescriptor& fd, std::string& buffer, uint64_t user_data );
+
+  //! Queue a gathering write (returns false if the submission ring is full)
+  //! \note The memory that `iovecs` point to must remain valid until the write completes.
+  bool writev( const FileDescriptor& fd, std::span<const iovec> iovecs, uint64_t user_data );
+
+  //! Queue a request to cancel the operation queued with `target` (returns false if the submission ring is full)
+  bool cancel( uint64_t target, uint64_t user_data );
+
+  //! Hand every queued operation to the kernel; returns the number submitted
+  unsigned submit();
+
+  //! Submit the queued operations, and wait until at least `count` operations have finished
+  void submit_and_wait( unsigned count );
+
+  //! Append the finished operations to `completions`
+  void reap( std::vector<Completion>& completions );
+
+  //! Readable when operations have finished (reading it resets it)
+  FileDescriptor& completion_fd() { return eventfd_; }
+
+  //! Number of operations queued but not yet submitted
+  unsigned queued() const { return sq_tail_ - submitted_tail_; }
+
+  //! Number of operations that can be in flight without overflowing the completion ring
+  unsigned capacity() const { return sq_entries_; }
+
+  //! \name
+  //! The kernel shares memory with this object, so it cannot be moved or copied
+
+  //!@{
+  IOUring( const IOUring& other ) = delete;
+  IOUring& operator=( const IOUring& other ) = delete;
+  IOUring( IOUring&& other ) = delete;
+  IOUring& operator=( IOUring&& other ) = delete;
+  ~IOUring() = default;
+  //!@}
+
+private:
+  //! A shared memory region of the ring, unmapped on destruction
+  class Mapping
+  {
+    void* addr_;
+    size_t length_;
+
+  public:
+    Mapping( const FileDescriptor& ring_fd, size_t length, uint64_t offset );
+    ~Mapping();
+
+    template<typename T>
+    T* at( const uint32_t offset ) const
+    {
+      return reinterpret_cast<T*>( static_cast<char*>( addr_ ) + offset ); // NOLINT(*-reinterpret-cast)
+    }
+
+    Mapping( const Mapping& other ) = delete;
+    Mapping& operator=( const Mapping& other ) = delete;
+    Mapping( Mapping&& other ) = delete;
+    Mapping& operator=( Mapping&& other ) = delete;
+  };
+
+  io_uring_params params_;
+  FileDescriptor ring_fd_;
+  FileDescriptor eventfd_;
+
+  Mapping sq_ring_;
+  Mapping cq_ring_;
+  Mapping sqes_;
+
+  unsigned sq_entries_;
+  unsigned sq_mask_;
+  unsigned* sq_head_;
+  unsigned* sq_tail_shared_;
+  unsigned* sq_array_;
+  io_uring_sqe* sqe_array_;
+
+  unsigned cq_mask_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  io_uring_cqe* cqe_array_;
+
+  unsigned sq_tail_ {};        //!< Tail of the submission ring, including operations not yet submitted
+  unsigned submitted_tail_ {}; //!< Tail as of the last submit()
+
+  //! The next free submission entry (cleared), or nullptr if the ring is full
+  io_uring_sqe* next_sqe();
+
+  //! Submit the queued operations and wait for `min_complete` to finish
+  void enter( unsigned min_complete );
+
+  //! Queue a read operation
+  bool queue_read( uint8_t opcode,
+                   const FileDescriptor& fd,
+                   std::string& buffer,
+                   uint16_t index,
+                   uint64_t user_data );
+};
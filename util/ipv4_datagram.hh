@@ -13,14 +13,16 @@ struct IPv4Datagram
   IPv4Header header {};
   std::vector<Ref<std::string>> payload {};
 
-  void parse( Parser& parser )
+  template<class ParserT> // Parser or SpanParser
+  void parse( ParserT& parser )
   {
     header.parse( parser );
     parser.truncate( header.payload_length() );
     parser.all_remaining( payload );
   }
 
-  void serialize( Serializer& serializer ) const
+  template<class SerializerT> // Serializer or HeaderSerializer
+  void serialize( SerializerT& serializer ) const
   {
     header.serialize( serializer );
     serializer.buffer( payload );
@@ -7,7 +7,8 @@
 using namespace std;
 
 // Parse from string.
-void IPv4Header::parse( Parser& parser )
+template<class ParserT>
+void IPv4Header::parse( ParserT& parser )
 {
   uint8_t first_byte {};
   parser.integer( first_byte );
@@ -51,8 +52,12 @@ void IPv4Header::parse( Parser& parser )
   }
 }
 
+template void IPv4Header::parse( Parser& );
+template void IPv4Header::parse( SpanParser& );
+
 // Serialize the IPv4Header (does not recompute the checksum)
-void IPv4Header::serialize( Serializer& serializer ) const
+template<class SerializerT>
+void IPv4Header::serialize( SerializerT& serializer ) const
 {
   // consistency checks
   if ( ver != 4 ) {
@@ -77,6 +82,9 @@ void IPv4Header::serialize( Serializer& serializer ) const
   serializer.integer( dst );
 }
 
+template void IPv4Header::serialize( Serializer& ) const;
+template void IPv4Header::serialize( HeaderSerializer& ) const;
+
 uint16_t IPv4Header::payload_length() const
 {
   return len - 4 * hlen;
@@ -105,7 +113,7 @@ uint32_t IPv4Header::pseudo_checksum() const
 void IPv4Header::compute_checksum()
 {
   cksum = 0;
-  Serializer s;
+  HeaderSerializer s;
   serialize( s );
 
   // calculate checksum -- taken over header only
@@ -114,6 +122,31 @@ void IPv4Header::compute_checksum()
   cksum = check.value();
 }
 
+void IPv4Header::update_checksum( const uint16_t old_word, const uint16_t new_word )
+{
+  cksum = InternetChecksum::update( cksum, old_word, new_word );
+}
+
+void IPv4Header::decrement_ttl()
+{
+  // the TTL shares its 16-bit word with the protocol
+  const uint16_t old_word = static_cast<uint16_t>( ttl << 8 | proto );
+  ttl--;
+  update_checksum( old_word, static_cast<uint16_t>( ttl << 8 | proto ) );
+}
+
+void IPv4Header::rewrite_src( const uint32_t new_src )
+{
+  cksum = InternetChecksum::update32( cksum, src, new_src );
+  src = new_src;
+}
+
+void IPv4Header::rewrite_dst( const uint32_t new_dst )
+{
+  cksum = InternetChecksum::update32( cksum, dst, new_dst );
+  dst = new_dst;
+}
+
 string IPv4Header::to_string() const
 {
   stringstream ss {};
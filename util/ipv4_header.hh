@@ -57,9 +57,23 @@ struct IPv4Header
   // Set checksum to correct value
   void compute_checksum();
 
+  // Update the checksum after one 16-bit word of the header changed from `old_word` to `new_word`
+  // ([RFC 1624](\ref rfc::rfc1624)), instead of recomputing it over the whole header
+  void update_checksum( uint16_t old_word, uint16_t new_word );
+
+  // Decrement the TTL (e.g. when forwarding), updating the checksum to match
+  void decrement_ttl();
+
+  // Rewrite the source or destination address (e.g. for NAT), updating the checksum to match
+  // (a TCP or UDP checksum, which covers the addresses too, must be updated separately)
+  void rewrite_src( uint32_t new_src );
+  void rewrite_dst( uint32_t new_dst );
+
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
-  void parse( Parser& parser );
-  void serialize( Serializer& serializer ) const;
+  template<class ParserT> // Parser or SpanParser
+  void parse( ParserT& parser );
+  template<class SerializerT> // Serializer or HeaderSerializer
+  void serialize( SerializerT& serializer ) const;
 };
@@ -0,0 +1,87 @@
+#include "loopback_adapter.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+LoopbackAdapter::LoopbackAdapter( shared_ptr<Queue> outbound,
+                                  shared_ptr<Queue> inbound,
+                                  const LoopbackLinkConfig& link )
+  : _outbound( move( outbound ) ), _inbound( move( inbound ) ), _link( link )
+{}
+
+pair<LoopbackAdapter, LoopbackAdapter> LoopbackAdapter::make_pair( const LoopbackLinkConfig& link )
+{
+  auto a_to_b = make_shared<Queue>( link.queue_capacity );
+  auto b_to_a = make_shared<Queue>( link.queue_capacity );
+  return { LoopbackAdapter { a_to_b, b_to_a, link }, LoopbackAdapter { b_to_a, a_to_b, link } };
+}
+
+void LoopbackAdapter::_take_inbound()
+{
+  while ( auto in_flight = _inbound->pop() ) {
+    // a message that was held back arrives after later ones, so it isn't necessarily last
+    const auto position = upper_bound(
+      _arriving.begin(), _arriving.end(), in_flight->arrival_ms, [&]( const uint64_t arrival, const auto& other ) {
+        return arrival < other.arrival_ms;
+      } );
+    _arriving.insert( position, move( *in_flight ) );
+  }
+}
+
+optional<TCPMessage> LoopbackAdapter::read()
+{
+  _take_inbound();
+  if ( _arriving.empty() or _arriving.front().arrival_ms > _now_ms ) {
+    return {};
+  }
+  TCPMessage message = move( _arriving.front().message );
+  _arriving.pop_front();
+  return message;
+}
+
+size_t LoopbackAdapter::read( vector<TCPMessage>& segs, const size_t max_datagrams )
+{
+  ++read_stats_mutable().wakeups;
+  _take_inbound();
+
+  size_t count = 0;
+  while ( count < max_datagrams and not _arriving.empty() and _arriving.front().arrival_ms <= _now_ms ) {
+    segs.push_back( move( _arriving.front().message ) );
+    _arriving.pop_front();
+    count++;
+  }
+
+  read_stats_mutable().datagrams += count;
+  return count;
+}
+
+void LoopbackAdapter::write( const TCPMessage& seg )
+{
+  // with a bandwidth limit, the message leaves once the link has sent what it was given before
+  double departure_ms = static_cast<double>( _now_ms );
+  if ( _link.bandwidth_bytes_per_ms != 0 ) {
+    const size_t length = TCPSegment::HEADER_LENGTH + seg.sender->payload.size();
+    _link_free_ms = max( _link_free_ms, departure_ms )
+                    + static_cast<double>( length ) / static_cast<double>( _link.bandwidth_bytes_per_ms );
+    departure_ms = _link_free_ms;
+  }
+
+  uint64_t arrival_ms = static_cast<uint64_t>( ceil( departure_ms ) ) + _link.delay_ms;
+  if ( _link.reorder_rate != 0 and static_cast<uint16_t>( _rand() ) < _link.reorder_rate ) {
+    arrival_ms += _link.reorder_delay_ms;
+  }
+
+  // copy the message, which may borrow from the writer's own
+  if ( not _outbound->push( { seg, arrival_ms } ) ) {
+    _dropped++;
+  }
+}
+
+void LoopbackAdapter::write( const span<const TCPMessage> segs )
+{
+  for ( const auto& seg : segs ) {
+    write( seg );
+  }
+}
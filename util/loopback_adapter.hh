@@ -0,0 +1,85 @@
+#pragma once
+
+#include "fd_adapter.hh"
+#include "lossy_fd_adapter.hh"
+#include "random.hh"
+#include "spsc_queue.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+//! The link between a pair of LoopbackAdapters (the same in each direction), in simulated milliseconds
+struct LoopbackLinkConfig
+{
+  uint64_t delay_ms = 0;               //!< One-way propagation delay
+  uint64_t bandwidth_bytes_per_ms = 0; //!< Rate at which a writer's segments leave it (zero for unlimited)
+  uint16_t reorder_rate = 0;           //!< Chance (out of UINT16_MAX) that a segment is held back
+  uint64_t reorder_delay_ms = 1;       //!< How long a segment that is held back arrives late (so others pass it)
+  size_t queue_capacity = 65536;       //!< Most segments in flight in each direction (any more are dropped)
+};
+
+//! \brief One end of an in-memory link to another LoopbackAdapter, for running two TCPPeers in one process
+//! without system calls
+//! \details Messages cross the link in SPSCQueues, so the two ends can be used by different threads. Each
+//! message is stamped with when it will arrive (after the link's delay, and its bandwidth's queueing), by
+//! the clock of the end that writes it. Each end's clock advances only with tick(). To lose messages, wrap
+//! the adapters in a LossyFdAdapter (which drops them at the FdAdapterConfig loss rates).
+class LoopbackAdapter : public FdAdapterBase
+{
+  struct InFlight
+  {
+    TCPMessage message {};
+    uint64_t arrival_ms {};
+  };
+  using Queue = SPSCQueue<InFlight>;
+
+  std::shared_ptr<Queue> _outbound;
+  std::shared_ptr<Queue> _inbound;
+  LoopbackLinkConfig _link;
+  std::default_random_engine _rand { get_random_engine() };
+
+  uint64_t _now_ms {};
+  double _link_free_ms {};           //!< When the writer's link will have sent everything it has been given
+  std::deque<InFlight> _arriving {}; //!< Taken from `_inbound` but not arrived yet, in order of arrival
+  uint64_t _dropped {};
+
+  LoopbackAdapter( std::shared_ptr<Queue> outbound,
+                   std::shared_ptr<Queue> inbound,
+                   const LoopbackLinkConfig& link );
+
+  //! Move the messages waiting in `_inbound` to `_arriving`
+  void _take_inbound();
+
+public:
+  //! Two adapters, each writing to the other
+  static std::pair<LoopbackAdapter, LoopbackAdapter> make_pair( const LoopbackLinkConfig& link = {} );
+
+  //! The next message that has arrived, if any
+  std::optional<TCPMessage> read();
+
+  //! Append the messages that have arrived (at most `max_datagrams`) to `segs`
+  //! \returns the number appended
+  size_t read( std::vector<TCPMessage>& segs, size_t max_datagrams = std::numeric_limits<size_t>::max() );
+
+  //! Send a copy of a message to the other end
+  void write( const TCPMessage& seg );
+  void write( std::span<const TCPMessage> segs );
+
+  //! Advance this end's clock
+  void tick( const size_t ms_since_last_tick ) { _now_ms += ms_since_last_tick; }
+
+  //! Number of messages dropped because too many were in flight
+  uint64_t dropped() const { return _dropped; }
+};
+
+static_assert( TCPBatchDatagramAdapter<LoopbackAdapter> );
+static_assert( TCPBatchDatagramAdapter<LossyFdAdapter<LoopbackAdapter>> );
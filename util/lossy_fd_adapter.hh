@@ -5,9 +5,13 @@
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 
+#include <algorithm>
+#include <cstddef>
 #include <optional>
 #include <random>
+#include <span>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template<typename AdapterT>
@@ -49,6 +53,19 @@ public:
     return ret;
   }
 
+  //! \brief Batched read from the underlying AdapterT instance, potentially dropping each datagram read
+  //! \returns the number of segments appended to `segs` (and not dropped)
+  size_t read( std::vector<TCPMessage>& segs )
+    requires requires { _adapter.read( segs ); }
+  {
+    const size_t original_size = segs.size();
+    _adapter.read( segs );
+    const auto first_read = segs.begin() + static_cast<std::ptrdiff_t>( original_size );
+    segs.erase( std::remove_if( first_read, segs.end(), [&]( const auto& ) { return _should_drop( false ); } ),
+                segs.end() );
+    return segs.size() - original_size;
+  }
+
   //! \brief Write to the underlying AdapterT instance, potentially dropping the datagram to be written
   //! \param[in] seg is the packet to either write or drop
   void write( const TCPMessage& seg )
@@ -59,6 +76,15 @@ public:
     return _adapter.write( seg );
   }
 
+  //! \brief Batched write to the underlying AdapterT instance, potentially dropping each datagram
+  void write( std::span<const TCPMessage> segs )
+    requires requires { _adapter.write( segs ); }
+  {
+    for ( const auto& seg : segs ) {
+      write( seg );
+    }
+  }
+
   //! \name
   //! Passthrough functions to the underlying AdapterT instance
 
@@ -66,4 +92,5 @@ public:
   const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
   FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
   void tick( const size_t ms_since_last_tick ) { _adapter.tick( ms_since_last_tick ); }
+  const auto& read_stats() const { return _adapter.read_stats(); } //!< AdapterT::read_stats passthrough
 };
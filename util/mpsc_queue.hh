@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+//! \brief A bounded queue that any number of producer threads and one consumer thread can use without locks
+//! \details Each slot has a sequence number that says whether it is free for the push of a given turn or holds
+//! the item for a given pop. Producers claim a turn by advancing the tail with compare-and-swap. Items from
+//! one producer come out in the order that producer pushed them.
+template<typename T>
+class MPSCQueue
+{
+  static constexpr size_t CACHE_LINE = 64;
+
+  struct Slot
+  {
+    std::atomic<size_t> sequence {};
+    T item {};
+  };
+
+  size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+
+  alignas( CACHE_LINE ) std::atomic<size_t> tail_ {}; // next turn to push (claimed by producers)
+  alignas( CACHE_LINE ) size_t head_ {};              // next turn to pop (used only by the consumer)
+
+public:
+  //! Construct with room for at least `capacity` items (rounded up to a power of two)
+  explicit MPSCQueue( const size_t capacity )
+    : capacity_( std::bit_ceil( capacity ) ), slots_( std::make_unique<Slot[]>( capacity_ ) )
+  {
+    for ( size_t i = 0; i < capacity_; i++ ) {
+      slots_[i].sequence.store( i, std::memory_order_relaxed );
+    }
+  }
+
+  //! Any producer: append an item, or return false (leaving `item` untouched) if the queue is full
+  bool push( T&& item )
+  {
+    size_t tail = tail_.load( std::memory_order_relaxed );
+    while ( true ) {
+      Slot& slot = slots_[tail & ( capacity_ - 1 )];
+      const size_t sequence = slot.sequence.load( std::memory_order_acquire );
+      if ( sequence == tail ) {
+        // the slot is free for this turn; take the turn unless another producer did first
+        if ( tail_.compare_exchange_weak( tail, tail + 1, std::memory_order_relaxed ) ) {
+          slot.item = std::move( item );
+          slot.sequence.store( tail + 1, std::memory_order_release );
+          return true;
+        }
+      } else if ( sequence < tail ) {
+        return false; // the slot still holds the item from a lap ago
+      } else {
+        tail = tail_.load( std::memory_order_relaxed ); // another producer took this turn
+      }
+    }
+  }
+
+  //! Consumer: remove the oldest item, if any
+  std::optional<T> pop()
+  {
+    Slot& slot = slots_[head_ & ( capacity_ - 1 )];
+    if ( slot.sequence.load( std::memory_order_acquire ) != head_ + 1 ) {
+      return {};
+    }
+    std::optional<T> ret { std::move( slot.item ) };
+    slot.sequence.store( head_ + capacity_, std::memory_order_release );
+    head_++;
+    return ret;
+  }
+};
@@ -1,5 +1,6 @@
 #include "parser.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 
@@ -10,19 +11,18 @@ string_view Parser::BufferList::peek() const
   if ( buffer_.empty() ) {
     throw runtime_error( "peek on empty BufferList" );
   }
-  return string_view { buffer_.front().get() }.substr( skip_ );
+  return buffer_.front().get();
 }
 
 void Parser::BufferList::remove_prefix( uint64_t len )
 {
   while ( len and not buffer_.empty() ) {
     const uint64_t to_pop_now = min( len, peek().size() );
-    skip_ += to_pop_now;
+    buffer_.front().remove_prefix( to_pop_now );
     len -= to_pop_now;
     size_ -= to_pop_now;
-    if ( skip_ == buffer_.front()->size() ) {
+    if ( buffer_.front().empty() ) {
       buffer_.pop_front();
-      skip_ = 0;
     }
   }
 }
@@ -42,21 +42,22 @@ void Parser::BufferList::truncate( size_t len )
   size_t size_so_far = 0;
   auto it = buffer_.begin();
   while ( it != buffer_.end() ) {
-    if ( size_so_far + it->get().size() < len ) {
-      size_so_far += it->get().size();
+    if ( size_so_far + it->size() < len ) {
+      size_so_far += it->size();
       ++it;
       continue;
     }
 
-    if ( size_so_far + it->get().size() == len ) {
+    if ( size_so_far + it->size() == len ) {
       ++it;
       break;
     }
 
-    assert( !it->get().empty() );
+    assert( !it->empty() );
     assert( len > size_so_far );
-    assert( len - size_so_far < it->get().size() );
-    it->get_mut().resize( len - size_so_far );
+    assert( len - size_so_far < it->size() );
+    it->truncate( len - size_so_far );
+    ++it;
     break;
   }
 
@@ -70,18 +71,12 @@ void Parser::BufferList::truncate( size_t len )
 void Parser::BufferList::dump_all( vector<Ref<std::string>>& out )
 {
   out.clear();
-  if ( empty() ) {
-    return;
-  }
-  if ( skip_ ) {
-    out.emplace_back( buffer_.front()->substr( skip_ ) );
-  } else {
-    out.push_back( move( buffer_.front() ) );
-  }
-  buffer_.pop_front();
+  // each buffer already refers to just its unparsed part, so none of the bytes move
   for ( auto&& x : buffer_ ) {
     out.emplace_back( move( x ) );
   }
+  buffer_.clear();
+  size_ = 0;
 }
 
 vector<string_view> Parser::BufferList::buffer() const
@@ -91,10 +86,8 @@ vector<string_view> Parser::BufferList::buffer() const
   }
   vector<string_view> ret;
   ret.reserve( buffer_segment_count() );
-  auto tmp_skip = skip_;
   for ( const auto& x : buffer_ ) {
-    ret.push_back( string_view { x.get() }.substr( tmp_skip ) );
-    tmp_skip = 0;
+    ret.push_back( x.get() );
   }
   return ret;
 }
@@ -130,6 +123,32 @@ void Parser::concatenate_all_remaining( std::string& out )
   }
 }
 
+void SpanParser::all_remaining( vector<Ref<std::string>>& out )
+{
+  out.clear();
+  if ( not input_.empty() ) {
+    out.emplace_back( std::string { input_ } );
+    input_ = {};
+  }
+}
+
+void SpanParser::string( span<char> out )
+{
+  check_size( out.size() );
+  if ( has_error() ) {
+    return;
+  }
+
+  ranges::copy( input_.substr( 0, out.size() ), out.begin() );
+  input_.remove_prefix( out.size() );
+}
+
+void SpanParser::concatenate_all_remaining( std::string& out )
+{
+  out.assign( input_ );
+  input_ = {};
+}
+
 void Serializer::flush()
 {
   if ( not buffer_.empty() ) {
@@ -166,3 +185,40 @@ vector<Ref<string>> Serializer::finish()
   flush();
   return move( output_ );
 }
+
+void HeaderSerializer::flush()
+{
+  if ( headers_size_ > unflushed_ ) {
+    add_piece( { headers_.data() + unflushed_, headers_size_ - unflushed_ } );
+    unflushed_ = headers_size_;
+  }
+}
+
+void HeaderSerializer::add_piece( const string_view piece )
+{
+  if ( piece_count_ == MAX_PIECES ) {
+    throw runtime_error( "HeaderSerializer: more than MAX_PIECES buffers" );
+  }
+  pieces_[piece_count_++] = piece;
+}
+
+void HeaderSerializer::buffer( const string_view buf )
+{
+  if ( not buf.empty() ) {
+    flush();
+    add_piece( buf );
+  }
+}
+
+void HeaderSerializer::buffer( const vector<Ref<std::string>>& bufs )
+{
+  for ( const auto& b : bufs ) {
+    buffer( b );
+  }
+}
+
+span<const string_view> HeaderSerializer::finish()
+{
+  flush();
+  return { pieces_.data(), piece_count_ };
+}
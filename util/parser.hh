@@ -2,8 +2,12 @@
 
 #include "ref.hh"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <ranges>
 #include <span>
@@ -12,13 +16,46 @@
 #include <string_view>
 #include <vector>
 
+// Read a big-endian integer from (possibly unaligned) memory
+template<std::unsigned_integral T>
+T load_big_endian( const char* data )
+{
+  T value {};
+  std::memcpy( &value, data, sizeof( T ) );
+  if constexpr ( std::endian::native == std::endian::little ) {
+    if constexpr ( sizeof( T ) == 2 ) {
+      value = __builtin_bswap16( value );
+    } else if constexpr ( sizeof( T ) == 4 ) {
+      value = __builtin_bswap32( value );
+    } else if constexpr ( sizeof( T ) == 8 ) {
+      value = __builtin_bswap64( value );
+    }
+  }
+  return value;
+}
+
+// Write a big-endian integer to (possibly unaligned) memory
+template<std::unsigned_integral T>
+void store_big_endian( char* data, T value )
+{
+  if constexpr ( std::endian::native == std::endian::little ) {
+    if constexpr ( sizeof( T ) == 2 ) {
+      value = __builtin_bswap16( value );
+    } else if constexpr ( sizeof( T ) == 4 ) {
+      value = __builtin_bswap32( value );
+    } else if constexpr ( sizeof( T ) == 8 ) {
+      value = __builtin_bswap64( value );
+    }
+  }
+  std::memcpy( data, &value, sizeof( T ) );
+}
+
 class Parser
 {
   class BufferList
   {
     uint64_t size_ {};
-    std::deque<Ref<std::string>> buffer_ {};
-    uint64_t skip_ {};
+    std::deque<Ref<std::string>> buffer_ {}; // each narrowed to its unparsed part
 
   public:
     explicit BufferList( std::ranges::range auto&& buffers )
@@ -29,7 +66,7 @@ class Parser
         if ( buffer_.back().is_borrowed() ) {
           throw std::runtime_error( "cannot parse borrowed string" );
         }
-        size_ += buffer_.back()->size();
+        size_ += buffer_.back().size();
       }
     }
 
@@ -77,18 +114,62 @@ public:
       return;
     }
 
-    if constexpr ( sizeof( T ) == 1 ) {
-      out = static_cast<uint8_t>( input_.peek().front() );
+    // fast path: the integer is all in the first buffer
+    const std::string_view front = input_.peek();
+    if ( front.size() >= sizeof( T ) ) {
+      out = load_big_endian<T>( front.data() );
+      input_.remove_prefix( sizeof( T ) );
+      return;
+    }
+
+    out = static_cast<T>( 0 );
+    for ( size_t i = 0; i < sizeof( T ); i++ ) {
+      out <<= 8;
+      out |= static_cast<uint8_t>( input_.peek().front() );
       input_.remove_prefix( 1 );
+    }
+  }
+};
+
+// A parser with the same interface as Parser, over one contiguous buffer (which must outlive it).
+// For the common case of a datagram read in one piece, it reads each integer with one (unaligned) load
+// and allocates nothing until a payload is copied out.
+class SpanParser
+{
+  std::string_view input_;
+  bool error_ {};
+
+  void check_size( const size_t size )
+  {
+    if ( size > input_.size() ) {
+      error_ = true;
+    }
+  }
+
+public:
+  explicit SpanParser( std::string_view input ) : input_( input ) {}
+
+  bool has_error() const { return error_; }
+  void set_error() { error_ = true; }
+  void remove_prefix( size_t n ) { input_.remove_prefix( std::min( n, input_.size() ) ); }
+  void truncate( size_t len ) { input_ = input_.substr( 0, len ); }
+
+  void all_remaining( std::vector<Ref<std::string>>& out );
+  std::string_view buffer() const { return input_; }
+
+  void string( std::span<char> out );
+  void concatenate_all_remaining( std::string& out );
+
+  template<std::unsigned_integral T>
+  void integer( T& out )
+  {
+    check_size( sizeof( T ) );
+    if ( has_error() ) {
       return;
-    } else {
-      out = static_cast<T>( 0 );
-      for ( size_t i = 0; i < sizeof( T ); i++ ) {
-        out <<= 8;
-        out |= static_cast<uint8_t>( input_.peek().front() );
-        input_.remove_prefix( 1 );
-      }
     }
+
+    out = load_big_endian<T>( input_.data() );
+    input_.remove_prefix( sizeof( T ) );
   }
 };
 
@@ -116,3 +197,48 @@ public:
   void buffer( const std::vector<Ref<std::string>>& bufs );
   std::vector<Ref<std::string>> finish();
 };
+
+// A serializer with the same interface as Serializer, for the transmit path. It writes headers into a
+// fixed-size buffer inside the object (one store per integer) and refers to payloads instead of copying them,
+// so serializing a datagram allocates nothing. The result refers to this object and to the payloads.
+class HeaderSerializer
+{
+public:
+  static constexpr size_t CAPACITY = 64;  // room for Ethernet (14), IPv4 (20) and TCP (20) headers
+  static constexpr size_t MAX_PIECES = 8; // most buffers in the result
+
+private:
+  std::array<char, CAPACITY> headers_ {};
+  size_t headers_size_ {};
+  size_t unflushed_ {}; // start of the header bytes not yet in pieces_
+  std::array<std::string_view, MAX_PIECES> pieces_ {};
+  size_t piece_count_ {};
+
+  void flush();
+  void add_piece( std::string_view piece );
+
+public:
+  HeaderSerializer() = default;
+
+  // the pieces refer to headers_, so the object stays put
+  HeaderSerializer( const HeaderSerializer& other ) = delete;
+  HeaderSerializer& operator=( const HeaderSerializer& other ) = delete;
+  HeaderSerializer( HeaderSerializer&& other ) = delete;
+  HeaderSerializer& operator=( HeaderSerializer&& other ) = delete;
+  ~HeaderSerializer() = default;
+
+  template<std::unsigned_integral T>
+  void integer( const T val )
+  {
+    if ( headers_size_ + sizeof( T ) > CAPACITY ) {
+      throw std::runtime_error( "HeaderSerializer: headers longer than CAPACITY" );
+    }
+    store_big_endian( headers_.data() + headers_size_, val );
+    headers_size_ += sizeof( T );
+  }
+
+  void buffer( std::string_view buf );
+  void buffer( const Ref<std::string>& buf ) { buffer( buf.get() ); }
+  void buffer( const std::vector<Ref<std::string>>& bufs );
+  std::span<const std::string_view> finish();
+};
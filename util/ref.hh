@@ -1,7 +1,13 @@
 #pragma once
 
+#include "buffer_pool.hh"
+
+#include <algorithm>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 
 /*
  * A Ref<T> represents a "borrowed"-or-"owned" reference to an object of type T.
@@ -124,3 +130,188 @@ static Ref<T> borrow( const T& obj )
 {
   return Ref<T>::borrow( obj );
 }
+
+/*
+ * Ref<std::string> refers to a string of bytes (e.g. a packet buffer): owned or borrowed as above, or shared
+ * with the other Refs to a PooledBuffer (see buffer_pool.hh), which goes back to its pool when the last of
+ * them lets go. It can also be narrowed to part of the string: remove_prefix() and truncate() move no bytes,
+ * so parsing a header off the front of a buffer costs the same however long the rest of it is. Because of
+ * that, its accessors give a std::string_view of the part it refers to, rather than the string itself.
+ */
+template<>
+class Ref<std::string>
+{
+public:
+  // default constructor -> owned reference (empty)
+  Ref() = default;
+
+  // construct from rvalue reference -> owned reference (moved from original)
+  Ref( std::string&& str ) : owned_( std::move( str ) ), size_( owned_.size() ) {} // NOLINT(*-explicit-*)
+
+  // construct from a pooled buffer -> shared reference (to its first `size` bytes)
+  Ref( PooledBuffer& buffer, const size_t size )
+    : shared_( &buffer ), size_( std::min( size, buffer.storage_.size() ) )
+  {
+    shared_->add_ref();
+  }
+
+  // move constructor/assignment: move from original (owned, borrowed or shared), which is left empty
+  Ref( Ref&& other ) noexcept
+    : owned_( std::move( other.owned_ ) )
+    , borrowed_( std::exchange( other.borrowed_, nullptr ) )
+    , shared_( std::exchange( other.shared_, nullptr ) )
+    , start_( std::exchange( other.start_, 0 ) )
+    , size_( std::exchange( other.size_, 0 ) )
+  {}
+
+  Ref& operator=( Ref&& other ) noexcept
+  {
+    if ( this != &other ) {
+      drop_shared();
+      owned_ = std::move( other.owned_ );
+      borrowed_ = std::exchange( other.borrowed_, nullptr );
+      shared_ = std::exchange( other.shared_, nullptr );
+      start_ = std::exchange( other.start_, 0 );
+      size_ = std::exchange( other.size_, 0 );
+    }
+    return *this;
+  }
+
+  // borrow from const reference: borrowed reference (points to original)
+  static Ref borrow( const std::string& str )
+  {
+    Ref ret;
+    ret.borrowed_ = &str;
+    ret.size_ = str.size();
+    return ret;
+  }
+
+  // duplicate Ref by producing borrowed reference to the same part of the same string
+  Ref borrow() const
+  {
+    Ref ret;
+    ret.borrowed_ = shared_ ? &shared_->storage_ : borrowed_ ? borrowed_ : &owned_;
+    ret.start_ = start_;
+    ret.size_ = size_;
+    return ret;
+  }
+
+#ifndef DISALLOW_REF_IMPLICIT_COPY
+  // implicit copy via copy constructor -> another shared reference (to a pooled buffer), or else an owned
+  // reference (copied from the part referred to)
+  Ref( const Ref& other )
+    : owned_( other.shared_ ? std::string {} : std::string { other.get() } )
+    , shared_( other.shared_ )
+    , start_( other.shared_ ? other.start_ : 0 )
+    , size_( other.size_ )
+  {
+    if ( shared_ ) {
+      shared_->add_ref();
+    }
+  }
+
+  // implicit copy via copy-assignment -> as for the copy constructor
+  Ref& operator=( const Ref& other )
+  {
+    if ( this != &other ) {
+      if ( other.shared_ ) {
+        other.shared_->add_ref();
+      }
+      drop_shared();
+      owned_ = other.shared_ ? std::string {} : std::string { other.get() };
+      borrowed_ = nullptr;
+      shared_ = other.shared_;
+      start_ = other.shared_ ? other.start_ : 0;
+      size_ = other.size_;
+    }
+    return *this;
+  }
+#else
+  // forbid implicit copies
+  Ref( const Ref& other ) = delete;
+  Ref& operator=( const Ref& other ) = delete;
+#endif
+
+  ~Ref() { drop_shared(); }
+
+  bool is_owned() const { return not borrowed_ and not shared_; }
+  bool is_borrowed() const { return borrowed_ != nullptr; }
+  bool is_shared() const { return shared_ != nullptr; }
+
+  // accessors
+
+  // the bytes referred to (owned, borrowed or shared)
+  std::string_view get() const { return { base() + start_, size_ }; }
+  operator std::string_view() const { return get(); } // NOLINT(*-explicit-*)
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // ref->size() etc. call std::string_view's members
+  struct ViewPointer
+  {
+    std::string_view view;
+    const std::string_view* operator->() const { return &view; }
+  };
+  ViewPointer operator->() const { return { get() }; }
+
+  // mutable reference to the string (owned only), which is first cut down to the part referred to
+  std::string& get_mut()
+  {
+    if ( not is_owned() ) {
+      throw std::runtime_error( "attempt to mutate borrowed or shared Ref" );
+    }
+    owned_.resize( start_ + size_ );
+    owned_.erase( 0, start_ );
+    start_ = 0;
+    return owned_;
+  }
+
+  // narrow the reference (moving no bytes)
+  void remove_prefix( const size_t n )
+  {
+    const size_t len = std::min( n, size_ );
+    start_ += len;
+    size_ -= len;
+  }
+
+  void truncate( const size_t len ) { size_ = std::min( len, size_ ); }
+
+  std::string release()
+  {
+    if ( is_owned() ) {
+      std::string ret = std::move( get_mut() );
+      size_ = 0;
+      return ret;
+    }
+
+    // a pooled buffer is shared, so the bytes are copied out of it
+    if ( shared_ ) {
+      return std::string { get() };
+    }
+
+#ifndef DISALLOW_REF_IMPLICIT_COPY
+    return std::string { get() };
+#else
+    throw std::runtime_error( "Ref::release() called on borrowed reference" );
+#endif
+  }
+
+private:
+  std::string owned_ {};
+  const std::string* borrowed_ {};
+  PooledBuffer* shared_ {};
+  size_t start_ {}; // the part of the string referred to
+  size_t size_ {};
+
+  const char* base() const
+  {
+    return shared_ ? shared_->storage_.data() : borrowed_ ? borrowed_->data() : owned_.data();
+  }
+
+  void drop_shared()
+  {
+    if ( shared_ ) {
+      std::exchange( shared_, nullptr )->drop_ref();
+    }
+  }
+};
@@ -2,8 +2,12 @@
 
 #include "exception.hh"
 
+#include <array>
+#include <cstring>
 #include <linux/if_packet.h>
+#include <netinet/udp.h>
 #include <stdexcept>
+#include <vector>
 
 using namespace std;
 
@@ -147,6 +151,88 @@ void DatagramSocket::send( const string_view payload )
   register_write();
 }
 
+size_t UDPSocket::recv_batch( const span<Datagram> datagrams, const size_t buffer_size )
+{
+  vector<Address::Raw> addresses( datagrams.size() );
+  vector<iovec> iovecs( datagrams.size() );
+  vector<array<char, CMSG_SPACE( sizeof( int ) )>> controls( datagrams.size() ); // for the GRO segment size
+  vector<mmsghdr> headers( datagrams.size() );
+  for ( size_t i = 0; i < datagrams.size(); i++ ) {
+    string& payload = datagrams[i].payload;
+    payload.resize( buffer_size );
+    iovecs[i] = { payload.data(), payload.size() };
+
+    msghdr& header = headers[i].msg_hdr;
+    header.msg_name = static_cast<sockaddr*>( addresses[i] );
+    header.msg_namelen = sizeof( sockaddr_storage );
+    header.msg_iov = &iovecs[i];
+    header.msg_iovlen = 1;
+    header.msg_control = controls[i].data();
+    header.msg_controllen = controls[i].size();
+  }
+
+  const int received = CheckSystemCall(
+    "recvmmsg", ::recvmmsg( fd_num(), headers.data(), static_cast<unsigned>( headers.size() ), 0, nullptr ) );
+
+  for ( size_t i = 0; i < static_cast<size_t>( received ); i++ ) {
+    register_read();
+    Datagram& datagram = datagrams[i];
+    msghdr& header = headers[i].msg_hdr;
+    datagram.peer = { addresses[i], header.msg_namelen };
+    datagram.payload.resize( header.msg_flags & MSG_TRUNC ? 0 : headers[i].msg_len );
+
+    datagram.segment_size = 0;
+    for ( cmsghdr* cmsg = CMSG_FIRSTHDR( &header ); cmsg != nullptr; cmsg = CMSG_NXTHDR( &header, cmsg ) ) {
+      if ( cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO ) {
+        int segment_size = 0;
+        memcpy( &segment_size, CMSG_DATA( cmsg ), sizeof( segment_size ) );
+        datagram.segment_size = segment_size;
+      }
+    }
+  }
+
+  return received;
+}
+
+size_t UDPSocket::send_batch( const span<const Datagram> datagrams )
+{
+  vector<iovec> iovecs( datagrams.size() );
+  vector<array<char, CMSG_SPACE( sizeof( uint16_t ) )>> controls( datagrams.size() ); // for the GSO segment size
+  vector<mmsghdr> headers( datagrams.size() );
+  for ( size_t i = 0; i < datagrams.size(); i++ ) {
+    const Datagram& datagram = datagrams[i];
+    iovecs[i] = { const_cast<char*>( datagram.payload.data() ), datagram.payload.size() }; // NOLINT(*-const-cast)
+
+    msghdr& header = headers[i].msg_hdr;
+    header.msg_name = const_cast<sockaddr*>( datagram.peer.raw() ); // NOLINT(*-const-cast)
+    header.msg_namelen = datagram.peer.size();
+    header.msg_iov = &iovecs[i];
+    header.msg_iovlen = 1;
+
+    if ( datagram.segment_size != 0 ) {
+      header.msg_control = controls[i].data();
+      header.msg_controllen = controls[i].size();
+      cmsghdr* cmsg = CMSG_FIRSTHDR( &header );
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN( sizeof( uint16_t ) );
+      memcpy( CMSG_DATA( cmsg ), &datagram.segment_size, sizeof( uint16_t ) );
+    }
+  }
+
+  const int sent = CheckSystemCall(
+    "sendmmsg", ::sendmmsg( fd_num(), headers.data(), static_cast<unsigned>( headers.size() ), 0 ) );
+  for ( int i = 0; i < sent; i++ ) {
+    register_write();
+  }
+  return sent;
+}
+
+void UDPSocket::set_gro( const bool enabled )
+{
+  setsockopt( SOL_UDP, UDP_GRO, int { enabled } );
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen( const int backlog )
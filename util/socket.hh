@@ -3,7 +3,11 @@
 #include "address.hh"
 #include "file_descriptor.hh"
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <span>
+#include <string>
 #include <sys/socket.h>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
@@ -87,6 +91,31 @@ class UDPSocket : public DatagramSocket
 public:
   //! Default: construct an unbound, unconnected UDP socket
   UDPSocket() : DatagramSocket( AF_INET, SOCK_DGRAM ) {}
+
+  //! A datagram received by recv_batch(), or to be sent by send_batch()
+  struct Datagram
+  {
+    Address peer { "0", 0 }; //!< Where it came from, or is going
+    std::string payload {};
+
+    //! With segmentation offload, `payload` holds several datagrams of this length (the last may be
+    //! shorter); zero for a single datagram
+    uint16_t segment_size {};
+  };
+
+  //! Receive up to `datagrams.size()` datagrams with one [recvmmsg(2)](\ref man2::recvmmsg), each into
+  //! a payload of at most `buffer_size` bytes
+  //! \returns the number received (zero if the socket is non-blocking and none were waiting)
+  //! \note A datagram longer than `buffer_size` is received with an empty payload
+  size_t recv_batch( std::span<Datagram> datagrams, size_t buffer_size );
+
+  //! Send datagrams with one [sendmmsg(2)](\ref man2::sendmmsg), each to its peer
+  //! \returns the number sent (which may be fewer than all, or zero if the socket is non-blocking and full)
+  size_t send_batch( std::span<const Datagram> datagrams );
+
+  //! Let the kernel coalesce datagrams received from the same flow ([UDP_GRO](\ref man7::udp)), to be
+  //! returned by recv_batch() with a Datagram::segment_size
+  void set_gro( bool enabled );
 };
 
 //! A wrapper around [TCP sockets](\ref man7::tcp)
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+//! A bounded queue that one producer thread and one consumer thread can use without locks
+template<typename T>
+class SPSCQueue
+{
+  static constexpr size_t CACHE_LINE = 64;
+
+  std::vector<T> slots_;
+  size_t mask_;
+
+  alignas( CACHE_LINE ) std::atomic<size_t> head_ {}; // next slot to pop (written only by the consumer)
+  alignas( CACHE_LINE ) std::atomic<size_t> tail_ {}; // next slot to push (written only by the producer)
+
+public:
+  //! Construct with room for at least `capacity` items (rounded up to a power of two)
+  explicit SPSCQueue( const size_t capacity )
+    : slots_( std::bit_ceil( capacity ) ), mask_( std::bit_ceil( capacity ) - 1 )
+  {}
+
+  //! Producer: append an item, or return false (leaving `item` untouched) if the queue is full
+  bool push( T&& item )
+  {
+    const size_t tail = tail_.load( std::memory_order_relaxed );
+    if ( tail - head_.load( std::memory_order_acquire ) == slots_.size() ) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move( item );
+    tail_.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  //! Consumer: remove the oldest item, if any
+  std::optional<T> pop()
+  {
+    const size_t head = head_.load( std::memory_order_relaxed );
+    if ( head == tail_.load( std::memory_order_acquire ) ) {
+      return {};
+    }
+    std::optional<T> ret { std::move( slots_[head & mask_] ) };
+    head_.store( head + 1, std::memory_order_release );
+    return ret;
+  }
+
+  //! Either thread: approximate number of queued items
+  size_t size() const { return tail_.load( std::memory_order_acquire ) - head_.load( std::memory_order_acquire ); }
+  bool empty() const { return size() == 0; }
+};
@@ -15,10 +15,11 @@ public:
   static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
   static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
 
-  uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
-  size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
-  size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
-  Wrap32 isn { 137 };                      //!< Default initial sequence number
+  uint16_t rt_timeout = TIMEOUT_DFLT;         //!< Initial value of the retransmission timeout, in milliseconds
+  size_t recv_capacity = DEFAULT_CAPACITY;    //!< Receive capacity, in bytes
+  size_t send_capacity = DEFAULT_CAPACITY;    //!< Sender capacity, in bytes
+  Wrap32 isn { 137 };                         //!< Default initial sequence number
+  size_t max_payload_size = MAX_PAYLOAD_SIZE; //!< Most payload bytes the sender puts in one segment
 };
 
 //! Config for classes derived from FdAdapter
@@ -30,4 +31,8 @@ public:
 
   uint16_t loss_rate_dn = 0; //!< Downlink loss rate (for LossyFdAdapter)
   uint16_t loss_rate_up = 0; //!< Uplink loss rate (for LossyFdAdapter)
+
+  //! Trust the link: don't verify the TCP checksums of received segments, and leave the checksums of sent
+  //! segments to the device (which must be a TunFD opened with checksum offload)
+  bool checksum_offload = false;
 };
@@ -4,13 +4,16 @@
 #include "file_descriptor.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
+#include "tcp_over_udp.hh"
 #include "tcp_peer.hh"
 #include "tuntap_adapter.hh"
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <thread>
+#include <vector>
 
 //! Multithreaded wrapper around TCPPeer that approximates the Unix sockets API
 template<TCPDatagramAdapter AdaptT>
@@ -73,9 +76,31 @@ private:
   //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
   EventLoop _eventloop {};
 
+  //! Transmit the messages that `send` sends (with a TCPBatchDatagramAdapter, by writing them together)
+  void _transmit_together( const std::function<void( const TCPPeer::TransmitFunction& )>& send );
+
+  //! \name
+  //! Segments received from a TCPBatchDatagramAdapter in one wakeup, and the messages to write together
+
+  //!@{
+  std::vector<TCPMessage> _inbound_segments {};
+  std::vector<TCPMessage> _outbound_segments {};
+  //!@}
+
   //! Process events while specified condition is true
   void _tcp_loop( const std::function<bool()>& condition );
 
+  //! Advance the TCPPeer's clock to the current time
+  void _tick();
+
+  //! Make sure a timer rule fires by the TCPPeer's next timeout
+  void _arm_timer();
+
+  uint64_t _last_tick_ms {};                      //!< When the TCPPeer was last ticked
+  size_t _timer_category {};                      //!< EventLoop category for the timer rule
+  std::optional<EventLoop::RuleHandle> _timer {}; //!< The timer rule for the TCPPeer's next timeout
+  std::optional<uint64_t> _timer_deadline_ms {};  //!< When that timer is due
+
   //! Main loop of TCPPeer thread
   void _tcp_main();
 
@@ -96,6 +121,8 @@ private:
 
 using TCPOverIPv4MinnowSocket = TCPMinnowSocket<TCPOverIPv4OverTunFdAdapter>;
 using LossyTCPOverIPv4MinnowSocket = TCPMinnowSocket<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+using TCPOverUDPMinnowSocket = TCPMinnowSocket<TCPOverUDPAdapter>;
+using LossyTCPOverUDPMinnowSocket = TCPMinnowSocket<LossyFdAdapter<TCPOverUDPAdapter>>;
 
 //! \class TCPMinnowSocket
 //! This class involves the simultaneous operation of two threads.
@@ -5,12 +5,14 @@
 #include <cstddef>
 #include <exception>
 #include <iostream>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <sys/socket.h>
 #include <utility>
 
-static constexpr size_t TCP_TICK_MS = 10;
+//! Longest the TCPPeer thread sleeps between timers (bounds how long it takes to notice `_abort`)
+static constexpr int TCP_MAX_SLEEP_MS = 1000;
 
 inline uint64_t timestamp_ms()
 {
@@ -23,26 +25,73 @@ inline uint64_t timestamp_ms()
 template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition )
 {
-  auto base_time = timestamp_ms();
   while ( condition() ) {
-    auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
-    if ( ret == EventLoop::Result::Exit or _abort ) {
-      break;
-    }
-
     if ( not _tcp.has_value() ) {
       throw std::runtime_error( "_tcp_loop entered before TCPPeer initialized" );
     }
 
-    if ( _tcp.value().active() ) {
-      const auto next_time = timestamp_ms();
-      _tcp.value().tick( next_time - base_time, [&]( auto x ) { _datagram_adapter.write( x ); } );
-      _datagram_adapter.tick( next_time - base_time );
-      base_time = next_time;
+    // sleep until the next event, or until the TCPPeer's next timeout
+    _arm_timer();
+    auto ret = _eventloop.wait_next_event( TCP_MAX_SLEEP_MS );
+    if ( ret == EventLoop::Result::Exit or _abort ) {
+      break;
     }
   }
 }
 
+//! Tell the TCPPeer how much time has passed since the last tick
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_tick()
+{
+  const auto next_time = timestamp_ms();
+  if ( _tcp.value().active() ) {
+    _tcp.value().tick( next_time - _last_tick_ms, [&]( auto x ) { _datagram_adapter.write( x ); } );
+    _datagram_adapter.tick( next_time - _last_tick_ms );
+  }
+  _last_tick_ms = next_time;
+}
+
+//! \param[in] send is called with the function that it should use to transmit messages
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_transmit_together(
+  const std::function<void( const TCPPeer::TransmitFunction& )>& send )
+{
+  if constexpr ( TCPBatchDatagramAdapter<AdaptT> ) {
+    // copy each message, since the messages that TCPPeer transmits borrow from its own
+    send( [&]( const TCPMessage& x ) { _outbound_segments.push_back( x ); } );
+    _datagram_adapter.write( std::span<const TCPMessage> { _outbound_segments } );
+    _outbound_segments.clear();
+  } else {
+    send( [&]( const TCPMessage& x ) { _datagram_adapter.write( x ); } );
+  }
+}
+
+//! Make sure a tick is scheduled by the time the TCPPeer's next timeout (retransmission or end of linger) is due
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_arm_timer()
+{
+  std::optional<uint64_t> deadline;
+  if ( const auto remaining = _tcp.value().time_until_next_timeout() ) {
+    deadline = _last_tick_ms + *remaining;
+  }
+
+  // a timer due no later than needed can stay (when it fires, the tick finds nothing due and this re-arms it)
+  if ( not deadline.has_value() or ( _timer_deadline_ms.has_value() and *_timer_deadline_ms <= *deadline ) ) {
+    return;
+  }
+
+  if ( _timer.has_value() ) {
+    _timer->cancel();
+  }
+
+  const auto now = timestamp_ms();
+  _timer_deadline_ms = deadline;
+  _timer = _eventloop.add_timer_rule( _timer_category, *deadline > now ? *deadline - now : 0, [&] {
+    _timer_deadline_ms.reset();
+    _tick();
+  } );
+}
+
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
 template<TCPDatagramAdapter AdaptT>
@@ -60,10 +109,11 @@ template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
 {
   _tcp.emplace( config );
+  _last_tick_ms = timestamp_ms();
 
   // Set up the event loop
 
-  // There are three events to handle:
+  // There are three events to handle, plus the TCPPeer's timeouts (see _arm_timer):
   //
   // 1) Incoming datagram received (needs to be given to TCPPeer::receive method)
   //
@@ -81,7 +131,19 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _datagram_adapter.fd(),
     Direction::In,
     [&] {
-      if ( auto seg = _datagram_adapter.read() ) {
+      if constexpr ( TCPBatchDatagramAdapter<AdaptT> ) {
+        // drain the device, and write the replies together once every segment has been received
+        _inbound_segments.clear();
+        if ( _datagram_adapter.read( _inbound_segments ) > 0 ) {
+          _tick();
+        }
+        _transmit_together( [&]( const auto& transmit ) {
+          for ( auto& seg : _inbound_segments ) {
+            _tcp->receive( std::move( seg ), transmit );
+          }
+        } );
+      } else if ( auto seg = _datagram_adapter.read() ) {
+        _tick();
         _tcp->receive( std::move( seg.value() ), [&]( auto x ) { _datagram_adapter.write( x ); } );
       }
 
@@ -116,7 +178,8 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
                   << " still in flight).\n";
       }
 
-      _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+      _tick();
+      _transmit_together( [&]( const auto& transmit ) { _tcp->push( transmit ); } );
     },
     [&] {
       return ( _tcp->active() ) and ( not _outbound_shutdown )
@@ -166,6 +229,8 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       std::cerr << "DEBUG: minnow inbound stream had error.\n";
       _tcp->inbound_reader().set_error();
     } );
+
+  _timer_category = _eventloop.add_category( "TCPPeer timeout" );
 }
 
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
@@ -281,6 +346,11 @@ void TCPMinnowSocket<AdaptT>::_tcp_main()
       std::cerr << "DEBUG: minnow TCP connection finished "
                 << ( _tcp->inbound_reader().has_error() ? "uncleanly.\n" : "cleanly.\n" );
     }
+    if constexpr ( TCPBatchDatagramAdapter<AdaptT> ) {
+      const auto& stats = _datagram_adapter.read_stats();
+      std::cerr << "DEBUG: minnow read " << stats.datagrams << " datagrams in " << stats.wakeups << " wakeups ("
+                << stats.datagrams_per_wakeup() << " per wakeup).\n";
+    }
     _tcp.reset();
   } catch ( const std::exception& e ) {
     std::cerr << "Exception in TCPConnection runner thread: " << e.what() << "\n";
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "datagram_device.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "flat_hash_map.hh"
+#include "ipv4_datagram.hh"
+#include "socket.hh"
+#include "spsc_queue.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//! The 4-tuple that identifies a TCP connection (addresses and ports in host byte order)
+struct FlowKey
+{
+  uint32_t local_ip {};
+  uint16_t local_port {};
+  uint32_t remote_ip {};
+  uint16_t remote_port {};
+
+  bool operator==( const FlowKey& other ) const = default;
+};
+
+struct FlowKeyHash
+{
+  size_t operator()( const FlowKey& key ) const
+  {
+    // mix all of the bits (the low bits also choose a TCPMinnowStack worker)
+    uint64_t h = ( static_cast<uint64_t>( key.local_ip ) << 32 ) | key.remote_ip;
+    h ^= ( ( static_cast<uint64_t>( key.local_port ) << 16 ) | key.remote_port ) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+};
+
+//! The application's end of a connection served by a TCPMinnowStack
+class TCPStackSocket : public LocalStreamSocket
+{
+  Address local_;
+  Address peer_;
+
+public:
+  TCPStackSocket( LocalStreamSocket&& socket, const Address& local, const Address& peer )
+    : LocalStreamSocket( std::move( socket ) ), local_( local ), peer_( peer )
+  {}
+
+  //! Return the addresses of the TCP connection (not of the underlying Unix-domain socket)
+  const Address& local_address() const { return local_; }
+  const Address& peer_address() const { return peer_; }
+
+  //! \name
+  //! Some methods of the parent Socket wouldn't work as expected on the TCP socket, so delete them
+
+  //!@{
+  void bind( const Address& address ) = delete;
+  void set_reuseaddr() = delete;
+  //!@}
+};
+
+//! \brief A TCP stack that serves many TCPPeers over one datagram device
+//! \details The stack reads IPv4 datagrams from a single file descriptor (usually a TunFD) and
+//! demultiplexes the TCP segments they carry by 4-tuple. Connections are sharded by flow hash
+//! across one or more worker threads, each serving its connections from its own event loop.
+//! With several workers, a dispatcher thread reads the device and hands each datagram to its
+//! worker through a lock-free queue. The device is read and written through DatagramDevice (with
+//! io_uring when available), and each worker submits the datagrams it sends in a round of events
+//! together. Each connection is handed to the owner as a TCPStackSocket.
+class TCPMinnowStack
+{
+public:
+  //! Construct from a file descriptor that reads and writes raw IPv4 datagrams (e.g. a TunFD),
+  //! and start `num_workers` worker threads
+  explicit TCPMinnowStack( FileDescriptor&& datagram_fd, size_t num_workers = 1 );
+
+  //! Stop the stack's threads; any open connections are abandoned
+  ~TCPMinnowStack();
+
+  //! Accept connections to `c_ad.source`, queueing up to `backlog` connections that are
+  //! being established or have not yet been accepted (SYNs beyond that are dropped)
+  void listen( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad, size_t backlog = 16 );
+
+  //! Wait for the next established connection to a listening port
+  TCPStackSocket accept( uint16_t port );
+
+  //! Connect from `c_ad.source` (a zero port picks an ephemeral one) to `c_ad.destination`;
+  //! blocks until the handshake succeeds, or throws if it fails
+  TCPStackSocket connect( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad );
+
+  //! Number of connections currently served by the stack
+  size_t connection_count() const;
+
+  //! Number of worker threads
+  size_t worker_count() const { return workers_.size(); }
+
+  //! \name
+  //! This object cannot be safely moved or copied, since it is in use by several threads simultaneously
+
+  //!@{
+  TCPMinnowStack( const TCPMinnowStack& ) = delete;
+  TCPMinnowStack( TCPMinnowStack&& ) = delete;
+  TCPMinnowStack& operator=( const TCPMinnowStack& ) = delete;
+  TCPMinnowStack& operator=( TCPMinnowStack&& ) = delete;
+  //!@}
+
+private:
+  struct Connection;
+
+  //! Outcome of an active open, reported to the thread blocked in connect()
+  struct PendingConnect
+  {
+    bool done {};
+    bool succeeded {};
+    bool port_in_use {};
+  };
+
+  struct Listener
+  {
+    TCPConfig config;
+    uint32_t ip;    //!< Local address to accept on (0 means any)
+    size_t backlog; //!< Maximum connections in progress or awaiting accept()
+    size_t in_progress {};
+    std::deque<TCPStackSocket> ready {};
+  };
+
+  //! A thread with its own event loop that serves the connections whose flow hash maps to it
+  class Worker
+  {
+  public:
+    //! Construct and start the thread; the worker reads `datagram_fd` itself only if `reads_device`
+    Worker( TCPMinnowStack& stack, FileDescriptor&& datagram_fd, bool reads_device );
+
+    //! Wait for the thread to exit (after the stack has set `abort_`)
+    ~Worker();
+
+    //! Start an active open of `key` on the worker's thread
+    void connect( const TCPConfig& c_tcp,
+                  const FlowKey& key,
+                  const std::shared_ptr<PendingConnect>& pending,
+                  LocalStreamSocket&& thread_data );
+
+    //! Dispatcher: queue a datagram for this worker (false if the queue is full)
+    bool deliver( Ref<std::string>&& datagram ) { return inbound_.push( std::move( datagram ) ); }
+
+    //! Dispatcher: take back a datagram the worker has handled (to drop it on the dispatcher's thread), if any
+    std::optional<Ref<std::string>> handled() { return handled_.pop(); }
+
+    //! Wake the worker's event loop to run commands and drain its queue
+    void ring();
+
+    size_t connection_count() const { return connection_count_.load(); }
+
+    Worker( const Worker& ) = delete;
+    Worker( Worker&& ) = delete;
+    Worker& operator=( const Worker& ) = delete;
+    Worker& operator=( Worker&& ) = delete;
+
+  private:
+    TCPMinnowStack& stack_;
+
+    //! Device that carries the IPv4 datagrams (a separate descriptor for each worker)
+    DatagramDevice device_;
+    std::vector<Ref<std::string>> datagrams_ {};
+
+    //! Socket pair used by other threads (`doorbell_ring_`) to wake the event loop (`doorbell_`)
+    LocalStreamSocket doorbell_;
+    LocalStreamSocket doorbell_ring_;
+    std::atomic_bool rung_ {};
+
+    //! Commands from other threads, run on the worker's thread
+    std::mutex mutex_ {};
+    std::vector<std::function<void()>> commands_ {};
+
+    //! Datagrams from the dispatcher, and on their way back once handled (so that their buffers are reused)
+    SPSCQueue<Ref<std::string>> inbound_;
+    SPSCQueue<Ref<std::string>> handled_;
+    std::vector<Ref<std::string>> unreturned_ {}; //!< Handled datagrams that didn't fit in `handled_`
+
+    //! Connections by 4-tuple (only used by the worker's thread)
+    FlatHashMap<FlowKey, std::shared_ptr<Connection>, FlowKeyHash> connections_ {};
+    std::atomic<size_t> connection_count_ {};
+
+    //! Connections that have finished and will be removed after the current event
+    std::vector<std::shared_ptr<Connection>> finished_ {};
+
+    std::default_random_engine rand_;
+
+    EventLoop eventloop_ { EventLoop::Backend::Epoll };
+    size_t doorbell_category_;
+    size_t datagram_category_;
+    size_t backlog_category_;
+    size_t timer_category_;
+    size_t push_category_;
+    size_t inbound_category_;
+
+    std::thread thread_ {};
+
+    Worker( TCPMinnowStack& stack,
+            std::pair<LocalStreamSocket, LocalStreamSocket> doorbell_pair,
+            FileDescriptor&& datagram_fd,
+            bool reads_device );
+
+    //! Run a function on the worker's thread
+    void post( std::function<void()>&& command );
+
+    //! Hand a datagram's segment to the right connection
+    void receive_datagram( std::string_view datagram );
+
+    //! Create a connection and its event-loop rules
+    std::shared_ptr<Connection> add_connection( const FlowKey& key,
+                                                const TCPConfig& config,
+                                                LocalStreamSocket&& thread_data );
+
+    //! Wrap a message for the given connection in an IPv4 datagram and write it to the device
+    void transmit( const FlowKey& key, const TCPMessage& msg );
+
+    //! Check whether a connection has been established or has finished, and schedule its next timeout
+    void update_state( const std::shared_ptr<Connection>& connection );
+
+    //! Advance a connection's TCPPeer clock to the current time
+    void tick( Connection& connection );
+
+    //! Make sure a timer rule fires by the connection's next timeout
+    void arm_timer( const std::shared_ptr<Connection>& connection );
+
+    //! Remove the connections that have finished
+    void remove_finished();
+
+    //! Main loop of the worker's thread
+    void loop();
+  };
+
+  //! Device that carries the IPv4 datagrams (read by the dispatcher when there are several workers)
+  FileDescriptor datagram_fd_;
+
+  //! State shared between the owner and the workers
+  std::mutex mutex_ {};
+  std::condition_variable cv_ {};
+  std::unordered_map<uint16_t, Listener> listeners_ {};
+  std::default_random_engine rand_;
+
+  std::atomic_bool abort_ { false };
+
+  std::vector<std::unique_ptr<Worker>> workers_ {};
+  std::thread dispatcher_ {};
+
+  //! The worker that owns a flow
+  Worker& worker_for( const FlowKey& key ) { return *workers_[FlowKeyHash {}( key ) % workers_.size()]; }
+
+  //! Main loop of the dispatcher thread: read datagrams and queue each for the worker that owns its flow
+  void dispatch();
+
+  //! Signal anyone waiting in accept() or connect() that the stack has stopped
+  void stop();
+};
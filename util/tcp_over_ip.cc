@@ -21,8 +21,11 @@ using namespace std;
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and records the source and destination addresses and port numbers
 //! from the TCP header; it uses this information to filter future reads.
+//!
+//! The TCP checksum isn't verified if the device has already verified it, or if the link is trusted
+//! (FdAdapterConfig::checksum_offload).
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
-optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( InternetDatagram ip_dgram )
+optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( InternetDatagram ip_dgram, const bool checksum_verified )
 {
   // is the IPv4 datagram for us?
   // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
@@ -42,7 +45,8 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( InternetDatagram ip_d
 
   // is the payload a valid TCP segment?
   TCPSegment tcp_seg;
-  if ( not parse( tcp_seg, move( ip_dgram.payload ), ip_dgram.header.pseudo_checksum() ) ) {
+  const bool verify_checksum = not( checksum_verified or config().checksum_offload );
+  if ( not parse( tcp_seg, move( ip_dgram.payload ), ip_dgram.header.pseudo_checksum(), verify_checksum ) ) {
     return {};
   }
 
@@ -87,10 +91,11 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg )
   ip_dgram.header.dst = config().destination.ipv4_numeric();
   ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + payload_size;
 
-  // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
+  // set payload, calculating TCP checksum (or with offload, the part the device needs) from the IP header
+  const uint32_t pseudo_checksum = ip_dgram.header.pseudo_checksum();
+  ip_dgram.payload.emplace_back( config().checksum_offload ? seg.serialize_with_partial_checksum( pseudo_checksum )
+                                                           : seg.serialize_with_checksum( pseudo_checksum ) );
   ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
 
   return ip_dgram;
 }
@@ -10,7 +10,8 @@
 class TCPOverIPv4Adapter : public FdAdapterBase
 {
 public:
-  std::optional<TCPMessage> unwrap_tcp_in_ip( InternetDatagram ip_dgram );
+  //! \param[in] checksum_verified is whether the device has already verified the TCP checksum
+  std::optional<TCPMessage> unwrap_tcp_in_ip( InternetDatagram ip_dgram, bool checksum_verified = false );
 
   InternetDatagram wrap_tcp_in_ip( const TCPMessage& msg );
 };
@@ -0,0 +1,133 @@
+#include "tcp_over_udp.hh"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+TCPOverUDPAdapter::TCPOverUDPAdapter( UDPSocket&& socket, const bool segmentation_offload )
+  : _socket( move( socket ) ), _segmentation_offload( segmentation_offload )
+{
+  _socket.set_blocking( false );
+  _socket.set_gro( segmentation_offload );
+  _received.resize( segmentation_offload ? GRO_BUFFERS : MAX_READ_BATCH );
+}
+
+//! \details In listening mode, a SYN from any address makes that address the peer (and clears the listening
+//! flag). The TCP checksum isn't verified if the link is trusted (FdAdapterConfig::checksum_offload).
+optional<TCPMessage> TCPOverUDPAdapter::_unwrap( const Address& peer, const string_view datagram )
+{
+  if ( not listening() and peer != config().destination ) {
+    return {};
+  }
+
+  TCPSegment seg;
+  SpanParser parser { datagram };
+  seg.parse( parser, 0, not config().checksum_offload );
+  if ( parser.has_error() ) {
+    return {};
+  }
+
+  if ( listening() ) {
+    if ( not seg.message.sender->SYN or seg.message.sender->RST ) {
+      return {};
+    }
+    config_mutable().destination = peer;
+    set_listening( false );
+  }
+
+  return move( seg.message );
+}
+
+optional<TCPMessage> TCPOverUDPAdapter::read()
+{
+  // a read coalesced by GRO can hold several segments: return them one at a time
+  if ( _next_unread == _unread.size() ) {
+    _unread.clear();
+    _next_unread = 0;
+    read( _unread, 1 );
+    if ( _unread.empty() ) {
+      return {};
+    }
+  }
+  return move( _unread[_next_unread++] );
+}
+
+size_t TCPOverUDPAdapter::read( vector<TCPMessage>& segs, const size_t max_datagrams )
+{
+  ++read_stats_mutable().wakeups;
+  const size_t original_size = segs.size();
+
+  // first, any segments that read() hasn't returned yet
+  move( _unread.begin() + static_cast<ptrdiff_t>( _next_unread ), _unread.end(), back_inserter( segs ) );
+  _unread.clear();
+  _next_unread = 0;
+
+  const size_t buffer_size = _segmentation_offload ? GRO_BUFFER_SIZE : MAX_DATAGRAM_SIZE;
+  for ( size_t reads = 0; reads < max_datagrams; ) {
+    const size_t batch = min( max_datagrams - reads, _received.size() );
+    const size_t received = _socket.recv_batch( span { _received }.first( batch ), buffer_size );
+
+    for ( const auto& datagram : span { _received }.first( received ) ) {
+      // split a coalesced read back into the datagrams that were sent
+      const string_view payload = datagram.payload;
+      const size_t length = datagram.segment_size ? datagram.segment_size : payload.size();
+      size_t offset = 0;
+      do {
+        ++read_stats_mutable().datagrams;
+        if ( auto seg = _unwrap( datagram.peer, payload.substr( offset, length ) ) ) {
+          segs.push_back( move( *seg ) );
+        }
+        offset += length;
+      } while ( offset < payload.size() );
+    }
+
+    reads += received;
+    if ( received < batch ) {
+      break; // nothing more waiting
+    }
+  }
+
+  return segs.size() - original_size;
+}
+
+void TCPOverUDPAdapter::write( const TCPMessage& seg )
+{
+  write( span { &seg, 1 } );
+}
+
+void TCPOverUDPAdapter::write( const span<const TCPMessage> segs )
+{
+  _outgoing.clear();
+  for ( const auto& msg : segs ) {
+    TCPSegment seg { .message = { msg.sender.borrow(), msg.receiver.borrow() },
+                     .udinfo = { config().source.port(), config().destination.port(), 0 } };
+    string bytes = seg.serialize_with_checksum( 0 );
+
+    // With segmentation offload, a datagram joins the run before it if every datagram in the run has the same
+    // length, and it is no longer (the kernel splits a run into datagrams of the first one's length).
+    if ( _segmentation_offload and not _outgoing.empty() ) {
+      auto& run = _outgoing.back();
+      if ( run.payload.size() % run.segment_size == 0 and bytes.size() <= run.segment_size
+           and run.payload.size() / run.segment_size < MAX_GSO_SEGMENTS
+           and run.payload.size() + bytes.size() <= MAX_GSO_BYTES ) {
+        run.payload.append( bytes );
+        continue;
+      }
+    }
+
+    const auto segment_size = static_cast<uint16_t>( _segmentation_offload ? bytes.size() : 0 );
+    _outgoing.push_back( { config().destination, move( bytes ), segment_size } );
+  }
+
+  for ( size_t sent = 0; sent < _outgoing.size(); ) {
+    const size_t batch = _socket.send_batch( span { _outgoing }.subspan( sent ) );
+    if ( batch == 0 ) {
+      break; // the socket has no room
+    }
+    sent += batch;
+  }
+}
+
+//! Specialize LossyFdAdapter to TCPOverUDPAdapter
+template class LossyFdAdapter<TCPOverUDPAdapter>;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "fd_adapter.hh"
+#include "lossy_fd_adapter.hh"
+#include "socket.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+//! \brief A FD adapter that carries TCP segments in UDP datagrams, so that unprivileged processes can run
+//! TCP between themselves
+//! \details Each datagram holds one serialized TCP segment, whose checksum covers the segment without a
+//! pseudo-header (UDP's own checksum covers the addresses). The peer is the UDP address in
+//! FdAdapterConfig::destination, or when listening, whichever address sends the first SYN.
+//!
+//! Datagrams are read and written in batches, with [recvmmsg(2)](\ref man2::recvmmsg) and
+//! [sendmmsg(2)](\ref man2::sendmmsg). With segmentation offload, the kernel also splits up runs of
+//! equal-length datagrams written together (UDP GSO), and coalesces those received from the peer (UDP GRO).
+class TCPOverUDPAdapter : public FdAdapterBase
+{
+public:
+  static constexpr size_t MAX_READ_BATCH = 64;      //!< Most datagrams a batched read() takes at once
+  static constexpr size_t MAX_DATAGRAM_SIZE = 2048; //!< Longest datagram read (longer ones are dropped)
+  static constexpr size_t GRO_BUFFER_SIZE = 65536;  //!< Room for the datagrams the kernel coalesces
+  static constexpr size_t GRO_BUFFERS = 8;          //!< Coalesced reads taken at once (with offload)
+  static constexpr size_t MAX_GSO_SEGMENTS = 64;    //!< Most datagrams the kernel splits from one write
+  static constexpr size_t MAX_GSO_BYTES = 65000;    //!< Most bytes (under the 64 KiB IP limit) in one write
+
+private:
+  UDPSocket _socket;
+  bool _segmentation_offload;
+  std::vector<UDPSocket::Datagram> _received {}; //!< Buffers for recvmmsg(2)
+  std::vector<UDPSocket::Datagram> _outgoing {}; //!< Datagrams for sendmmsg(2)
+  std::vector<TCPMessage> _unread {};            //!< Segments read together that read() hasn't returned yet
+  size_t _next_unread {};
+
+  //! Parse a TCP segment from a datagram, if it is from the peer (and holds a valid segment)
+  std::optional<TCPMessage> _unwrap( const Address& peer, std::string_view datagram );
+
+public:
+  //! Construct from a UDP socket (which is made non-blocking, so that reads can drain it)
+  //! \param[in] socket should already be bound to the local address
+  //! \param[in] segmentation_offload is whether to have the kernel segment and coalesce datagrams
+  explicit TCPOverUDPAdapter( UDPSocket&& socket, bool segmentation_offload = false );
+
+  //! Attempts to read a datagram containing a TCP segment related to the current connection
+  std::optional<TCPMessage> read();
+
+  //! Reads the datagrams waiting on the socket (until it would block, or at most `max_datagrams` reads),
+  //! appending the TCP segments related to the current connection to `segs`
+  //! \returns the number of segments appended
+  size_t read( std::vector<TCPMessage>& segs, size_t max_datagrams = MAX_READ_BATCH );
+
+  //! Sends a TCP segment to the peer
+  void write( const TCPMessage& seg );
+
+  //! Sends a datagram for each segment, together
+  //! \note Datagrams that the socket has no room for are dropped, as on a busy link.
+  void write( std::span<const TCPMessage> segs );
+
+  //! Whether the kernel segments and coalesces datagrams
+  bool segmentation_offload() const { return _segmentation_offload; }
+
+  //! Access underlying file descriptor
+  FileDescriptor& fd() { return _socket; }
+};
+
+static_assert( TCPBatchDatagramAdapter<TCPOverUDPAdapter> );
+static_assert( TCPBatchDatagramAdapter<LossyFdAdapter<TCPOverUDPAdapter>> );
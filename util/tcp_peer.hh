@@ -39,12 +39,23 @@ public:
   bool active() const
   {
     const bool any_errors = receiver_.reader().has_error() or sender_.writer().has_error();
-    const bool sender_active = sender_.sequence_numbers_in_flight() or not sender_.reader().is_finished();
-    const bool receiver_active = not receiver_.writer().is_closed();
-    const bool lingering
-      = linger_after_streams_finish_ and ( cumulative_time_ < time_of_last_receipt_ + 10UL * cfg_.rt_timeout );
+    const bool lingering = linger_after_streams_finish_ and ( cumulative_time_ < linger_end() );
 
-    return ( not any_errors ) and ( sender_active or receiver_active or lingering );
+    return ( not any_errors ) and ( streams_active() or lingering );
+  }
+
+  /* Time (in ms after the last tick) when the next call to tick() will have something to do, if ever */
+  std::optional<uint64_t> time_until_next_timeout() const
+  {
+    if ( not active() ) {
+      return {};
+    }
+
+    // the retransmission timer, or else (once both streams are done) the end of the linger period
+    if ( streams_active() or not linger_after_streams_finish_ ) {
+      return sender_.time_until_timeout();
+    }
+    return linger_end() - cumulative_time_;
   }
 
   void receive( TCPMessage msg, const TransmitFunction& transmit )
@@ -88,7 +99,7 @@ public:
 
 private:
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
+  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout, cfg_.max_payload_size };
   TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
 
   bool need_send_ {};
@@ -102,4 +113,13 @@ private:
   bool linger_after_streams_finish_ { true }; // one peer may need to linger to make sure all closure conditions met
   uint64_t cumulative_time_ {};
   uint64_t time_of_last_receipt_ {};
+
+  bool streams_active() const
+  {
+    const bool sender_active = sender_.sequence_numbers_in_flight() or not sender_.reader().is_finished();
+    const bool receiver_active = not receiver_.writer().is_closed();
+    return sender_active or receiver_active;
+  }
+
+  uint64_t linger_end() const { return time_of_last_receipt_ + 10UL * cfg_.rt_timeout; }
 };
@@ -1,6 +1,8 @@
 #include "tcp_segment.hh"
 #include "checksum.hh"
+#include "ethernet_header.hh"
 #include "helpers.hh"
+#include "ipv4_header.hh"
 #include "wrapping_integers.hh"
 
 #include <sstream>
@@ -8,15 +10,20 @@
 using namespace std;
 
 static_assert( !( TCPSegment::HEADER_LENGTH & 0x03 ) ); // header length must be divisible by 4
+static_assert( EthernetHeader::LENGTH + IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH
+               <= HeaderSerializer::CAPACITY );
 
-void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
+template<class ParserT>
+void TCPSegment::parse( ParserT& parser, uint32_t datagram_layer_pseudo_checksum, const bool verify_checksum )
 {
   /* verify checksum */
-  InternetChecksum check { datagram_layer_pseudo_checksum };
-  check.add( parser.buffer() );
-  if ( check.value() ) {
-    parser.set_error();
-    return;
+  if ( verify_checksum ) {
+    InternetChecksum check { datagram_layer_pseudo_checksum };
+    check.add( parser.buffer() );
+    if ( check.value() ) {
+      parser.set_error();
+      return;
+    }
   }
 
   uint32_t raw32 {};
@@ -58,13 +65,24 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.concatenate_all_remaining( message.sender->payload );
 }
 
+template void TCPSegment::parse( Parser&, uint32_t, bool );
+template void TCPSegment::parse( SpanParser&, uint32_t, bool );
+
 class Wrap32Serializable : public Wrap32
 {
 public:
   uint32_t raw_value() const { return raw_value_; }
 };
 
-void TCPSegment::serialize( Serializer& serializer ) const
+template<class SerializerT>
+void TCPSegment::serialize( SerializerT& serializer ) const
+{
+  serialize_header( serializer );
+  serializer.buffer( message.sender->payload );
+}
+
+template<class SerializerT>
+void TCPSegment::serialize_header( SerializerT& serializer ) const
 {
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
@@ -78,18 +96,56 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( message.receiver->window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
-  serializer.buffer( message.sender->payload );
 }
 
+template void TCPSegment::serialize( Serializer& ) const;
+template void TCPSegment::serialize( HeaderSerializer& ) const;
+template void TCPSegment::serialize_header( Serializer& ) const;
+template void TCPSegment::serialize_header( HeaderSerializer& ) const;
+
 void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
 {
   udinfo.cksum = 0;
-  Serializer s;
-  serialize( s );
+  HeaderSerializer s;
+  serialize_header( s );
 
   InternetChecksum check { datagram_layer_pseudo_checksum };
   check.add( s.finish() );
+  check.add( string_view { message.sender.get().payload } );
+  udinfo.cksum = check.value();
+}
+
+string TCPSegment::serialize_with_checksum( uint32_t datagram_layer_pseudo_checksum )
+{
+  udinfo.cksum = 0;
+  Serializer s;
+  serialize_header( s );
+  string segment = s.finish().front().release(); // the header is all integers, so it is one (owned) buffer
+
+  InternetChecksum check { datagram_layer_pseudo_checksum };
+  check.add( string_view { segment } );
+
+  const string& payload = message.sender.get().payload;
+  segment.resize( HEADER_LENGTH + payload.size() );
+  check.add_and_copy( payload, segment.data() + HEADER_LENGTH );
   udinfo.cksum = check.value();
+
+  // patch the checksum field
+  segment[CHECKSUM_OFFSET] = static_cast<char>( udinfo.cksum >> 8 );
+  segment[CHECKSUM_OFFSET + 1] = static_cast<char>( udinfo.cksum & 0xff );
+  return segment;
+}
+
+string TCPSegment::serialize_with_partial_checksum( uint32_t datagram_layer_pseudo_checksum )
+{
+  // the device sums the segment (including this field) and stores the complement of the sum
+  udinfo.cksum = static_cast<uint16_t>( ~InternetChecksum { datagram_layer_pseudo_checksum }.value() );
+
+  Serializer s;
+  serialize_header( s );
+  string segment = s.finish().front().release();
+  segment.append( message.sender.get().payload );
+  return segment;
 }
 
 string TCPSegment::to_string() const
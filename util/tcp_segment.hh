@@ -22,12 +22,27 @@ struct TCPSegment
   TCPMessage message {};
   UserDatagramInfo udinfo {};
 
-  void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum );
-  void serialize( Serializer& serializer ) const;
+  // Unless `verify_checksum` is false (for a segment whose checksum the link has already verified),
+  // a segment with the wrong checksum is an error
+  template<class ParserT> // Parser or SpanParser
+  void parse( ParserT& parser, uint32_t datagram_layer_pseudo_checksum, bool verify_checksum = true );
+  template<class SerializerT> // Serializer or HeaderSerializer
+  void serialize( SerializerT& serializer ) const;
+  template<class SerializerT>
+  void serialize_header( SerializerT& serializer ) const; // everything but the payload
 
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
 
-  static constexpr uint8_t HEADER_LENGTH = 20; // TCP header length, not including options
+  // Compute the checksum and return the serialized segment, reading the payload only once
+  // (to checksum it as it is copied after the header)
+  std::string serialize_with_checksum( uint32_t datagram_layer_pseudo_checksum );
+
+  // Return the serialized segment with a partial checksum (the folded pseudo-header sum, not complemented),
+  // for a device that will finish the checksum (as with VIRTIO_NET_HDR_F_NEEDS_CSUM)
+  std::string serialize_with_partial_checksum( uint32_t datagram_layer_pseudo_checksum );
+
+  static constexpr uint8_t HEADER_LENGTH = 20;   // TCP header length, not including options
+  static constexpr uint8_t CHECKSUM_OFFSET = 16; // offset of the checksum field in the TCP header
 
   // Return a string containing a summary in human-readable format
   std::string to_string() const;
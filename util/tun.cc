@@ -20,14 +20,18 @@ using namespace std;
 //!     ip tuntap add mode tun user `username` name `devname`
 //!
 //! as root before calling this function.
-
-TunTapFD::TunTapFD( const string& devname, const bool is_tun )
+//!
+//! \param[in] checksum_offload is whether to open the device with `IFF_VNET_HDR`, and tell the kernel
+//! (with `TUN_F_CSUM`) that it may deliver datagrams whose checksums it hasn't computed
+TunTapFD::TunTapFD( const string& devname, const bool is_tun, const bool checksum_offload )
   : FileDescriptor( ::CheckSystemCall( "open", open( CLONEDEV, O_RDWR | O_CLOEXEC ) ) )
+  , checksum_offload_( checksum_offload )
 {
   struct ifreq tun_req
   {};
 
-  tun_req.ifr_flags = static_cast<int16_t>( ( is_tun ? IFF_TUN : IFF_TAP ) | IFF_NO_PI ); // no packetinfo
+  tun_req.ifr_flags = static_cast<int16_t>( ( is_tun ? IFF_TUN : IFF_TAP ) | IFF_NO_PI // no packetinfo
+                                            | ( checksum_offload ? IFF_VNET_HDR : 0 ) );
 
   // copy devname to ifr_name, making sure to null terminate
 
@@ -35,4 +39,8 @@ TunTapFD::TunTapFD( const string& devname, const bool is_tun )
   tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
   CheckSystemCall( "ioctl", ioctl( fd_num(), TUNSETIFF, static_cast<void*>( &tun_req ) ) );
+
+  // The offloads outlive the fd on a persistent device, so they are also turned off without checksum offload
+  // (a reader without the virtio_net_hdr couldn't tell which checksums were left unfinished).
+  CheckSystemCall( "ioctl", ioctl( fd_num(), TUNSETOFFLOAD, checksum_offload ? TUN_F_CSUM : 0U ) );
 }
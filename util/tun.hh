@@ -7,10 +7,16 @@
 //! A FileDescriptor to a [Linux TUN/TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
 class TunTapFD : public FileDescriptor
 {
+  bool checksum_offload_;
+
 public:
   //! Open an existing persistent [TUN or TAP
   //! device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-  explicit TunTapFD( const std::string& devname, bool is_tun );
+  explicit TunTapFD( const std::string& devname, bool is_tun, bool checksum_offload = false );
+
+  //! Whether each datagram read or written is preceded by a `struct virtio_net_hdr` (`IFF_VNET_HDR`)
+  //! that can leave its TCP/UDP checksum to be computed (or declare it already verified) by the kernel
+  bool checksum_offload() const { return checksum_offload_; }
 };
 
 //! A FileDescriptor to a [Linux TUN](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
@@ -18,7 +24,11 @@ class TunFD : public TunTapFD
 {
 public:
   //! Open an existing persistent [TUN device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-  explicit TunFD( const std::string& devname ) : TunTapFD( devname, true ) {}
+  //! \param[in] checksum_offload is whether to exchange checksum offload information with the kernel
+  //!            (see TunTapFD::checksum_offload)
+  explicit TunFD( const std::string& devname, const bool checksum_offload = false )
+    : TunTapFD( devname, true, checksum_offload )
+  {}
 };
 
 //! A FileDescriptor to a [Linux TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
@@ -1,25 +1,124 @@
 #include "tuntap_adapter.hh"
 #include "helpers.hh"
 
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
 using namespace std;
 
-optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
+namespace {
+//! The header that precedes each datagram on a TunFD with checksum offload: `struct virtio_net_hdr` from
+//! <linux/virtio_net.h> (which isn't valid C++), in the machine's byte order
+struct VirtioNetHeader
+{
+  static constexpr uint8_t F_NEEDS_CSUM = 1; //!< The checksum is partial, to be finished from csum_start
+  static constexpr uint8_t F_DATA_VALID = 2; //!< The checksum has been verified
+
+  uint8_t flags;
+  uint8_t gso_type;
+  uint16_t hdr_len;
+  uint16_t gso_size;
+  uint16_t csum_start;  //!< Where to start summing
+  uint16_t csum_offset; //!< Where to store the checksum, after csum_start
+};
+static_assert( sizeof( VirtioNetHeader ) == 10 );
+} // namespace
+
+TCPOverIPv4OverTunFdAdapter::TCPOverIPv4OverTunFdAdapter( TunFD&& tun )
+  : _tun( move( tun ) ), _buffers( make_unique<BufferPool>( READ_BUFFER_SIZE ) )
 {
-  vector<string> strs( 3 );
-  strs[0].resize( IPv4Header::LENGTH );
-  strs[1].resize( TCPSegment::HEADER_LENGTH );
-  _tun.read( strs );
+  _tun.set_blocking( false );
+}
 
+bool TCPOverIPv4OverTunFdAdapter::_read_datagram( optional<TCPMessage>& seg )
+{
+  // the datagram is read whole into a pooled buffer, which goes back to the pool once the segment is parsed
+  auto datagram = _tun.read( *_buffers );
+  if ( datagram.empty() ) {
+    return false; // nothing waiting
+  }
+
+  // with checksum offload, each datagram is preceded by a virtio_net_hdr
+  bool checksum_verified = false;
+  if ( _tun.checksum_offload() ) {
+    if ( datagram.size() < sizeof( VirtioNetHeader ) ) {
+      return true;
+    }
+    VirtioNetHeader vnet_hdr {};
+    memcpy( &vnet_hdr, datagram.get().data(), sizeof( vnet_hdr ) );
+    // the kernel either verified the checksum or never computed it (for a datagram sent on this host)
+    checksum_verified = vnet_hdr.flags & ( VirtioNetHeader::F_DATA_VALID | VirtioNetHeader::F_NEEDS_CSUM );
+    datagram.remove_prefix( sizeof( VirtioNetHeader ) );
+  }
+
+  vector<Ref<string>> buffers;
+  buffers.push_back( move( datagram ) );
   InternetDatagram ip_dgram;
-  if ( parse( ip_dgram, move( strs ) ) ) {
-    return unwrap_tcp_in_ip( move( ip_dgram ) );
+  if ( parse( ip_dgram, move( buffers ) ) ) {
+    seg = unwrap_tcp_in_ip( move( ip_dgram ), checksum_verified );
+  }
+  return true;
+}
+
+optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
+{
+  optional<TCPMessage> seg;
+  _read_datagram( seg );
+  return seg;
+}
+
+size_t TCPOverIPv4OverTunFdAdapter::read( vector<TCPMessage>& segs, const size_t max_datagrams )
+{
+  ++read_stats_mutable().wakeups;
+  const size_t original_size = segs.size();
+  for ( size_t i = 0; i < max_datagrams; i++ ) {
+    optional<TCPMessage> seg;
+    if ( not _read_datagram( seg ) ) {
+      break;
+    }
+    ++read_stats_mutable().datagrams;
+    if ( seg.has_value() ) {
+      segs.push_back( move( *seg ) );
+    }
   }
-  return {};
+  return segs.size() - original_size;
 }
 
 void TCPOverIPv4OverTunFdAdapter::write( const TCPMessage& seg )
 {
-  _tun.write( serialize( wrap_tcp_in_ip( seg ) ) );
+  if ( config().checksum_offload and not _tun.checksum_offload() ) {
+    throw runtime_error( "TCPOverIPv4OverTunFdAdapter: checksum offload needs a TunFD opened with it" );
+  }
+
+  InternetDatagram ip_dgram = wrap_tcp_in_ip( seg );
+  if ( not _tun.checksum_offload() ) {
+    _tun.write( serialize( ip_dgram ) );
+    return;
+  }
+
+  VirtioNetHeader vnet_hdr {};
+  if ( config().checksum_offload ) {
+    // the kernel finishes the TCP checksum, starting from the partial checksum in the segment
+    vnet_hdr.flags = VirtioNetHeader::F_NEEDS_CSUM;
+    vnet_hdr.csum_start = ip_dgram.header.hlen * 4;
+    vnet_hdr.csum_offset = TCPSegment::CHECKSUM_OFFSET;
+  }
+
+  string vnet_bytes( sizeof( vnet_hdr ), 0 );
+  memcpy( vnet_bytes.data(), &vnet_hdr, sizeof( vnet_hdr ) );
+
+  Serializer serializer;
+  serializer.buffer( move( vnet_bytes ) );
+  ip_dgram.serialize( serializer );
+  _tun.write( serializer.finish() );
+}
+
+void TCPOverIPv4OverTunFdAdapter::write( const span<const TCPMessage> segs )
+{
+  for ( const auto& seg : segs ) {
+    write( seg );
+  }
 }
 
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
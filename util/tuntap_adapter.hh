@@ -5,32 +5,48 @@
 #include "tcp_segment.hh"
 #include "tun.hh"
 
+#include <cstddef>
+#include <memory>
 #include <optional>
+#include <span>
 #include <utility>
-
-template<class T>
-concept TCPDatagramAdapter = requires( T a, TCPMessage seg ) {
-  { a.write( seg ) } -> std::same_as<void>;
-
-  { a.read() } -> std::same_as<std::optional<TCPMessage>>;
-};
+#include <vector>
 
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter
 {
+public:
+  static constexpr size_t MAX_READ_BATCH = 64;      //!< Most datagrams a batched read() takes at once
+  static constexpr size_t READ_BUFFER_SIZE = 16384; //!< Longest datagram read (with its virtio_net_hdr)
+
 private:
   TunFD _tun;
+  std::unique_ptr<BufferPool> _buffers; //!< What datagrams are read into (it stays put when the adapter moves)
+
+  //! Read one datagram, and parse it if it holds a TCP segment for the current connection
+  //! \returns false if no datagram was waiting
+  bool _read_datagram( std::optional<TCPMessage>& seg );
 
 public:
-  //! Construct from a TunFD
-  explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( std::move( tun ) ) {}
+  //! Construct from a TunFD (which is made non-blocking, so that reads can drain it)
+  explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun );
 
   //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
   std::optional<TCPMessage> read();
 
+  //! Reads the datagrams waiting on the TUN device (until it would block, or at most `max_datagrams`),
+  //! appending the TCP segments related to the current connection to `segs`
+  //! \returns the number of segments appended
+  size_t read( std::vector<TCPMessage>& segs, size_t max_datagrams = MAX_READ_BATCH );
+
   //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
   void write( const TCPMessage& seg );
 
+  //! Writes a datagram for each segment
+  //! \note A TUN device takes one datagram per write (a [writev(2)](\ref man2::writev) would be joined into
+  //! one datagram), so this saves the caller's round trips through the event loop, not system calls.
+  void write( std::span<const TCPMessage> segs );
+
   //! Access the underlying TUN device
   explicit operator TunFD&() { return _tun; }
 
@@ -41,5 +57,5 @@ public:
   FileDescriptor& fd() { return _tun; }
 };
 
-static_assert( TCPDatagramAdapter<TCPOverIPv4OverTunFdAdapter> );
-static_assert( TCPDatagramAdapter<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>> );
+static_assert( TCPBatchDatagramAdapter<TCPOverIPv4OverTunFdAdapter> );
+static_assert( TCPBatchDatagramAdapter<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>> );